@@ -0,0 +1,66 @@
+/*
+    bench.h - contains helpers for the benchmark suite
+    Copyright 2022 The NexNix Project
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    There should be a copy of the License distributed in a file named
+    LICENSE, if not, you may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/// @file bench.h
+
+#ifndef _BENCH_H
+#define _BENCH_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#define BENCH_ROUNDS   5       // Each benchmark is timed this many times, and the fastest round is reported
+#define BENCH_MIN_TIME 0.05    // Each round runs for at least this many seconds
+
+// Results get stored here, so that the compiler can't throw away the work being timed
+static volatile uint64_t benchSink;
+
+// Gets the current time in seconds
+static inline double benchNow (void)
+{
+    struct timespec ts;
+    timespec_get (&ts, TIME_UTC);
+    return (double) ts.tv_sec + ((double) ts.tv_nsec / 1e9);
+}
+
+// Runs stmt in rounds of at least BENCH_MIN_TIME, and prints how fast bytes octets were processed
+// per run in the fastest round. Taking the fastest round filters out noise from the rest of the system
+#define BENCH(name, bytes, stmt)                                                                \
+    do                                                                                          \
+    {                                                                                           \
+        double benchBest = 0;                                                                   \
+        for (int benchRound = 0; benchRound < BENCH_ROUNDS; ++benchRound)                       \
+        {                                                                                       \
+            size_t benchRuns = 0;                                                               \
+            double benchStart = benchNow();                                                     \
+            double benchTime = 0;                                                               \
+            do                                                                                  \
+            {                                                                                   \
+                stmt;                                                                           \
+                ++benchRuns;                                                                    \
+                benchTime = benchNow() - benchStart;                                            \
+            } while (benchTime < BENCH_MIN_TIME);                                               \
+            double benchRate = ((double) (bytes) * (double) benchRuns) / benchTime / 1048576.0; \
+            if (benchRate > benchBest)                                                          \
+                benchBest = benchRate;                                                          \
+        }                                                                                       \
+        printf ("%-48s %10.1f MiB/s\n", name, benchBest);                                       \
+    } while (0)
+
+#endif
@@ -0,0 +1,52 @@
+/*
+    crc32.c - contains benchmarks for CRC32 functions
+    Copyright 2022 The NexNix Project
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    There should be a copy of the License distributed in a file named
+    LICENSE, if not, you may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/// @file crc32.c
+
+#include "bench.h"
+#include "cpu.h"
+#include <libnex.h>
+#include <stdlib.h>
+
+#define BENCH_SIZE (64 * 1024 * 1024)
+
+int main()
+{
+    uint8_t* buf = malloc_s (BENCH_SIZE);
+    for (size_t i = 0; i < BENCH_SIZE; ++i)
+        buf[i] = (uint8_t) rand();
+
+    // Compare the table driven kernels with the hardware ones
+    __Libnex_crc_set_features (0);
+    BENCH ("Crc32Calc (slicing-by-16)", BENCH_SIZE, benchSink += Crc32Calc (buf, BENCH_SIZE));
+    BENCH ("Crc32cCalc (slicing-by-16)", BENCH_SIZE, benchSink += Crc32cCalc (buf, BENCH_SIZE));
+    __Libnex_crc_set_features (~0U);
+    BENCH ("Crc32Calc", BENCH_SIZE, benchSink += Crc32Calc (buf, BENCH_SIZE));
+    BENCH ("Crc32cCalc", BENCH_SIZE, benchSink += Crc32cCalc (buf, BENCH_SIZE));
+    BENCH ("Crc64Calc", BENCH_SIZE, benchSink += Crc64Calc (buf, BENCH_SIZE));
+
+    // Scale the number of threads up
+    for (unsigned int nthreads = 1; nthreads <= 16; nthreads *= 2)
+    {
+        char name[64];
+        snprintf (name, sizeof (name), "Crc32CalcParallel (%u threads)", nthreads);
+        BENCH (name, BENCH_SIZE, benchSink += Crc32CalcParallel (buf, BENCH_SIZE, nthreads));
+    }
+    free (buf);
+    return 0;
+}
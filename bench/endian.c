@@ -0,0 +1,82 @@
+/*
+    endian.c - contains benchmarks for bulk endian functions
+    Copyright 2022 The NexNix Project
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    There should be a copy of the License distributed in a file named
+    LICENSE, if not, you may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/// @file endian.c
+
+#include "bench.h"
+#include <libnex.h>
+#include <stdlib.h>
+
+// The opposite of the host's byte order, so that every element needs swapping
+#define BENCH_OTHER ((ENDIAN_HOST == ENDIAN_LITTLE) ? ENDIAN_BIG : ENDIAN_LITTLE)
+
+// Converts one element at a time, as callers had to before the bulk functions
+static void convertLoop16 (uint16_t* dst, const uint16_t* src, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+        dst[i] = EndianChange16 (src[i], BENCH_OTHER);
+}
+
+static void convertLoop32 (uint32_t* dst, const uint32_t* src, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+        dst[i] = EndianChange32 (src[i], BENCH_OTHER);
+}
+
+static void convertLoop64 (uint64_t* dst, const uint64_t* src, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+        dst[i] = EndianChange64 (src[i], BENCH_OTHER);
+}
+
+// Runs every benchmark on buffers of size octets
+static void benchSize (uint8_t* dst, const uint8_t* src, size_t size, const char* suffix)
+{
+    char name[64];
+#define BENCH_NAMED(str, stmt)                               \
+    snprintf (name, sizeof (name), "%s (%s)", str, suffix); \
+    BENCH (name, size, stmt)
+    BENCH_NAMED ("per-element EndianChange16", convertLoop16 ((uint16_t*) dst, (const uint16_t*) src, size / 2));
+    BENCH_NAMED ("EndianConvertBuf16", EndianConvertBuf16 (dst, src, size / 2, BENCH_OTHER));
+    BENCH_NAMED ("EndianSwapBuf16", EndianSwapBuf16 (dst, src, size / 2));
+    BENCH_NAMED ("per-element EndianChange32", convertLoop32 ((uint32_t*) dst, (const uint32_t*) src, size / 4));
+    BENCH_NAMED ("EndianConvertBuf32", EndianConvertBuf32 (dst, src, size / 4, BENCH_OTHER));
+    BENCH_NAMED ("EndianSwapBuf32", EndianSwapBuf32 (dst, src, size / 4));
+    BENCH_NAMED ("per-element EndianChange64", convertLoop64 ((uint64_t*) dst, (const uint64_t*) src, size / 8));
+    BENCH_NAMED ("EndianConvertBuf64", EndianConvertBuf64 (dst, src, size / 8, BENCH_OTHER));
+    BENCH_NAMED ("EndianSwapBuf64", EndianSwapBuf64 (dst, src, size / 8));
+    // Unaligned buffers take the same path
+    BENCH_NAMED ("EndianSwapBuf32 unaligned", EndianSwapBuf32 (dst + 1, src + 3, (size / 4) - 1));
+#undef BENCH_NAMED
+    benchSink += dst[rand() % size];
+}
+
+int main()
+{
+    // One size that stays in L1, and one that has to come from memory
+    size_t bigSize = 16 * 1024 * 1024;
+    uint8_t* src = malloc_s (bigSize);
+    uint8_t* dst = malloc_s (bigSize);
+    for (size_t i = 0; i < bigSize; ++i)
+        src[i] = (uint8_t) rand();
+    benchSize (dst, src, 16 * 1024, "16 KiB");
+    benchSize (dst, src, bigSize, "16 MiB");
+    free (src);
+    free (dst);
+    return 0;
+}
@@ -0,0 +1,118 @@
+/*
+    textstream.c - contains benchmarks for text streams
+    Copyright 2022 The NexNix Project
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    There should be a copy of the License distributed in a file named
+    LICENSE, if not, you may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/// @file textstream.c
+
+#include "bench.h"
+#include <libnex.h>
+#include <stdlib.h>
+
+#define BENCH_CHARS (256 * 1024)
+#define BENCH_FILE  "benchText.tmp"
+
+// The letters the corpora are made of
+static const struct
+{
+    char32_t first;    // First letter of the script
+    char32_t count;    // Number of letters in the script
+} scripts[] = {{'a', 26}, {0xE0, 32}, {0x430, 32}, {0x4E00, 2048}};
+
+// Writes out a file of lines of words, where each word is in one of the scripts in mask
+// Returns the size of the file
+static size_t makeFile (char encoding, unsigned int mask)
+{
+    char32_t* chars = malloc_s ((BENCH_CHARS + 1) * sizeof (char32_t));
+    size_t i = 0;
+    size_t lineLen = 0;
+    while (i < BENCH_CHARS)
+    {
+        size_t script = (size_t) rand() % (sizeof (scripts) / sizeof (scripts[0]));
+        if (!(mask & (1 << script)))
+            continue;
+        size_t wordLen = 2 + (rand() % 7);
+        for (size_t j = 0; j < wordLen && i < BENCH_CHARS; ++j)
+            chars[i++] = scripts[script].first + ((char32_t) rand() % scripts[script].count);
+        // Break lines at around 60 characters
+        lineLen += wordLen + 1;
+        if (i < BENCH_CHARS)
+            chars[i++] = (lineLen > 60) ? '\n' : ' ';
+        if (lineLen > 60)
+            lineLen = 0;
+    }
+    TextStream_t* stream = NULL;
+    if (TextOpen (BENCH_FILE, &stream, TEXT_MODE_WRITE, encoding, 0, 0) != TEXT_SUCCESS ||
+        TextWrite (stream, chars, BENCH_CHARS, NULL) != TEXT_SUCCESS)
+        abort();
+    TextClose (stream);
+    free (chars);
+    FILE* file = fopen (BENCH_FILE, "rb");
+    fseek (file, 0, SEEK_END);
+    size_t size = (size_t) ftell (file);
+    fclose (file);
+    return size;
+}
+
+// Reads the whole file, either in big chunks or a line at a time
+static size_t readFile (char encoding, bool byLine)
+{
+    static char32_t buf[4096];
+    // UTF-16 and UTF-32 files get a BOM when they are written
+    bool hasBom = (encoding == TEXT_ENC_UTF16 || encoding == TEXT_ENC_UTF32);
+    TextStream_t* stream = NULL;
+    if (TextOpen (BENCH_FILE, &stream, TEXT_MODE_READ, encoding, hasBom, 0) != TEXT_SUCCESS)
+        abort();
+    size_t total = 0;
+    size_t charsRead = 0;
+    do
+    {
+        short res = byLine ? TextReadLine (stream, buf, 4096, &charsRead)
+                           : TextRead (stream, buf, 4096, &charsRead);
+        if (res != TEXT_SUCCESS)
+            abort();
+        total += charsRead;
+    } while (charsRead);
+    TextClose (stream);
+    return total;
+}
+
+int main()
+{
+    // English only, European languages, and everything mixed together, in the encodings that can hold them
+    static const struct
+    {
+        const char* name;
+        char encoding;
+        unsigned int mask;
+    } files[] = {{"UTF-8, English", TEXT_ENC_UTF8, 0x1},
+                 {"UTF-8, mixed", TEXT_ENC_UTF8, 0xF},
+                 {"UTF-16, mixed", TEXT_ENC_UTF16, 0xF},
+                 {"UTF-32, mixed", TEXT_ENC_UTF32, 0xF},
+                 {"Windows-1252, European", TEXT_ENC_WIN1252, 0x3}};
+    srand (1);
+    for (size_t i = 0; i < (sizeof (files) / sizeof (files[0])); ++i)
+    {
+        size_t size = makeFile (files[i].encoding, files[i].mask);
+        char name[64];
+        snprintf (name, sizeof (name), "TextRead (%s)", files[i].name);
+        BENCH (name, size, benchSink += readFile (files[i].encoding, false));
+        snprintf (name, sizeof (name), "TextReadLine (%s)", files[i].name);
+        BENCH (name, size, benchSink += readFile (files[i].encoding, true));
+    }
+    remove (BENCH_FILE);
+    return 0;
+}
@@ -0,0 +1,122 @@
+/*
+    unicode.c - contains benchmarks for Unicode functions
+    Copyright 2022 The NexNix Project
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    There should be a copy of the License distributed in a file named
+    LICENSE, if not, you may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/// @file unicode.c
+
+#include "bench.h"
+#include <libnex.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BENCH_CHARS (256 * 1024)
+
+// The scripts the corpora are made of. Words are drawn from the letters, and separated by spaces
+static const struct
+{
+    const char* name;
+    char32_t first;    // First letter of the script
+    char32_t count;    // Number of letters in the script
+} scripts[] = {
+    {"English", 'a', 26},
+    {"Latin-1", 0xE0, 32},
+    {"Russian", 0x430, 32},
+    {"Chinese", 0x4E00, 2048},
+    {"Emoji", 0x1F600, 80},
+};
+
+#define SCRIPT_COUNT (sizeof (scripts) / sizeof (scripts[0]))
+
+// Generates a corpus of words, where each word is in one of the scripts in mask
+// Returns the length of the corpus in octets
+static size_t makeCorpus (uint8_t* out, unsigned int mask)
+{
+    char32_t* chars = malloc_s (BENCH_CHARS * sizeof (char32_t));
+    size_t i = 0;
+    while (i < BENCH_CHARS)
+    {
+        size_t script = (size_t) rand() % SCRIPT_COUNT;
+        if (!(mask & (1 << script)))
+            continue;
+        size_t wordLen = 2 + (rand() % 7);
+        for (size_t j = 0; j < wordLen && i < BENCH_CHARS; ++j)
+            chars[i++] = scripts[script].first + ((char32_t) rand() % scripts[script].count);
+        if (i < BENCH_CHARS)
+            chars[i++] = ' ';
+    }
+    size_t len = UnicodeEncode8Buf (out, BENCH_CHARS * 4, chars, BENCH_CHARS, NULL);
+    free (chars);
+    return len;
+}
+
+// Decodes one octet at a time, as a keyboard driver or a baremetal build would
+static size_t decodePart8 (char32_t* out, const uint8_t* in, size_t len)
+{
+    size_t outPos = 0;
+    Utf8State_t state;
+    UnicodeStateInit (state);
+    for (size_t i = 0; i < len; ++i)
+    {
+        if (!UnicodeDecodePart8 (&out[outPos], in[i], &state))
+        {
+            out[outPos++] = 0xFFFD;
+            UnicodeStateInit (state);
+        }
+        else if (UnicodeIsAccepted (state))
+        {
+            ++outPos;
+            UnicodeStateInit (state);
+        }
+    }
+    return outPos;
+}
+
+// Decodes one character at a time
+static size_t decode8 (char32_t* out, const uint8_t* in, size_t len)
+{
+    size_t outPos = 0;
+    for (size_t i = 0; i < len; ++outPos)
+        i += UnicodeDecode8 (&out[outPos], in + i, len - i);
+    return outPos;
+}
+
+int main()
+{
+    // English only, European languages, Chinese only, and everything mixed together
+    static const struct
+    {
+        const char* name;
+        unsigned int mask;
+    } corpora[] = {{"English", 0x1}, {"European", 0x7}, {"Chinese", 0x8}, {"mixed", 0x1F}};
+    uint8_t* in = malloc_s (BENCH_CHARS * 4);
+    char32_t* out = malloc_s (BENCH_CHARS * sizeof (char32_t));
+    srand (1);
+    for (size_t i = 0; i < (sizeof (corpora) / sizeof (corpora[0])); ++i)
+    {
+        size_t len = makeCorpus (in, corpora[i].mask);
+        char name[64];
+        snprintf (name, sizeof (name), "UnicodeDecodePart8 (%s)", corpora[i].name);
+        BENCH (name, len, benchSink += decodePart8 (out, in, len));
+        snprintf (name, sizeof (name), "UnicodeDecode8 (%s)", corpora[i].name);
+        BENCH (name, len, benchSink += decode8 (out, in, len));
+        snprintf (name, sizeof (name), "UnicodeDecode8Buf (%s)", corpora[i].name);
+        BENCH (name, len, benchSink += UnicodeDecode8Buf (out, BENCH_CHARS, in, len, NULL));
+    }
+    free (in);
+    free (out);
+    return 0;
+}
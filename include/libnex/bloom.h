@@ -0,0 +1,155 @@
+/*
+    bloom.h - contains Bloom filter interface
+    Copyright 2022 The NexNix Project
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    There should be a copy of the License distributed in a file named
+    LICENSE, if not, you may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/// @file bloom.h
+
+#ifndef _BLOOM_H
+#define _BLOOM_H
+
+#include <libnex/decls.h>
+#include <libnex/libnex_config.h>
+#include <libnex/object.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Describes a Bloom filter
+ *
+ * All probes of an item are derived from a single 64-bit hash. In blocked mode,
+ * all of an item's bits lie in one 512-bit block, so that a lookup costs one cache miss
+ */
+typedef struct _BloomFilter
+{
+    Object_t obj;              ///< The underlying object
+    uint64_t* bits;            ///< The bit array
+    size_t numBits;            ///< Number of bits in filter. A multiple of BLOOM_BLOCK_BITS
+    size_t numBlocks;          ///< Number of blocks in filter
+    unsigned int numProbes;    ///< Number of bits set per item
+    int flags;                 ///< Flags this filter was created with
+} BloomFilter_t;
+
+// Bloom filter flags
+#define BLOOM_FLAG_BLOCKED (1 << 0)    ///< Keep all probes of an item in one cache line
+
+#define BLOOM_BLOCK_BITS 512    ///< Number of bits in a block. Equal to one 64 byte cache line
+#define BLOOM_MAX_PROBES 16     ///< Maximum number of probes per item
+
+__DECL_START
+
+/**
+ * @brief Creates a Bloom filter
+ * @param numBits number of bits in the filter. Rounded up to a multiple of BLOOM_BLOCK_BITS
+ * @param numProbes number of bits to set per item, from 1 to BLOOM_MAX_PROBES
+ * @param flags BLOOM_FLAG_BLOCKED for the cache-line-blocked layout
+ * @return The new filter, or NULL on failure
+ */
+LIBNEX_PUBLIC BloomFilter_t* BloomCreate (size_t numBits, unsigned int numProbes, int flags);
+
+/**
+ * @brief Creates a Bloom filter sized for a target false positive rate
+ *
+ * Note that blocked filters have a slightly higher false positive rate than standard ones
+ * of the same size
+ * @param numItems number of items expected to be added
+ * @param fpRate target false positive rate, between 0 and 1 exclusive
+ * @param flags BLOOM_FLAG_BLOCKED for the cache-line-blocked layout
+ * @return The new filter, or NULL on failure
+ */
+LIBNEX_PUBLIC BloomFilter_t* BloomCreateFp (size_t numItems, double fpRate, int flags);
+
+/**
+ * @brief Destroys a Bloom filter
+ * Note that if other consumers are referencing this filter still, it is not destroyed
+ * @param filter the filter to destroy
+ */
+LIBNEX_PUBLIC void BloomDestroy (BloomFilter_t* filter);
+
+/**
+ * @brief Adds an item to a Bloom filter by its hash
+ * @param filter the filter to add to
+ * @param hash the 64-bit hash of the item, e.g., from HashCreateHash64
+ */
+LIBNEX_PUBLIC void BloomAddHash (BloomFilter_t* filter, uint64_t hash);
+
+/**
+ * @brief Checks if an item may be in a Bloom filter by its hash
+ * @param filter the filter to check
+ * @param hash the 64-bit hash of the item
+ * @return false if the item definitely isn't in the filter, true if it may be
+ */
+LIBNEX_PUBLIC bool BloomCheckHash (const BloomFilter_t* filter, uint64_t hash);
+
+/**
+ * @brief Adds an item to a Bloom filter
+ * @param filter the filter to add to
+ * @param buf the item to add
+ * @param sz the size of buf
+ */
+LIBNEX_PUBLIC void BloomAdd (BloomFilter_t* filter, const void* buf, size_t sz);
+
+/**
+ * @brief Checks if an item may be in a Bloom filter
+ * @param filter the filter to check
+ * @param buf the item to check for
+ * @param sz the size of buf
+ * @return false if the item definitely isn't in the filter, true if it may be
+ */
+LIBNEX_PUBLIC bool BloomCheck (const BloomFilter_t* filter, const void* buf, size_t sz);
+
+/**
+ * @brief Merges one Bloom filter into another
+ * Both filters must have been created with the same size, probe count, and flags
+ * @param dest the filter to merge into
+ * @param src the filter to merge from
+ * @return true on success, false if the filters aren't compatible
+ */
+LIBNEX_PUBLIC bool BloomMerge (BloomFilter_t* dest, const BloomFilter_t* src);
+
+/**
+ * @brief Gets the number of bytes needed to serialize a Bloom filter
+ * @param filter the filter to get the size of
+ * @return The size in bytes
+ */
+LIBNEX_PUBLIC size_t BloomSerializedSize (const BloomFilter_t* filter);
+
+/**
+ * @brief Serializes a Bloom filter into a buffer
+ * The serialized form is little endian, so it can be read on any host
+ * @param filter the filter to serialize
+ * @param buf the buffer to write to
+ * @param sz the size of buf
+ * @return The number of bytes written, or 0 if buf is too small
+ */
+LIBNEX_PUBLIC size_t BloomSerialize (const BloomFilter_t* filter, uint8_t* buf, size_t sz);
+
+/**
+ * @brief Creates a Bloom filter from a buffer written by BloomSerialize
+ * @param buf the buffer to read from
+ * @param sz the size of buf
+ * @return The new filter, or NULL if buf is invalid
+ */
+LIBNEX_PUBLIC BloomFilter_t* BloomDeserialize (const uint8_t* buf, size_t sz);
+
+__DECL_END
+
+#define BloomRef(item)    (ObjRef (&(item)->obj))       ///< References the underlying object
+#define BloomLock(item)   (ObjLock (&(item)->obj))      ///< Locks this filter
+#define BloomUnlock(item) (ObjUnlock (&(item)->obj))    ///< Unlocks the filter
+
+#endif
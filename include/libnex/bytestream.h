@@ -0,0 +1,259 @@
+/*
+    bytestream.h - contains declarations to work with binary files
+    Copyright 2022 The NexNix Project
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    There should be a copy of the License distributed in a file named
+    LICENSE, if not, you may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/// @file bytestream.h
+
+#ifndef _BYTESTREAM_H
+#define _BYTESTREAM_H
+
+#include <libnex/decls.h>
+#include <libnex/endian.h>
+#include <libnex/object.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Modes for ByteOpen
+#define BYTE_MODE_READ   0    ///< File will be opened solely for reading
+#define BYTE_MODE_WRITE  1    ///< File will be created (or truncated), and writing solely allowed
+#define BYTE_MODE_APPEND 2    ///< File will be appended to
+
+// Valid errors that can occur
+#define BYTE_SUCCESS           1    ///< No error
+#define BYTE_SYS_ERROR         2    ///< errno contains the error
+#define BYTE_INVALID_PARAMETER 3    ///< User passed an invalid parameter
+#define BYTE_EOF               4    ///< End of file was reached before the request was satisfied
+#define BYTE_BAD_VARINT        5    ///< A malformed varint was encountered
+#define BYTE_BUF_TOO_SMALL     6    ///< Request is larger than the stream's buffer
+
+#define BYTE_DEFAULT_BUFSZ 4096    ///< Default size of the staging buffer
+#define BYTE_MIN_BUFSZ     16      ///< Smallest allowed staging buffer. Fits any typed value or varint
+
+__DECL_START
+
+/**
+ * @brief Describes a binary file stream
+ *
+ * ByteStream_t is the binary counterpart of TextStream_t. It stages reads and writes
+ * through a buffer, so that small typed accesses don't each become a stdio call
+ */
+typedef struct _ByteStream
+{
+    Object_t obj;      // The object for this stream
+    FILE* file;        // Pointer to underlying file object
+    uint8_t* buf;      // Buffer to use for staging
+    size_t bufSize;    // Size of above buffer
+    size_t bufPos;     // Position within buffer
+    size_t bufLen;     // Number of valid bytes in buffer. Used only for reading
+    char mode;         // Mode used to open byte stream
+    bool isEof;        // Contains if EOF was reached
+} ByteStream_t;
+
+/**
+ * @brief Opens up a byte stream with the default buffer size
+ * @param[in] file specifies the file name to open
+ * @param[out] stream result variable to put the stream in
+ * @param[in] mode the opening mode
+ * @return BYTE_SUCCESS, otherwise, an error code
+ */
+LIBNEX_PUBLIC short ByteOpen (const char* file, ByteStream_t** stream, char mode);
+
+/**
+ * @brief Opens up a byte stream with the specified buffer size
+ * @param[in] file specifies the file name to open
+ * @param[out] stream result variable to put the stream in
+ * @param[in] mode the opening mode
+ * @param[in] bufSize size of the staging buffer. Must be at least BYTE_MIN_BUFSZ
+ * @return BYTE_SUCCESS, otherwise, an error code
+ */
+LIBNEX_PUBLIC short ByteOpenEx (const char* file, ByteStream_t** stream, char mode, size_t bufSize);
+
+/**
+ * @brief Closes a byte stream, flushing it if it is in a writing mode
+ * @param[in] stream the stream to close
+ * @return BYTE_SUCCESS, otherwise, an error code
+ */
+LIBNEX_PUBLIC short ByteClose (ByteStream_t* stream);
+
+/**
+ * @brief Flushes the contents of a byte stream when the stream is in a writing mode
+ * @param stream the stream to flush
+ * @return an error code, or BYTE_SUCCESS
+ */
+LIBNEX_PUBLIC short ByteFlush (ByteStream_t* stream);
+
+/**
+ * @brief Reads a span of bytes from a byte stream
+ *
+ * Reads larger than the staging buffer go directly into buf
+ * @param[in] stream the stream to read from
+ * @param[out] buf the buffer to read into
+ * @param[in] sz the number of bytes to read
+ * @param[out] bytesRead the number of bytes read. May be NULL
+ * @return BYTE_SUCCESS, or BYTE_EOF if the file ended first
+ */
+LIBNEX_PUBLIC short ByteRead (ByteStream_t* stream, void* buf, size_t sz, size_t* bytesRead);
+
+/**
+ * @brief Writes a span of bytes to a byte stream
+ * @param[in] stream the stream to write to
+ * @param[in] buf the buffer to write from
+ * @param[in] sz the number of bytes to write
+ * @return a status code
+ */
+LIBNEX_PUBLIC short ByteWrite (ByteStream_t* stream, const void* buf, size_t sz);
+
+/**
+ * @brief Reads an 8 bit value from a byte stream
+ * @param stream the stream to read from
+ * @param val pointer to write the value to
+ * @return a status code
+ */
+LIBNEX_PUBLIC short ByteReadU8 (ByteStream_t* stream, uint8_t* val);
+
+/**
+ * @brief Reads a 16 bit value from a byte stream
+ * @param stream the stream to read from
+ * @param val pointer to write the value to, in host's order
+ * @param endian ENDIAN_BIG if the stream holds it big endian, ENDIAN_LITTLE if little endian
+ * @return a status code
+ */
+LIBNEX_PUBLIC short ByteReadU16 (ByteStream_t* stream, uint16_t* val, char endian);
+
+/**
+ * @brief Reads a 32 bit value from a byte stream
+ * @param stream the stream to read from
+ * @param val pointer to write the value to, in host's order
+ * @param endian ENDIAN_BIG if the stream holds it big endian, ENDIAN_LITTLE if little endian
+ * @return a status code
+ */
+LIBNEX_PUBLIC short ByteReadU32 (ByteStream_t* stream, uint32_t* val, char endian);
+
+/**
+ * @brief Reads a 64 bit value from a byte stream
+ * @param stream the stream to read from
+ * @param val pointer to write the value to, in host's order
+ * @param endian ENDIAN_BIG if the stream holds it big endian, ENDIAN_LITTLE if little endian
+ * @return a status code
+ */
+LIBNEX_PUBLIC short ByteReadU64 (ByteStream_t* stream, uint64_t* val, char endian);
+
+/**
+ * @brief Reads a ULEB128 value from a byte stream
+ * @param stream the stream to read from
+ * @param val pointer to write the value to
+ * @return a status code
+ */
+LIBNEX_PUBLIC short ByteReadVarU (ByteStream_t* stream, uint64_t* val);
+
+/**
+ * @brief Reads a SLEB128 value from a byte stream
+ * @param stream the stream to read from
+ * @param val pointer to write the value to
+ * @return a status code
+ */
+LIBNEX_PUBLIC short ByteReadVarS (ByteStream_t* stream, int64_t* val);
+
+/**
+ * @brief Writes an 8 bit value to a byte stream
+ * @param stream the stream to write to
+ * @param val the value to write
+ * @return a status code
+ */
+LIBNEX_PUBLIC short ByteWriteU8 (ByteStream_t* stream, uint8_t val);
+
+/**
+ * @brief Writes a 16 bit value to a byte stream
+ * @param stream the stream to write to
+ * @param val the value to write, in host's order
+ * @param endian ENDIAN_BIG if writing big endian, ENDIAN_LITTLE if little endian
+ * @return a status code
+ */
+LIBNEX_PUBLIC short ByteWriteU16 (ByteStream_t* stream, uint16_t val, char endian);
+
+/**
+ * @brief Writes a 32 bit value to a byte stream
+ * @param stream the stream to write to
+ * @param val the value to write, in host's order
+ * @param endian ENDIAN_BIG if writing big endian, ENDIAN_LITTLE if little endian
+ * @return a status code
+ */
+LIBNEX_PUBLIC short ByteWriteU32 (ByteStream_t* stream, uint32_t val, char endian);
+
+/**
+ * @brief Writes a 64 bit value to a byte stream
+ * @param stream the stream to write to
+ * @param val the value to write, in host's order
+ * @param endian ENDIAN_BIG if writing big endian, ENDIAN_LITTLE if little endian
+ * @return a status code
+ */
+LIBNEX_PUBLIC short ByteWriteU64 (ByteStream_t* stream, uint64_t val, char endian);
+
+/**
+ * @brief Writes a value as ULEB128 to a byte stream
+ * @param stream the stream to write to
+ * @param val the value to write
+ * @return a status code
+ */
+LIBNEX_PUBLIC short ByteWriteVarU (ByteStream_t* stream, uint64_t val);
+
+/**
+ * @brief Writes a value as SLEB128 to a byte stream
+ * @param stream the stream to write to
+ * @param val the value to write
+ * @return a status code
+ */
+LIBNEX_PUBLIC short ByteWriteVarS (ByteStream_t* stream, int64_t val);
+
+/**
+ * @brief Gets a pointer to the next bytes of a byte stream without copying them
+ *
+ * The data stays valid until the next operation on the stream. Use ByteConsume to move past it
+ * @param[in] stream the stream to peek into
+ * @param[in] sz the number of bytes wanted. Must be no larger than the stream's buffer
+ * @param[out] data pointer to write the address of the data to
+ * @param[out] avail the number of bytes at data. Less than sz only at end of file
+ * @return a status code
+ */
+LIBNEX_PUBLIC short BytePeek (ByteStream_t* stream, size_t sz, const uint8_t** data, size_t* avail);
+
+/**
+ * @brief Moves past bytes returned by BytePeek
+ * @param stream the stream to advance
+ * @param sz the number of bytes to move past. Must be no more than BytePeek made available
+ * @return a status code
+ */
+LIBNEX_PUBLIC short ByteConsume (ByteStream_t* stream, size_t sz);
+
+/**
+ * @brief Returns a textual representation of a bytestream error code
+ * @param code the error code turn into a string
+ * @return the string message
+ */
+LIBNEX_PUBLIC const char* ByteError (int code);
+
+__DECL_END
+
+// Helper macros
+#define ByteRef(item)    ((ByteStream_t*) ObjRef (&(item)->obj))    ///< References the underlying the object
+#define ByteLock(item)   (ObjLock (&(item)->obj))                   ///< Locks this stream
+#define ByteUnlock(item) (ObjUnlock (&(item)->obj))                 ///< Unlocks the stream
+#define ByteIsEof(stream) ((stream)->isEof)    ///< Checks if we have reached the end of stream
+
+#endif
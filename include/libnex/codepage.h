@@ -0,0 +1,132 @@
+/*
+    codepage.h - contains single byte codepage interface
+    Copyright 2022 The NexNix Project
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    There should be a copy of the License distributed in a file named
+    LICENSE, if not, you may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/// @file codepage.h
+
+#ifndef _CODEPAGE_H
+#define _CODEPAGE_H
+
+#include <libnex/decls.h>
+#include <libnex/libnex_config.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <uchar.h>
+
+/**
+ * @brief Describes a single byte codepage
+ *
+ * Decoding is a lookup in toUnicode. Encoding is a lookup in a sparse two level table, where
+ * the upper 8 bits of a character pick a page of fromUnicode, and the lower 8 bits index into it.
+ * Only characters in the Basic Multilingual Plane can be in a codepage
+ */
+typedef struct _Codepage
+{
+    char32_t toUnicode[256];        ///< Maps octets to characters. Undefined octets map to U+FFFD
+    uint16_t pageIdx[256];          ///< Maps the upper 8 bits of a character to a page. Page 0 is empty
+    uint8_t (*fromUnicode)[256];    ///< Maps the lower 8 bits of a character to an octet
+    size_t numPages;                ///< Number of pages in fromUnicode
+    bool isAscii;                   ///< If the lower half of the codepage is ASCII
+} Codepage_t;
+
+// Built in codepages
+#define CODEPAGE_ISO8859_1  1     ///< ISO-8859-1 (Latin-1, Western European)
+#define CODEPAGE_ISO8859_2  2     ///< ISO-8859-2 (Latin-2, Central European)
+#define CODEPAGE_ISO8859_3  3     ///< ISO-8859-3 (Latin-3, South European)
+#define CODEPAGE_ISO8859_4  4     ///< ISO-8859-4 (Latin-4, North European)
+#define CODEPAGE_ISO8859_5  5     ///< ISO-8859-5 (Cyrillic)
+#define CODEPAGE_ISO8859_6  6     ///< ISO-8859-6 (Arabic)
+#define CODEPAGE_ISO8859_7  7     ///< ISO-8859-7 (Greek)
+#define CODEPAGE_ISO8859_8  8     ///< ISO-8859-8 (Hebrew)
+#define CODEPAGE_ISO8859_9  9     ///< ISO-8859-9 (Latin-5, Turkish)
+#define CODEPAGE_ISO8859_10 10    ///< ISO-8859-10 (Latin-6, Nordic)
+#define CODEPAGE_ISO8859_11 11    ///< ISO-8859-11 (Thai)
+#define CODEPAGE_ISO8859_13 13    ///< ISO-8859-13 (Latin-7, Baltic)
+#define CODEPAGE_ISO8859_14 14    ///< ISO-8859-14 (Latin-8, Celtic)
+#define CODEPAGE_ISO8859_15 15    ///< ISO-8859-15 (Latin-9)
+#define CODEPAGE_ISO8859_16 16    ///< ISO-8859-16 (Latin-10, South-Eastern European)
+#define CODEPAGE_CP437      17    ///< DOS codepage 437 (US)
+#define CODEPAGE_CP850      18    ///< DOS codepage 850 (Western European)
+#define CODEPAGE_CP866      19    ///< DOS codepage 866 (Cyrillic)
+#define CODEPAGE_KOI8_R     20    ///< KOI8-R (Russian)
+#define CODEPAGE_KOI8_U     21    ///< KOI8-U (Ukrainian)
+#define CODEPAGE_WIN1252    22    ///< Windows-1252 (Western European)
+#define CODEPAGE_MAX        22    ///< Highest built in codepage ID
+
+__DECL_START
+
+/**
+ * @brief Creates a codepage from a decoding table
+ *
+ * The table is either 256 entries, covering every octet, or 128 entries, covering octets 0x80
+ * to 0xFF with ASCII below that. An entry of 0 means the octet is undefined, except for octet 0
+ * @param table the table mapping octets to characters
+ * @param size the number of entries in table, either 128 or 256
+ * @return The new codepage, or NULL if table is invalid
+ */
+LIBNEX_PUBLIC Codepage_t* CodepageCreate (const char32_t* table, size_t size);
+
+/**
+ * @brief Destroys a codepage created by CodepageCreate
+ * @param cp the codepage to destroy
+ */
+LIBNEX_PUBLIC void CodepageDestroy (Codepage_t* cp);
+
+/**
+ * @brief Gets a built in codepage
+ *
+ * The codepage is created on first use, and must not be destroyed
+ * @param id the CODEPAGE_* ID of the codepage
+ * @return The codepage, or NULL if id isn't a built in codepage
+ */
+LIBNEX_PUBLIC const Codepage_t* CodepageGet (int id);
+
+/**
+ * @brief Gets the ID of a built in codepage from its IANA name
+ * @param name the name of the codepage, e.g., "ISO-8859-2" or "IBM437"
+ * @return The CODEPAGE_* ID, or 0 if name isn't a built in codepage
+ */
+LIBNEX_PUBLIC int CodepageGetId (const char* name);
+
+/**
+ * @brief Decodes a buffer of text in a codepage to UTF-32
+ *
+ * Every octet decodes to exactly one character. Undefined octets decode to U+FFFD
+ * @param cp the codepage to decode from
+ * @param out the buffer to write the characters out to. Must have room for len characters
+ * @param in buffer containing the text to decode
+ * @param len size of in
+ * @return the number of characters written to out, which is always len
+ */
+LIBNEX_PUBLIC size_t CodepageDecode (const Codepage_t* cp, char32_t* out, const uint8_t* in, size_t len);
+
+/**
+ * @brief Encodes a buffer of UTF-32 in a codepage
+ *
+ * Encoding stops at the first character that isn't in the codepage
+ * @param cp the codepage to encode in
+ * @param out the buffer to write the encoded text out to. Must have room for len octets
+ * @param in buffer containing the characters to encode
+ * @param len the number of characters in in
+ * @return the number of characters encoded
+ */
+LIBNEX_PUBLIC size_t CodepageEncode (const Codepage_t* cp, uint8_t* out, const char32_t* in, size_t len);
+
+__DECL_END
+
+#endif
@@ -21,6 +21,7 @@
 #ifndef _CONTAINER_H
 #define _CONTAINER_H
 
+#include <libnex/hash.h>
 #include <libnex/list.h>
 
 #endif
@@ -1,5 +1,5 @@
 /*
-    crc32.h - definitions to compute CRC32 checksum of buffer
+    crc32.h - definitions to compute CRC32, CRC32C, and CRC64 checksums of buffers
     Licensed under the CC0 license
     See https://creativecommons.org/publicdomain/zero/1.0/legalcode
 */
@@ -23,6 +23,131 @@ __DECL_START
  */
 LIBNEX_PUBLIC uint32_t Crc32Calc (const uint8_t* buf, size_t len);
 
+/**
+ * @brief Gets the initial state of an incremental CRC32 computation
+ * @return the initial state
+ */
+LIBNEX_PUBLIC uint32_t Crc32Init();
+
+/**
+ * @brief Updates an incremental CRC32 computation with more data
+ * @param crc the current state, from Crc32Init or a previous Crc32Update
+ * @param buf buffer containing the next piece of data
+ * @param len length of buf
+ * @return the new state
+ */
+LIBNEX_PUBLIC uint32_t Crc32Update (uint32_t crc, const uint8_t* buf, size_t len);
+
+/**
+ * @brief Finishes an incremental CRC32 computation
+ * @param crc the current state
+ * @return the CRC32 checksum of all data passed to Crc32Update
+ */
+LIBNEX_PUBLIC uint32_t Crc32Final (uint32_t crc);
+
+/**
+ * @brief Combines the CRC32 checksums of two adjacent pieces of data
+ * @param crcA checksum of the first piece
+ * @param crcB checksum of the second piece
+ * @param lenB length of the second piece
+ * @return the checksum of the first piece followed by the second
+ */
+LIBNEX_PUBLIC uint32_t Crc32Combine (uint32_t crcA, uint32_t crcB, uint64_t lenB);
+
+/**
+ * @brief Calculates the CRC32C (Castagnoli) checksum of buffer buf
+ * @param buf buffer to calculate checksum of
+ * @param len length of buf
+ * @return the CRC32C checksum
+ */
+LIBNEX_PUBLIC uint32_t Crc32cCalc (const uint8_t* buf, size_t len);
+
+/**
+ * @brief Gets the initial state of an incremental CRC32C computation
+ * @return the initial state
+ */
+LIBNEX_PUBLIC uint32_t Crc32cInit();
+
+/**
+ * @brief Updates an incremental CRC32C computation with more data
+ * @param crc the current state, from Crc32cInit or a previous Crc32cUpdate
+ * @param buf buffer containing the next piece of data
+ * @param len length of buf
+ * @return the new state
+ */
+LIBNEX_PUBLIC uint32_t Crc32cUpdate (uint32_t crc, const uint8_t* buf, size_t len);
+
+/**
+ * @brief Finishes an incremental CRC32C computation
+ * @param crc the current state
+ * @return the CRC32C checksum of all data passed to Crc32cUpdate
+ */
+LIBNEX_PUBLIC uint32_t Crc32cFinal (uint32_t crc);
+
+/**
+ * @brief Combines the CRC32C checksums of two adjacent pieces of data
+ * @param crcA checksum of the first piece
+ * @param crcB checksum of the second piece
+ * @param lenB length of the second piece
+ * @return the checksum of the first piece followed by the second
+ */
+LIBNEX_PUBLIC uint32_t Crc32cCombine (uint32_t crcA, uint32_t crcB, uint64_t lenB);
+
+/**
+ * @brief Calculates the CRC64 checksum of buffer buf
+ *
+ * This is the ECMA-182 polynomial in reflected form, as used by XZ
+ * @param buf buffer to calculate checksum of
+ * @param len length of buf
+ * @return the CRC64 checksum
+ */
+LIBNEX_PUBLIC uint64_t Crc64Calc (const uint8_t* buf, size_t len);
+
+/**
+ * @brief Gets the initial state of an incremental CRC64 computation
+ * @return the initial state
+ */
+LIBNEX_PUBLIC uint64_t Crc64Init();
+
+/**
+ * @brief Updates an incremental CRC64 computation with more data
+ * @param crc the current state, from Crc64Init or a previous Crc64Update
+ * @param buf buffer containing the next piece of data
+ * @param len length of buf
+ * @return the new state
+ */
+LIBNEX_PUBLIC uint64_t Crc64Update (uint64_t crc, const uint8_t* buf, size_t len);
+
+/**
+ * @brief Finishes an incremental CRC64 computation
+ * @param crc the current state
+ * @return the CRC64 checksum of all data passed to Crc64Update
+ */
+LIBNEX_PUBLIC uint64_t Crc64Final (uint64_t crc);
+
+/**
+ * @brief Combines the CRC64 checksums of two adjacent pieces of data
+ * @param crcA checksum of the first piece
+ * @param crcB checksum of the second piece
+ * @param lenB length of the second piece
+ * @return the checksum of the first piece followed by the second
+ */
+LIBNEX_PUBLIC uint64_t Crc64Combine (uint64_t crcA, uint64_t crcB, uint64_t lenB);
+
+#ifndef LIBNEX_BAREMETAL
+/**
+ * @brief Calculates the CRC32 checksum of buffer buf using multiple threads
+ *
+ * The buffer is split into one chunk per thread, and the chunks' checksums are merged
+ * with Crc32Combine. The result is the same as Crc32Calc. Small buffers use fewer threads
+ * @param buf buffer to calculate checksum of
+ * @param len length of buf
+ * @param nthreads maximum number of threads to use, including the calling thread
+ * @return the CRC32 checksum
+ */
+LIBNEX_PUBLIC uint32_t Crc32CalcParallel (const uint8_t* buf, size_t len, unsigned int nthreads);
+#endif
+
 __DECL_END
 
 #endif
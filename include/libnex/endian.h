@@ -23,20 +23,82 @@
 
 #include <libnex/libnex_config.h>
 #include <libnex/bits.h>
+#include <stddef.h>
 #include <stdint.h>
+#include <string.h>
 
 // Endian macro declarations
 #define ENDIAN_NONE   0    ///< No endian was detected
 #define ENDIAN_LITTLE 1    ///< Result is little endian
 #define ENDIAN_BIG    2    ///< Result is big endian
 
+// Determine the host's byte order at compile time if the compiler tells us
+#if defined __BYTE_ORDER__ && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define ENDIAN_HOST ENDIAN_LITTLE    ///< Byte order of the host
+#elif defined __BYTE_ORDER__ && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define ENDIAN_HOST ENDIAN_BIG
+#elif defined _MSC_VER
+#define ENDIAN_HOST ENDIAN_LITTLE    // Every target MSVC supports is little endian
+#endif
+
+/**
+ * @brief Swaps the endianess of a 16 bit value
+ * @param val the value to swap
+ * @return The swapped value
+ */
+#define EndianSwap16(val) ((uint16_t) (((val) << 8) | ((val) >> 8)))
+
+/**
+ * @brief Swaps the endianess of a 32 bit value
+ * @param val the value to swap
+ * @return The swapped value
+ */
+#define EndianSwap32(val)                                                                                   \
+    ((uint32_t) ((((val) >> 24) & 0x000000FF) | (((val) >> 8) & 0x0000FF00) | (((val) << 8) & 0x00FF0000) | \
+                 (((val) << 24) & 0xFF000000)))
+
+/**
+ * @brief Swaps the endianess of a 64 bit value
+ * @param val the value to swap
+ * @return The swapped value
+ */
+#define EndianSwap64(val)                                                          \
+    ((((val) << 56) & 0xFF00000000000000) | (((val) << 40) & 0x00FF000000000000) | \
+     (((val) << 24) & 0x0000FF0000000000) | (((val) << 8) & 0x000000FF00000000) |  \
+     (((val) >> 8) & 0x00000000FF000000) | (((val) >> 24) & 0x0000000000FF0000) |  \
+     (((val) >> 40) & 0x000000000000FF00) | (((val) >> 56) & 0x00000000000000FF))
+
+// The functions below are inline in the header so that the byte order check folds away.
+// endian.c defines LIBNEX_ENDIAN_OUTLINE to emit out of line copies for the exported symbols
+#ifdef LIBNEX_ENDIAN_OUTLINE
+#define __ENDIAN_FUNC LIBNEX_PUBLIC
+#else
+#define __ENDIAN_FUNC static inline
+#endif
+
 /**
  * @brief Gets the endianess of the host
  *
  * EndianHost() gets the endianess of the host, returning ENDIAN_BIG or ENDIAN_LITTLE
  * @return ENDIAN_BIG if host is big endian, ENDIAN_LITTLE if little endian
  */
-LIBNEX_PUBLIC char EndianHost();
+__ENDIAN_FUNC char EndianHost()
+{
+#ifdef ENDIAN_HOST
+    return ENDIAN_HOST;
+#else
+    // Declare a 16 bit value
+    uint16_t val = 0x9867;
+    // Cast to pointer so we can access the individual bytes
+    uint8_t* val8 = (uint8_t*) &val;
+    // Check what order the bytes are in
+    if (val8[0] == 0x98)
+        return ENDIAN_BIG;
+    else if (val8[0] == 0x67)
+        return ENDIAN_LITTLE;
+    return 0;
+#endif
+}
 
 /**
  * @brief Writes a 16 bit value with specified endianess
@@ -44,7 +106,17 @@ LIBNEX_PUBLIC char EndianHost();
  * @param val 16 bit value, in host's order
  * @param endian ENDIAN_BIG if writing big endian, ENDIAN_LITTLE if little endian
  */
-LIBNEX_PUBLIC int EndianWrite16 (uint16_t* buf, const uint16_t val, const char endian);
+__ENDIAN_FUNC int EndianWrite16 (uint16_t* buf, const uint16_t val, const char endian)
+{
+    if (!buf)
+        return 0;
+    // Swapping must occur is target endian and host endian are different
+    if (endian != EndianHost())
+        *buf = EndianSwap16 (val);
+    else
+        *buf = val;
+    return 1;
+}
 
 /**
  * @brief Writes a 32 bit value with specified endianess
@@ -52,7 +124,16 @@ LIBNEX_PUBLIC int EndianWrite16 (uint16_t* buf, const uint16_t val, const char e
  * @param val 32 bit value, in host's order
  * @param endian ENDIAN_BIG if writing big endian, ENDIAN_LITTLE if little endian
  */
-LIBNEX_PUBLIC int EndianWrite32 (uint32_t* buf, const uint32_t val, const char endian);
+__ENDIAN_FUNC int EndianWrite32 (uint32_t* buf, const uint32_t val, const char endian)
+{
+    if (!buf)
+        return 0;
+    if (endian != EndianHost())
+        *buf = EndianSwap32 (val);
+    else
+        *buf = val;
+    return 1;
+}
 
 /**
  * @brief Writes a 64 bit value with specified endianess
@@ -60,7 +141,16 @@ LIBNEX_PUBLIC int EndianWrite32 (uint32_t* buf, const uint32_t val, const char e
  * @param val 64 bit value, in host's order
  * @param endian ENDIAN_BIG if writing big endian, ENDIAN_LITTLE if little endian
  */
-LIBNEX_PUBLIC int EndianWrite64 (uint64_t* buf, const uint64_t val, const char endian);
+__ENDIAN_FUNC int EndianWrite64 (uint64_t* buf, const uint64_t val, const char endian)
+{
+    if (!buf)
+        return 0;
+    if (endian != EndianHost())
+        *buf = EndianSwap64 (val);
+    else
+        *buf = val;
+    return 1;
+}
 
 /**
  * @brief Reads a 16 bit value with specified endianess
@@ -68,7 +158,15 @@ LIBNEX_PUBLIC int EndianWrite64 (uint64_t* buf, const uint64_t val, const char e
  * @param endian ENDIAN_BIG if reading big endian, ENDIAN_LITTLE if little endian
  * @return the value in the host's order
  */
-LIBNEX_PUBLIC uint16_t EndianRead16 (const uint16_t* buf, const char endian);
+__ENDIAN_FUNC uint16_t EndianRead16 (const uint16_t* buf, const char endian)
+{
+    if (!buf)
+        return 0;
+    if (endian != EndianHost())
+        return EndianSwap16 (*buf);
+    else
+        return *buf;
+}
 
 /**
  * @brief Reads a 32 bit value with specified endianess
@@ -76,7 +174,15 @@ LIBNEX_PUBLIC uint16_t EndianRead16 (const uint16_t* buf, const char endian);
  * @param endian ENDIAN_BIG if reading big endian, ENDIAN_LITTLE if little endian
  * @return the value in the host's order
  */
-LIBNEX_PUBLIC uint32_t EndianRead32 (const uint32_t* buf, const char endian);
+__ENDIAN_FUNC uint32_t EndianRead32 (const uint32_t* buf, const char endian)
+{
+    if (!buf)
+        return 0;
+    if (endian != EndianHost())
+        return EndianSwap32 (*buf);
+    else
+        return *buf;
+}
 
 /**
  * @brief Reads a 64 bit value with specified endianess
@@ -84,7 +190,15 @@ LIBNEX_PUBLIC uint32_t EndianRead32 (const uint32_t* buf, const char endian);
  * @param endian ENDIAN_BIG if reading big endian, ENDIAN_LITTLE if little endian
  * @return the value in the host's order
  */
-LIBNEX_PUBLIC uint64_t EndianRead64 (const uint64_t* buf, const char endian);
+__ENDIAN_FUNC uint64_t EndianRead64 (const uint64_t* buf, const char endian)
+{
+    if (!buf)
+        return 0;
+    if (endian != EndianHost())
+        return EndianSwap64 (*buf);
+    else
+        return *buf;
+}
 
 /**
  * @brief Changes a 16 bit value to specified endian
@@ -92,7 +206,13 @@ LIBNEX_PUBLIC uint64_t EndianRead64 (const uint64_t* buf, const char endian);
  * @param endian ENDIAN_BIG if returning big endian, ENDIAN_LITTLE if little endian
  * @return the changed value
  */
-LIBNEX_PUBLIC uint16_t EndianChange16 (uint16_t val, const char endian);
+__ENDIAN_FUNC uint16_t EndianChange16 (uint16_t val, const char endian)
+{
+    if (endian != EndianHost())
+        return EndianSwap16 (val);
+    else
+        return val;
+}
 
 /**
  * @brief Changes a 32 bit value to specified endian
@@ -100,7 +220,13 @@ LIBNEX_PUBLIC uint16_t EndianChange16 (uint16_t val, const char endian);
  * @param endian ENDIAN_BIG if returning big endian, ENDIAN_LITTLE if little endian
  * @return the changed value
  */
-LIBNEX_PUBLIC uint32_t EndianChange32 (uint32_t val, const char endian);
+__ENDIAN_FUNC uint32_t EndianChange32 (uint32_t val, const char endian)
+{
+    if (endian != EndianHost())
+        return EndianSwap32 (val);
+    else
+        return val;
+}
 
 /**
  * @brief Changes a 64 bit value to specified endian
@@ -108,33 +234,150 @@ LIBNEX_PUBLIC uint32_t EndianChange32 (uint32_t val, const char endian);
  * @param endian ENDIAN_BIG if returning big endian, ENDIAN_LITTLE if little endian
  * @return the changed value
  */
-LIBNEX_PUBLIC uint64_t EndianChange64 (uint64_t val, const char endian);
+__ENDIAN_FUNC uint64_t EndianChange64 (uint64_t val, const char endian)
+{
+    if (endian != EndianHost())
+        return EndianSwap64 (val);
+    else
+        return val;
+}
 
 /**
- * @brief Swaps the endianess of a 16 bit value
- * @param val the value to swap
- * @return The swapped value
+ * @brief Loads a 16 bit value with specified endianess from any address
+ *
+ * Unlike EndianRead16, buf need not be aligned. This compiles to a single load, plus a swap if needed
+ * @param buf the address to load from
+ * @param endian ENDIAN_BIG if loading big endian, ENDIAN_LITTLE if little endian
+ * @return the value in the host's order
  */
-#define EndianSwap16(val) ((uint16_t) (((val) << 8) | ((val) >> 8)))
+__ENDIAN_FUNC uint16_t EndianLoad16 (const void* buf, const char endian)
+{
+    uint16_t val;
+    memcpy (&val, buf, sizeof (uint16_t));
+    return (endian != EndianHost()) ? EndianSwap16 (val) : val;
+}
 
 /**
- * @brief Swaps the endianess of a 32 bit value
- * @param val the value to swap
- * @return The swapped value
+ * @brief Loads a 32 bit value with specified endianess from any address
+ * @param buf the address to load from
+ * @param endian ENDIAN_BIG if loading big endian, ENDIAN_LITTLE if little endian
+ * @return the value in the host's order
  */
-#define EndianSwap32(val)                                                                                   \
-    ((uint32_t) ((((val) >> 24) & 0x000000FF) | (((val) >> 8) & 0x0000FF00) | (((val) << 8) & 0x00FF0000) | \
-                 (((val) << 24) & 0xFF000000)))
+__ENDIAN_FUNC uint32_t EndianLoad32 (const void* buf, const char endian)
+{
+    uint32_t val;
+    memcpy (&val, buf, sizeof (uint32_t));
+    return (endian != EndianHost()) ? EndianSwap32 (val) : val;
+}
 
 /**
- * @brief Swaps the endianess of a 64 bit value
- * @param val the value to swap
- * @return The swapped value
+ * @brief Loads a 64 bit value with specified endianess from any address
+ * @param buf the address to load from
+ * @param endian ENDIAN_BIG if loading big endian, ENDIAN_LITTLE if little endian
+ * @return the value in the host's order
  */
-#define EndianSwap64(val)                                                          \
-    ((((val) << 56) & 0xFF00000000000000) | (((val) << 40) & 0x00FF000000000000) | \
-     (((val) << 24) & 0x0000FF0000000000) | (((val) << 8) & 0x000000FF00000000) |  \
-     (((val) >> 8) & 0x00000000FF000000) | (((val) >> 24) & 0x0000000000FF0000) |  \
-     (((val) >> 40) & 0x000000000000FF00) | ((val) >> 56) & 0x00000000000000FF)
+__ENDIAN_FUNC uint64_t EndianLoad64 (const void* buf, const char endian)
+{
+    uint64_t val;
+    memcpy (&val, buf, sizeof (uint64_t));
+    return (endian != EndianHost()) ? EndianSwap64 (val) : val;
+}
+
+/**
+ * @brief Stores a 16 bit value with specified endianess to any address
+ *
+ * Unlike EndianWrite16, buf need not be aligned
+ * @param buf the address to store to
+ * @param val 16 bit value, in host's order
+ * @param endian ENDIAN_BIG if storing big endian, ENDIAN_LITTLE if little endian
+ */
+__ENDIAN_FUNC void EndianStore16 (void* buf, uint16_t val, const char endian)
+{
+    if (endian != EndianHost())
+        val = EndianSwap16 (val);
+    memcpy (buf, &val, sizeof (uint16_t));
+}
+
+/**
+ * @brief Stores a 32 bit value with specified endianess to any address
+ * @param buf the address to store to
+ * @param val 32 bit value, in host's order
+ * @param endian ENDIAN_BIG if storing big endian, ENDIAN_LITTLE if little endian
+ */
+__ENDIAN_FUNC void EndianStore32 (void* buf, uint32_t val, const char endian)
+{
+    if (endian != EndianHost())
+        val = EndianSwap32 (val);
+    memcpy (buf, &val, sizeof (uint32_t));
+}
+
+/**
+ * @brief Stores a 64 bit value with specified endianess to any address
+ * @param buf the address to store to
+ * @param val 64 bit value, in host's order
+ * @param endian ENDIAN_BIG if storing big endian, ENDIAN_LITTLE if little endian
+ */
+__ENDIAN_FUNC void EndianStore64 (void* buf, uint64_t val, const char endian)
+{
+    if (endian != EndianHost())
+        val = EndianSwap64 (val);
+    memcpy (buf, &val, sizeof (uint64_t));
+}
+
+/**
+ * @brief Swaps the endianess of a buffer of 16 bit values
+ *
+ * Uses SIMD instructions where the CPU supports them. dst and src may be the same buffer,
+ * but must not otherwise overlap. Neither needs to be aligned
+ * @param dst the buffer to write the swapped values to
+ * @param src the buffer to read values from
+ * @param count the number of values in src
+ */
+LIBNEX_PUBLIC void EndianSwapBuf16 (void* dst, const void* src, size_t count);
+
+/**
+ * @brief Swaps the endianess of a buffer of 32 bit values
+ * @param dst the buffer to write the swapped values to
+ * @param src the buffer to read values from
+ * @param count the number of values in src
+ */
+LIBNEX_PUBLIC void EndianSwapBuf32 (void* dst, const void* src, size_t count);
+
+/**
+ * @brief Swaps the endianess of a buffer of 64 bit values
+ * @param dst the buffer to write the swapped values to
+ * @param src the buffer to read values from
+ * @param count the number of values in src
+ */
+LIBNEX_PUBLIC void EndianSwapBuf64 (void* dst, const void* src, size_t count);
+
+/**
+ * @brief Converts a buffer of 16 bit values between host order and the specified endian
+ *
+ * If endian is the host's order, the values are copied unchanged
+ * @param dst the buffer to write the converted values to
+ * @param src the buffer to read values from
+ * @param count the number of values in src
+ * @param endian ENDIAN_BIG or ENDIAN_LITTLE
+ */
+LIBNEX_PUBLIC void EndianConvertBuf16 (void* dst, const void* src, size_t count, const char endian);
+
+/**
+ * @brief Converts a buffer of 32 bit values between host order and the specified endian
+ * @param dst the buffer to write the converted values to
+ * @param src the buffer to read values from
+ * @param count the number of values in src
+ * @param endian ENDIAN_BIG or ENDIAN_LITTLE
+ */
+LIBNEX_PUBLIC void EndianConvertBuf32 (void* dst, const void* src, size_t count, const char endian);
+
+/**
+ * @brief Converts a buffer of 64 bit values between host order and the specified endian
+ * @param dst the buffer to write the converted values to
+ * @param src the buffer to read values from
+ * @param count the number of values in src
+ * @param endian ENDIAN_BIG or ENDIAN_LITTLE
+ */
+LIBNEX_PUBLIC void EndianConvertBuf64 (void* dst, const void* src, size_t count, const char endian);
 
 #endif
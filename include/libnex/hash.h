@@ -21,9 +21,70 @@
 
 #include <libnex/decls.h>
 #include <libnex/libnex_config.h>
+#include <libnex/object.h>
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 
+/// Callback type that destroys the data of a hash entry
+typedef void (*HashEntryDestroy) (void* data);
+
+/**
+ * @brief Describes an entry in a hash table
+ *
+ * Entries are chained together in buckets. The key is not copied, meaning
+ * that it must remain valid for as long as the entry is in the table
+ */
+typedef struct _HashEntry
+{
+    const void* key;            ///< Key that identifies this entry
+    size_t keyLen;              ///< Size of key in bytes
+    uint32_t hash;              ///< Cached hash of key
+    void* data;                 ///< Data associated with this entry
+    struct _HashEntry* next;    ///< Next entry in this bucket. NULL means end
+} HashEntry_t;
+
+/// Predicate that decides if a hash entry should be removed
+typedef bool (*HashEntryPred) (const HashEntry_t* entry, void* arg);
+
+/**
+ * @brief Describes a hash table
+ *
+ * When the table grows, a new bucket array is allocated. In incremental mode, entries
+ * are moved from oldBuckets to buckets a few buckets at a time on subsequent operations,
+ * so that no single operation pays for rehashing the whole table
+ */
+typedef struct _HashTable
+{
+    Object_t obj;                    ///< The underlying object
+    HashEntry_t** buckets;           ///< Current bucket array
+    size_t numBuckets;               ///< Number of buckets in buckets. Always a power of 2
+    HashEntry_t** oldBuckets;        ///< Bucket array being migrated from. NULL if not resizing
+    size_t numOldBuckets;            ///< Number of buckets in oldBuckets
+    size_t migratePos;               ///< Next bucket in oldBuckets to migrate
+    size_t numEntries;               ///< Number of entries in table
+    int flags;                       ///< Flags this table was created with
+    HashEntryDestroy destroyFunc;    ///< Function to destroy entry data with
+} HashTable_t;
+
+/**
+ * @brief Describes the state of a hash table, including any migration in progress
+ */
+typedef struct _HashStats
+{
+    size_t numEntries;       ///< Number of entries in the table
+    size_t numBuckets;       ///< Number of buckets in the current bucket array
+    size_t numOldBuckets;    ///< Number of buckets in the array being migrated from. 0 if not resizing
+    size_t bucketsLeft;      ///< Number of old buckets that still need migrating
+    bool isResizing;         ///< If a migration is in progress
+} HashStats_t;
+
+// Hash table flags
+#define HASH_FLAG_INCREMENTAL (1 << 0)    ///< Migrate buckets incrementally when growing
+
+#define HASH_DEFAULT_BUCKETS 16    ///< Default number of buckets
+#define HASH_MIGRATE_STEP    4     ///< Number of buckets migrated per operation in incremental mode
+
 __DECL_START
 
 /**
@@ -42,6 +103,102 @@ uint32_t HashCreateHash (const void* buf, size_t sz);
  */
 uint32_t HashCreateHashStr (const char* str);
 
+/**
+ * @brief Produces a 64-bit FNV-1a hash for a buffer
+ * @param buf buffer to compute hash of
+ * @param sz number of bytes to compute hash of
+ * @return The 64-bit FNV-1a hash
+ */
+LIBNEX_PUBLIC uint64_t HashCreateHash64 (const void* buf, size_t sz);
+
+/**
+ * @brief Creates a new hash table
+ * @param numBuckets the initial number of buckets. Rounded up to a power of 2.
+ * If 0, HASH_DEFAULT_BUCKETS is used
+ * @param flags HASH_FLAG_INCREMENTAL if growing should be spread across operations
+ * @return The new hash table, or NULL on failure
+ */
+LIBNEX_PUBLIC HashTable_t* HashCreate (size_t numBuckets, int flags);
+
+/**
+ * @brief Destroys a hash table
+ * Note that if other consumers are referencing this table still, it is not destroyed
+ * @param table the table to destroy
+ */
+LIBNEX_PUBLIC void HashDestroy (HashTable_t* table);
+
+/**
+ * @brief Sets callback that destroys the data of an entry
+ * @param table the table to set callback on
+ * @param func function to use to destroy
+ */
+LIBNEX_PUBLIC void HashSetDestroy (HashTable_t* table, HashEntryDestroy func);
+
+/**
+ * @brief Adds an entry to a hash table
+ *
+ * If the table needs to grow, then in incremental mode a new bucket array is allocated,
+ * and entries are migrated to it over the following operations. Otherwise, every entry is
+ * migrated before HashAdd returns
+ * @param table the table to add to
+ * @param key the key of the new entry. This is not copied
+ * @param keyLen the size of key in bytes
+ * @param data the data to associate with key
+ * @return The new entry, or NULL if key is already in the table or memory ran out
+ */
+LIBNEX_PUBLIC HashEntry_t* HashAdd (HashTable_t* table, const void* key, size_t keyLen, void* data);
+
+/**
+ * @brief Finds an entry in a hash table
+ * @param table the table to search in
+ * @param key the key to search for
+ * @param keyLen the size of key in bytes
+ * @return The entry, or NULL if it doesn't exist
+ */
+LIBNEX_PUBLIC HashEntry_t* HashFind (HashTable_t* table, const void* key, size_t keyLen);
+
+/**
+ * @brief Removes an entry from a hash table, destroying it
+ * @param table the table to remove from
+ * @param key the key of the entry to remove
+ * @param keyLen the size of key in bytes
+ * @return true if the entry was found and removed, false otherwise
+ */
+LIBNEX_PUBLIC bool HashRemove (HashTable_t* table, const void* key, size_t keyLen);
+
+/**
+ * @brief Removes every entry that a predicate matches, destroying them
+ * @param table the table to remove from
+ * @param pred predicate that returns true for entries that should be removed
+ * @param arg argument passed to pred
+ * @return The number of entries removed
+ */
+LIBNEX_PUBLIC size_t HashRemoveIf (HashTable_t* table, HashEntryPred pred, void* arg);
+
+/**
+ * @brief Migrates buckets of a resizing hash table
+ *
+ * This can be called from a background thread to finish a migration without
+ * slowing down other operations on the table
+ * @param table the table to migrate buckets in
+ * @param count the maximum number of buckets to migrate
+ * @return The number of buckets still left to migrate
+ */
+LIBNEX_PUBLIC size_t HashMigrate (HashTable_t* table, size_t count);
+
+/**
+ * @brief Gets the current state of a hash table
+ * @param table the table to get the state of
+ * @param stats structure to write the state to
+ */
+LIBNEX_PUBLIC void HashGetStats (HashTable_t* table, HashStats_t* stats);
+
 __DECL_END
 
+#define HashRef(item)        (ObjRef (&(item)->obj))                   ///< References the underlying object
+#define HashLock(item)       (ObjLock (&(item)->obj))                  ///< Locks this table
+#define HashUnlock(item)     (ObjUnlock (&(item)->obj))                ///< Unlocks the table
+#define HashIsResizing(item) ((item)->oldBuckets != NULL)              ///< Checks if a migration is in progress
+#define HashEntryData(entry) ((void*) ((entry)->data))                 ///< Helper to access entry data
+
 #endif
@@ -27,14 +27,20 @@
 #ifdef HAVE_C11_THREADS
 #include <threads.h>
 typedef mtx_t lock_t;
+typedef once_flag once_t;
+#define ONCE_INIT ONCE_FLAG_INIT
 #elif defined HAVE_PTHREADS
 #include <pthread.h>
 typedef pthread_mutex_t lock_t;
+typedef pthread_once_t once_t;
+#define ONCE_INIT PTHREAD_ONCE_INIT
 #else
 #ifndef LIBNEX_BAREMETAL
 #error Target platform has no supported supported threading library
 #endif
 typedef char lock_t;
+typedef char once_t;
+#define ONCE_INIT 0
 #endif
 
 #ifdef IN_LIBNEX
@@ -72,6 +78,15 @@ void __Libnex_lock_unlock (lock_t* lock);
  */
 void __Libnex_lock_destroy (lock_t* lock);
 
+/**
+ * @brief Runs a function exactly once
+ *
+ * Wraps over call_once or pthread_once. Every caller returns after func has finished
+ * @param once the flag tracking if func has run. Must be initialized to ONCE_INIT
+ * @param func the function to run
+ */
+void __Libnex_once (once_t* once, void (*func) (void));
+
 #endif
 
 #endif
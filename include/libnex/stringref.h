@@ -22,9 +22,11 @@
 #define _STRINGREF_H
 
 #include <libnex/decls.h>
+#include <libnex/hash.h>
 #include <libnex/libnex_config.h>
 #include <libnex/object.h>
 #include <stdbool.h>
+#include <stddef.h>
 
 // String reference type
 typedef struct _strref
@@ -38,6 +40,18 @@ typedef struct _strref
 /// Macro to help avoid confusion for using stringRef on char32_t strings
 #define StringRef32_t StringRef_t
 
+/**
+ * @brief Pool of interned strings
+ *
+ * Maps string contents to one canonical StringRef_t, so that equal strings share storage
+ * and can be compared by pointer. The pool holds one reference on every string in it
+ */
+typedef struct _strrefpool
+{
+    Object_t obj;          ///< Underlying object
+    HashTable_t* table;    ///< Maps string contents to StringRef_t's
+} StrRefPool_t;
+
 __DECL_START
 
 /**
@@ -77,6 +91,50 @@ static inline StringRef_t* StrRefNew (const StringRef_t* ref)
  */
 #define StrRefNoFree(ref) ((ref)->doFree = false)
 
+/**
+ * @brief Creates a string interning pool
+ * @return The new pool, or NULL on failure
+ */
+LIBNEX_PUBLIC StrRefPool_t* StrRefPoolCreate();
+
+/**
+ * @brief Destroys a string interning pool
+ * Strings still referenced outside of the pool stay valid until their last reference is destroyed
+ * @param pool the pool to destroy
+ */
+LIBNEX_PUBLIC void StrRefPoolDestroy (StrRefPool_t* pool);
+
+/**
+ * @brief Gets the canonical reference for a buffer's contents
+ *
+ * If the contents aren't in the pool yet, they are copied into a new string, which is
+ * terminated with a null char32_t, so that both char and char32_t strings can be interned.
+ * This function is safe to call from multiple threads at once
+ * @param pool the pool to intern in
+ * @param s the contents to intern
+ * @param sz the size of s in bytes, not including any terminator
+ * @return A new reference to the canonical string. Pass it to StrRefDestroy when done
+ */
+LIBNEX_PUBLIC StringRef_t* StrRefInternBuf (StrRefPool_t* pool, const void* s, size_t sz);
+
+/**
+ * @brief Gets the canonical reference for a string
+ * @param pool the pool to intern in
+ * @param s the string to intern
+ * @return A new reference to the canonical string. Pass it to StrRefDestroy when done
+ */
+LIBNEX_PUBLIC StringRef_t* StrRefIntern (StrRefPool_t* pool, const char* s);
+
+/**
+ * @brief Evicts strings that are no longer referenced outside of the pool
+ * @param pool the pool to clean up
+ * @return The number of strings evicted
+ */
+LIBNEX_PUBLIC size_t StrRefPoolPurge (StrRefPool_t* pool);
+
+#define StrRefPoolLock(item)   (ObjLock (&(item)->obj))      ///< Locks this pool
+#define StrRefPoolUnlock(item) (ObjUnlock (&(item)->obj))    ///< Unlocks this pool
+
 __DECL_END
 
 #endif
@@ -22,6 +22,7 @@
 #define _TEXTSTREAM_H
 
 #include <libnex/char32.h>
+#include <libnex/codepage.h>
 #include <libnex/decls.h>
 #include <libnex/object.h>
 #include <libnex/unicode.h>
@@ -36,6 +37,11 @@
 #define TEXT_ENC_UTF8    3    ///< File is encoded in UTF-8
 #define TEXT_ENC_UTF16   4    ///< File is encoded in UTF-16
 #define TEXT_ENC_UTF32   5    ///< File is encoded in UTF-32
+#define TEXT_ENC_AUTO    6    ///< Detect the encoding with TextDetectEncoding. Only valid for reading
+
+#define TEXT_ENC_CODEPAGE_BASE 16    ///< Encodings above this are built in codepages
+/// Gets the encoding of the built in codepage with CODEPAGE_* ID id
+#define TEXT_ENC_CODEPAGE(id) (TEXT_ENC_CODEPAGE_BASE + (id))
 
 // Valid orderings
 #define TEXT_ORDER_NONE 0    ///< No ordering. This is used for single byte sets (like ASCII)
@@ -56,6 +62,10 @@
 #define TEXT_BUF_TOO_SMALL     6    ///< Character won't fit in buffer
 #define TEXT_INVALID_ENC       7    ///< Encoding not supported
 
+#define TEXT_DEFAULT_BUFSZ 4096             ///< Default size of the staging buffer
+#define TEXT_MIN_BUFSZ     16               ///< Smallest allowed staging buffer. Fits any encoded character
+#define TEXT_MAX_BUFSZ     (1024 * 1024)    ///< Size adaptive staging buffers grow up to
+
 __DECL_START
 
 /**
@@ -67,17 +77,29 @@ __DECL_START
  */
 typedef struct _TextStream
 {
-    Object_t obj;      // The object for this stream
-    FILE* file;        // Pointer to underlying file object
-    uint8_t* buf;      // Buffer to use for staging
-    size_t bufSize;    // Size of above buffer
-    size_t bufPos;     // Read position within buffer. Used only for reading
-    char encoding;     // Underlying encoding of the stream
-    char order;        // Order of bytes for multi byte character sets
-    char mode;         // Mode used to open text stream
-    bool isEof;        // Contains if EOF was reached
+    Object_t obj;                  // The object for this stream
+    FILE* file;                    // Pointer to underlying file object
+    uint8_t* buf;                  // Buffer to use for staging
+    size_t bufSize;                // Size of above buffer
+    size_t bufCap;                 // Allocated size of above buffer
+    size_t bufPos;                 // Read position within buffer. Used only for reading
+    char encoding;                 // Underlying encoding of the stream
+    char order;                    // Order of bytes for multi byte character sets
+    char mode;                     // Mode used to open text stream
+    bool isEof;                    // Contains if EOF was reached
+    bool isAdaptive;               // If the buffer grows as the stream is read
+    const Codepage_t* codepage;    // Codepage to decode single byte sets with
 } TextStream_t;
 
+/**
+ * @brief Options for opening a text stream with TextOpenEx
+ */
+typedef struct _TextOptions
+{
+    size_t bufSize;     ///< Size of the staging buffer. Must be at least TEXT_MIN_BUFSZ
+    bool isAdaptive;    ///< If set, the staging buffer doubles each time a read fills it, up to TEXT_MAX_BUFSZ
+} TextOptions_t;
+
 /**
  * @brief Opens a up a text stream
  *
@@ -86,6 +108,8 @@ typedef struct _TextStream
  *
  * @param[in] name specifies the file name to open
  * @param[in] mode the opening mode
+ * @param[in] encoding the encoding of the stream. If TEXT_ENC_AUTO, the encoding is detected from the
+ * start of the file, and hasBom is ignored
  * @param[in] hasBom if the specified stream has a BOM. Only used if mode is append or read
  * @param[in] order the byte order of the stream, either TEXT_ORDER_LE of TEXT_ORDER_BE. Only used if
  * mode is write
@@ -99,6 +123,29 @@ LIBNEX_PUBLIC short TextOpen (const char* file,
                               bool hasBom,
                               char order);
 
+/**
+ * @brief Opens up a text stream with the specified options
+ *
+ * TextOpenEx is like TextOpen, but lets the size of the staging buffer be picked. Since the stream
+ * does its own staging, the underlying C FILE object is left unbuffered
+ *
+ * @param[in] name specifies the file name to open
+ * @param[out] stream result variable to put the stream in
+ * @param[in] mode the opening mode
+ * @param[in] encoding the encoding of the stream, as in TextOpen
+ * @param[in] hasBom if the specified stream has a BOM, as in TextOpen
+ * @param[in] order the byte order of the stream, as in TextOpen
+ * @param[in] opts the options to open the stream with, or NULL for the defaults
+ * @return TEXT_SUCCESS, otherwise, an error code
+ */
+LIBNEX_PUBLIC short TextOpenEx (const char* file,
+                                TextStream_t** stream,
+                                char mode,
+                                char encoding,
+                                bool hasBom,
+                                char order,
+                                const TextOptions_t* opts);
+
 /**
  * @brief Closes a text stream
  *
@@ -143,10 +190,14 @@ LIBNEX_PUBLIC short TextReadChar (TextStream_t* stream, char32_t* c);
  * Data is intially read into a staging buffer, and then the staging buffer is
  * decoded into the main buffer specified by buf
  *
+ * The line terminator is kept at the end of buf. CR and CR LF both end a line, and are
+ * turned into a single LF, so a whole line always ends in '\n'. The last line of a file without
+ * a terminator, and a line longer than count - 1 characters, end without one
+ *
  * @param[in] stream the stream to read from
  * @param[out] buf a buffer of char32_t's to decode into
- * @param[in] count the max number of char32_t's to decode
- * @param[out] charsRead the number or characters read
+ * @param[in] count the max number of char32_t's to decode plus a null terminator
+ * @param[out] charsRead the number or characters read from the stream. Both characters of a CR LF count
  * @return a status code
  */
 LIBNEX_PUBLIC short TextReadLine (TextStream_t* stream, char32_t* buf, size_t count, size_t* charsRead);
@@ -180,6 +231,22 @@ LIBNEX_PUBLIC const char* TextError (int code);
  */
 LIBNEX_PUBLIC void TextGetEncId (const char* encName, char* enc, char* order);
 
+/**
+ * @brief Guesses the encoding of a buffer of text
+ *
+ * A BOM is trusted if there is one. Otherwise, UTF-32 and UTF-16 are spotted by where their zero
+ * octets lie, and then the text is validated as UTF-8. If all else fails, Windows-1252 is assumed.
+ * Only the first TEXT_DETECT_MAX octets of buf are looked at
+ * @param buf the start of the text
+ * @param len size of buf
+ * @param enc the numeric encoding ID pointer to write to
+ * @param order the byte order pointer to write to
+ * @return the size of the BOM at the start of buf, or 0 if there isn't one
+ */
+LIBNEX_PUBLIC size_t TextDetectEncoding (const uint8_t* buf, size_t len, char* enc, char* order);
+
+#define TEXT_DETECT_MAX 4096    ///< Maximum number of octets TextDetectEncoding looks at
+
 /**
  * @brief Flushes the contents of a text stream when the stream in a writing mode
  * @param stream the stream to flush
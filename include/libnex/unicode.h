@@ -44,10 +44,35 @@ typedef struct _utf8state
     uint8_t bytesLeft;        ///< The remaining number of bytes needed to finish processing
 } Utf8State_t;
 
+/**
+ * @brief The state of decoding a buffer of UTF-16
+ * Holds onto a surrogate pair that is split between two buffers
+ */
+typedef struct _utf16state
+{
+    uint16_t high;    ///< The high surrogate of the split pair
+    bool hasHigh;     ///< If a high surrogate is waiting on its low surrogate
+} Utf16State_t;
+
+/**
+ * @brief The state of validating UTF-8 that is split into chunks
+ * Initialize with UnicodeValidateInit8
+ */
+typedef struct _utf8validstate
+{
+    size_t offset;      ///< The number of octets passed in so far
+    uint8_t tail[3];    ///< A sequence that was cut off at the end of the last chunk
+    uint8_t tailLen;    ///< The number of octets in tail
+} Utf8ValidState_t;
+
+/// Initializes a validation state
+#define UnicodeValidateInit8(state) ((state).offset = 0, (state).tailLen = 0)
+
 #define UnicodeIsAccepted(state)  ((state).state == 6)     ///< Checks if state has been accepted
 #define UnicodeIsAcceptedP(state) ((state)->state == 6)    ///< Checks if state has been accepted
 #define UnicodeStateInit(state)   ((state).state = 0)      ///< Initializes a state structure
 #define UnicodeStateInitP(state)  ((state)->state = 0)     ///< Initiailzes a state structure by pointer
+#define UnicodeStateInit16(state) ((state).hasHigh = false)    ///< Initializes a UTF-16 state structure
 
 /**
  * @brief Decodes a UTF-16 character to UTF-32
@@ -59,6 +84,29 @@ typedef struct _utf8state
  */
 LIBNEX_PUBLIC size_t UnicodeDecode16 (char32_t* out, const uint16_t* in, size_t sz, char endian);
 
+/**
+ * @brief Decodes a buffer of UTF-16 to UTF-32
+ *
+ * Surrogates that aren't part of a pair are replaced with U+FFFD. Decoding stops when out is full
+ * or in runs out. If in ends with a high surrogate, it is kept in state and paired with the
+ * start of the next buffer. Without a state, it is left unconsumed instead
+ * @param out the buffer to write the characters out to
+ * @param outSz the number of characters out can hold
+ * @param in buffer containing the UTF-16 to decode
+ * @param inSz the number of 16 bit values in in
+ * @param endian the endianess of in, either ENDIAN_LITTLE or ENDIAN_BIG. If 0, the host's order is used
+ * @param state the state carried between buffers. Initialize with UnicodeStateInit16. May be NULL
+ * @param consumed set to the number of 16 bit values of in that were decoded. May be NULL
+ * @return the number of characters written to out
+ */
+LIBNEX_PUBLIC size_t UnicodeDecode16Buf (char32_t* out,
+                                         size_t outSz,
+                                         const uint16_t* in,
+                                         size_t inSz,
+                                         char endian,
+                                         Utf16State_t* state,
+                                         size_t* consumed);
+
 /**
  * @brief Encodes a UTF-32 character as UTF-16
  * @param out the buffer to write out the 16 bit values to
@@ -88,6 +136,108 @@ LIBNEX_PUBLIC size_t UnicodeDecodePart8 (char32_t* out, uint8_t in, Utf8State_t*
  */
 LIBNEX_PUBLIC size_t UnicodeDecode8 (char32_t* out, const uint8_t* in, size_t sz);
 
+/**
+ * @brief Decodes a buffer of UTF-8 to UTF-32
+ *
+ * Invalid sequences are replaced with U+FFFD the same way as decoding byte by byte with
+ * UnicodeDecodePart8. Decoding stops when out is full or in runs out. An incomplete sequence at
+ * the end of in is not consumed, so it can be passed again with more data
+ * @param out the buffer to write the characters out to
+ * @param outSz the number of characters out can hold
+ * @param in buffer containing the UTF-8 to decode
+ * @param inSz size of in
+ * @param consumed set to the number of octets of in that were decoded. May be NULL
+ * @return the number of characters written to out
+ */
+LIBNEX_PUBLIC size_t UnicodeDecode8Buf (char32_t* out,
+                                        size_t outSz,
+                                        const uint8_t* in,
+                                        size_t inSz,
+                                        size_t* consumed);
+
+/**
+ * @brief Counts the characters in a buffer of UTF-8, without decoding it
+ *
+ * Every octet that isn't a continuation is counted. For invalid UTF-8, this may differ from the
+ * number of characters that UnicodeDecode8Buf would output
+ * @param buf the buffer to count
+ * @param len size of buf
+ * @return the number of characters in buf
+ */
+LIBNEX_PUBLIC size_t UnicodeCount8 (const uint8_t* buf, size_t len);
+
+/**
+ * @brief Counts the characters in a buffer of UTF-16, without decoding it
+ *
+ * Every 16 bit value that isn't a low surrogate is counted. For invalid UTF-16, this may differ
+ * from the number of characters that UnicodeDecode16Buf would output
+ * @param buf the buffer to count
+ * @param len the number of 16 bit values in buf
+ * @param endian the endianess of buf, either ENDIAN_LITTLE or ENDIAN_BIG. If 0, the host's order is used
+ * @return the number of characters in buf
+ */
+LIBNEX_PUBLIC size_t UnicodeCount16 (const uint16_t* buf, size_t len, char endian);
+
+/**
+ * @brief Gets the exact size of a buffer of UTF-32 once encoded as UTF-8
+ *
+ * This is the same as UnicodeEncode8Buf with a NULL output buffer, so counting stops at
+ * the first character that can't be encoded
+ * @param buf the characters to measure
+ * @param len the number of characters in buf
+ * @return the number of octets needed
+ */
+LIBNEX_PUBLIC size_t UnicodeLength8 (const char32_t* buf, size_t len);
+
+/**
+ * @brief Gets the exact size of a buffer of UTF-32 once encoded as UTF-16
+ *
+ * Like UnicodeLength8, counting stops at the first character that can't be encoded
+ * @param buf the characters to measure
+ * @param len the number of characters in buf
+ * @return the number of 16 bit values needed
+ */
+LIBNEX_PUBLIC size_t UnicodeLength16 (const char32_t* buf, size_t len);
+
+/**
+ * @brief Checks if a buffer is valid UTF-8
+ *
+ * Unlike the decoders, this is strict. Overlong forms, surrogates, characters past U+10FFFF,
+ * and sequences cut off at the end of buf are all errors
+ * @param buf the buffer to check
+ * @param len size of buf
+ * @param errOffset set to the offset of the first octet of the first invalid sequence, or to len if
+ * buf is valid. May be NULL
+ * @return true if buf is valid, false otherwise
+ */
+LIBNEX_PUBLIC bool UnicodeValidate8 (const uint8_t* buf, size_t len, size_t* errOffset);
+
+/**
+ * @brief Checks if the next chunk of a larger buffer is valid UTF-8
+ *
+ * A sequence may be split between chunks. Once all chunks have been passed in,
+ * call UnicodeValidateFinish8 to check that the last one didn't cut off a sequence.
+ * Stop after the first error
+ * @param state the state of validation. Initialize with UnicodeValidateInit8
+ * @param buf the chunk to check
+ * @param len size of buf
+ * @param errOffset set to the offset of the first invalid sequence, counted from the start of the
+ * first chunk. May be NULL
+ * @return true if everything so far is valid, false otherwise
+ */
+LIBNEX_PUBLIC bool UnicodeValidatePart8 (Utf8ValidState_t* state,
+                                          const uint8_t* buf,
+                                          size_t len,
+                                          size_t* errOffset);
+
+/**
+ * @brief Finishes validating UTF-8 that was split into chunks
+ * @param state the state of validation
+ * @param errOffset set to the offset of a sequence cut off by the end of the last chunk. May be NULL
+ * @return true if all chunks together were valid, false otherwise
+ */
+LIBNEX_PUBLIC bool UnicodeValidateFinish8 (Utf8ValidState_t* state, size_t* errOffset);
+
 /**
  * @brief Encodes a UTF-32 character as UTF-8
  * @param out the buffer to write the encoded UTF-8 out to
@@ -96,6 +246,93 @@ LIBNEX_PUBLIC size_t UnicodeDecode8 (char32_t* out, const uint8_t* in, size_t sz
  */
 LIBNEX_PUBLIC size_t UnicodeEncode8 (uint8_t* out, char32_t in, size_t sz);
 
+/**
+ * @brief Encodes a buffer of UTF-32 as UTF-8
+ *
+ * Encoding stops at the first character that can't be encoded, or that doesn't fit in out
+ * @param out the buffer to write the UTF-8 out to. If NULL, nothing is written, and only the length
+ * of the encoded text is computed
+ * @param outSz size of out
+ * @param in buffer containing the characters to encode
+ * @param inSz the number of characters in in
+ * @param consumed set to the number of characters of in that were encoded. May be NULL
+ * @return the number of octets written to out, or that would be written if out is NULL
+ */
+LIBNEX_PUBLIC size_t UnicodeEncode8Buf (uint8_t* out,
+                                        size_t outSz,
+                                        const char32_t* in,
+                                        size_t inSz,
+                                        size_t* consumed);
+
+/**
+ * @brief Transcodes a buffer of UTF-16 directly to UTF-8
+ *
+ * Surrogates that aren't part of a pair are replaced with U+FFFD. Each 16 bit value takes at
+ * most 3 octets of UTF-8. A split surrogate pair is handled the same way as in UnicodeDecode16Buf
+ * @param out the buffer to write the UTF-8 out to. If NULL, nothing is written, and only the length
+ * of the transcoded text is computed
+ * @param outSz size of out
+ * @param in buffer containing the UTF-16 to transcode
+ * @param inSz the number of 16 bit values in in
+ * @param endian the endianess of in, either ENDIAN_LITTLE or ENDIAN_BIG. If 0, the host's order is used
+ * @param state the state carried between buffers. Initialize with UnicodeStateInit16. May be NULL
+ * @param consumed set to the number of 16 bit values of in that were transcoded. May be NULL
+ * @return the number of octets written to out, or that would be written if out is NULL
+ */
+LIBNEX_PUBLIC size_t UnicodeTranscode16To8 (uint8_t* out,
+                                            size_t outSz,
+                                            const uint16_t* in,
+                                            size_t inSz,
+                                            char endian,
+                                            Utf16State_t* state,
+                                            size_t* consumed);
+
+/**
+ * @brief Transcodes a buffer of UTF-8 directly to UTF-16
+ *
+ * Invalid sequences, and characters that can't be represented in UTF-16, are replaced with U+FFFD.
+ * Each octet takes at most one 16 bit value of UTF-16. An incomplete sequence at the end of in is
+ * not consumed, as in UnicodeDecode8Buf
+ * @param out the buffer to write the UTF-16 out to. If NULL, nothing is written, and only the length
+ * of the transcoded text is computed
+ * @param outSz the number of 16 bit values out can hold
+ * @param in buffer containing the UTF-8 to transcode
+ * @param inSz size of in
+ * @param endian the endianess to write out in, either ENDIAN_LITTLE or ENDIAN_BIG. If 0, the host's
+ * order is used
+ * @param consumed set to the number of octets of in that were transcoded. May be NULL
+ * @return the number of 16 bit values written to out, or that would be written if out is NULL
+ */
+LIBNEX_PUBLIC size_t UnicodeTranscode8To16 (uint16_t* out,
+                                            size_t outSz,
+                                            const uint8_t* in,
+                                            size_t inSz,
+                                            char endian,
+                                            size_t* consumed);
+
+/**
+ * @brief Decodes a buffer of Windows-1252 to UTF-32
+ *
+ * Every octet decodes to exactly one character. Octets that Windows-1252 leaves undefined
+ * decode to the C1 control with the same value
+ * @param out the buffer to write the characters out to. Must have room for len characters
+ * @param in buffer containing the Windows-1252 to decode
+ * @param len size of in
+ * @return the number of characters written to out, which is always len
+ */
+LIBNEX_PUBLIC size_t UnicodeDecodeWin1252 (char32_t* out, const uint8_t* in, size_t len);
+
+/**
+ * @brief Encodes a buffer of UTF-32 as Windows-1252
+ *
+ * Encoding stops at the first character that isn't in Windows-1252
+ * @param out the buffer to write the Windows-1252 out to. Must have room for len octets
+ * @param in buffer containing the characters to encode
+ * @param len the number of characters in in
+ * @return the number of characters encoded
+ */
+LIBNEX_PUBLIC size_t UnicodeEncodeWin1252 (uint8_t* out, const char32_t* in, size_t len);
+
 /**
  * @brief Writes out a UTF-8 byte order mark (BOM)
  * NOTE: You typically shouldn't need to use a BOM on UTF-8. This function is provided only
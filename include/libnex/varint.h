@@ -0,0 +1,189 @@
+/*
+    varint.h - contains variable length integer encoding interface
+    Copyright 2022 The NexNix Project
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    There should be a copy of the License distributed in a file named
+    LICENSE, if not, you may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/// @file varint.h
+
+#ifndef _VARINT_H
+#define _VARINT_H
+
+#include <libnex/decls.h>
+#include <libnex/libnex_config.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define VARINT_MAX_BYTES 10    ///< Maximum size of an encoded 64 bit value
+
+/**
+ * @brief Zigzag encodes a signed value, so that small negative values become small unsigned values
+ * @param val the int64_t to encode
+ * @return the encoded uint64_t
+ */
+#define VarintZigzagEncode(val) ((uint64_t) (((uint64_t) (val) << 1) ^ (uint64_t) ((int64_t) (val) >> 63)))
+
+/**
+ * @brief Decodes a zigzag encoded value
+ * @param val the uint64_t to decode
+ * @return the decoded int64_t
+ */
+#define VarintZigzagDecode(val) ((int64_t) (((uint64_t) (val) >> 1) ^ (0 - ((uint64_t) (val) & 1))))
+
+__DECL_START
+
+/**
+ * @brief Gets the encoded size of an unsigned value
+ * @param val the value to get the size of
+ * @return the number of bytes VarintEncodeU would write
+ */
+LIBNEX_PUBLIC size_t VarintSizeU (uint64_t val);
+
+/**
+ * @brief Gets the encoded size of a signed value
+ * @param val the value to get the size of
+ * @return the number of bytes VarintEncodeS would write
+ */
+LIBNEX_PUBLIC size_t VarintSizeS (int64_t val);
+
+/**
+ * @brief Encodes an unsigned value as ULEB128
+ * @param out the buffer to write to. Must have room for VARINT_MAX_BYTES bytes
+ * @param val the value to encode
+ * @return the number of bytes written
+ */
+LIBNEX_PUBLIC size_t VarintEncodeU (uint8_t* out, uint64_t val);
+
+/**
+ * @brief Encodes a signed value as SLEB128
+ * @param out the buffer to write to. Must have room for VARINT_MAX_BYTES bytes
+ * @param val the value to encode
+ * @return the number of bytes written
+ */
+LIBNEX_PUBLIC size_t VarintEncodeS (uint8_t* out, int64_t val);
+
+/**
+ * @brief Decodes a ULEB128 value
+ * @param in the buffer to decode from
+ * @param sz the size of in
+ * @param val pointer to write the value to
+ * @return the number of bytes read, or 0 if the value is truncated or doesn't fit in 64 bits
+ */
+LIBNEX_PUBLIC size_t VarintDecodeU (const uint8_t* in, size_t sz, uint64_t* val);
+
+/**
+ * @brief Decodes a SLEB128 value
+ * @param in the buffer to decode from
+ * @param sz the size of in
+ * @param val pointer to write the value to
+ * @return the number of bytes read, or 0 if the value is truncated or doesn't fit in 64 bits
+ */
+LIBNEX_PUBLIC size_t VarintDecodeS (const uint8_t* in, size_t sz, int64_t* val);
+
+/**
+ * @brief Encodes an array of unsigned values as ULEB128
+ * @param out the buffer to write to
+ * @param outSz the size of out
+ * @param in the values to encode
+ * @param count the number of values in in
+ * @param written pointer to write the number of bytes written to
+ * @return the number of values encoded. Less than count if out filled up
+ */
+LIBNEX_PUBLIC size_t VarintEncodeBufU (uint8_t* out,
+                                       size_t outSz,
+                                       const uint64_t* in,
+                                       size_t count,
+                                       size_t* written);
+
+/**
+ * @brief Encodes an array of signed values as SLEB128
+ * @param out the buffer to write to
+ * @param outSz the size of out
+ * @param in the values to encode
+ * @param count the number of values in in
+ * @param written pointer to write the number of bytes written to
+ * @return the number of values encoded. Less than count if out filled up
+ */
+LIBNEX_PUBLIC size_t VarintEncodeBufS (uint8_t* out,
+                                       size_t outSz,
+                                       const int64_t* in,
+                                       size_t count,
+                                       size_t* written);
+
+/**
+ * @brief Encodes an array of signed values as zigzag encoded ULEB128
+ * @param out the buffer to write to
+ * @param outSz the size of out
+ * @param in the values to encode
+ * @param count the number of values in in
+ * @param written pointer to write the number of bytes written to
+ * @return the number of values encoded. Less than count if out filled up
+ */
+LIBNEX_PUBLIC size_t VarintEncodeBufZ (uint8_t* out,
+                                       size_t outSz,
+                                       const int64_t* in,
+                                       size_t count,
+                                       size_t* written);
+
+/**
+ * @brief Decodes an array of ULEB128 values
+ *
+ * Decoding stops when count values have been decoded, or at a truncated or invalid value
+ * @param out the array to decode into
+ * @param count the number of values to decode
+ * @param in the buffer to decode from
+ * @param inSz the size of in
+ * @param consumed pointer to write the number of bytes read to
+ * @return the number of values decoded
+ */
+LIBNEX_PUBLIC size_t VarintDecodeBufU (uint64_t* out,
+                                       size_t count,
+                                       const uint8_t* in,
+                                       size_t inSz,
+                                       size_t* consumed);
+
+/**
+ * @brief Decodes an array of SLEB128 values
+ * @param out the array to decode into
+ * @param count the number of values to decode
+ * @param in the buffer to decode from
+ * @param inSz the size of in
+ * @param consumed pointer to write the number of bytes read to
+ * @return the number of values decoded
+ */
+LIBNEX_PUBLIC size_t VarintDecodeBufS (int64_t* out,
+                                       size_t count,
+                                       const uint8_t* in,
+                                       size_t inSz,
+                                       size_t* consumed);
+
+/**
+ * @brief Decodes an array of zigzag encoded ULEB128 values
+ * @param out the array to decode into
+ * @param count the number of values to decode
+ * @param in the buffer to decode from
+ * @param inSz the size of in
+ * @param consumed pointer to write the number of bytes read to
+ * @return the number of values decoded
+ */
+LIBNEX_PUBLIC size_t VarintDecodeBufZ (int64_t* out,
+                                       size_t count,
+                                       const uint8_t* in,
+                                       size_t inSz,
+                                       size_t* consumed);
+
+__DECL_END
+
+#endif
@@ -0,0 +1,248 @@
+/*
+    bloom.c - contains Bloom filter implementation
+    Copyright 2022 The NexNix Project
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    There should be a copy of the License distributed in a file named
+    LICENSE, if not, you may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/// @file bloom.c
+
+#include <assert.h>
+#include <libnex/bloom.h>
+#include <libnex/endian.h>
+#include <libnex/hash.h>
+#include <libnex/lock.h>
+#include <libnex/safemalloc.h>
+#include <stdlib.h>
+
+// Serialized header layout
+#define BLOOM_MAGIC    0x4642584E    // "NXBF" in little endian
+#define BLOOM_HDR_SIZE 24
+
+#define BLOOM_LN2 0.6931471805599453
+
+// Mixes up the bits of a hash, so that weak hashes still give independent probes
+// This is the finalizer from MurmurHash3
+static uint64_t bloomMix (uint64_t hash)
+{
+    hash ^= hash >> 33;
+    hash *= 0xFF51AFD7ED558CCDULL;
+    hash ^= hash >> 33;
+    hash *= 0xC4CEB9FE1A85EC53ULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+// Computes the base 2 logarithm of x without needing libm
+static double bloomLog2 (double x)
+{
+    double res = 0;
+    // Get x into [1, 2)
+    while (x < 1)
+    {
+        x *= 2;
+        res -= 1;
+    }
+    while (x >= 2)
+    {
+        x /= 2;
+        res += 1;
+    }
+    // Compute the fractional part bit by bit
+    double bit = 0.5;
+    for (int i = 0; i < 32; ++i)
+    {
+        x *= x;
+        if (x >= 2)
+        {
+            x /= 2;
+            res += bit;
+        }
+        bit /= 2;
+    }
+    return res;
+}
+
+LIBNEX_PUBLIC BloomFilter_t* BloomCreate (size_t numBits, unsigned int numProbes, int flags)
+{
+    if (!numBits || !numProbes || numProbes > BLOOM_MAX_PROBES)
+        return NULL;
+    BloomFilter_t* filter = calloc_s (sizeof (BloomFilter_t));
+    if (!filter)
+        return NULL;
+    // Round up to a whole number of blocks
+    filter->numBlocks = (numBits + BLOOM_BLOCK_BITS - 1) / BLOOM_BLOCK_BITS;
+    filter->numBits = filter->numBlocks * BLOOM_BLOCK_BITS;
+    filter->numProbes = numProbes;
+    filter->flags = flags;
+    filter->bits = calloc_s (filter->numBits / 8);
+    if (!filter->bits)
+    {
+        free (filter);
+        return NULL;
+    }
+    ObjCreate ("BloomFilter_t", &filter->obj);
+    return filter;
+}
+
+LIBNEX_PUBLIC BloomFilter_t* BloomCreateFp (size_t numItems, double fpRate, int flags)
+{
+    if (!numItems || fpRate <= 0 || fpRate >= 1)
+        return NULL;
+    // Optimal size is n * -log2(p) / ln(2) bits, with -log2(p) probes
+    double bitsPerItem = -bloomLog2 (fpRate);
+    size_t numBits = (size_t) ((double) numItems * bitsPerItem / BLOOM_LN2) + 1;
+    unsigned int numProbes = (unsigned int) (bitsPerItem + 0.5);
+    if (!numProbes)
+        numProbes = 1;
+    else if (numProbes > BLOOM_MAX_PROBES)
+        numProbes = BLOOM_MAX_PROBES;
+    return BloomCreate (numBits, numProbes, flags);
+}
+
+LIBNEX_PUBLIC void BloomDestroy (BloomFilter_t* filter)
+{
+    assert (filter);
+    BloomLock (filter);
+    if (!ObjDestroy (&filter->obj))
+    {
+        BloomUnlock (filter);
+        free (filter->bits);
+        free (filter);
+    }
+    else
+        BloomUnlock (filter);
+}
+
+// Gets the bit indices of an item
+static void bloomProbe (const BloomFilter_t* filter, uint64_t hash, size_t* probes)
+{
+    hash = bloomMix (hash);
+    if (filter->flags & BLOOM_FLAG_BLOCKED)
+    {
+        // High half picks the block, low half picks bits in the block.
+        // step is odd, so every probe in a block is distinct
+        size_t block = (size_t) (((hash >> 32) * filter->numBlocks) >> 32);
+        uint32_t pos = (uint32_t) hash;
+        uint32_t step = ((uint32_t) hash >> 9) | 1;
+        for (unsigned int i = 0; i < filter->numProbes; ++i)
+        {
+            probes[i] = (block * BLOOM_BLOCK_BITS) + (pos % BLOOM_BLOCK_BITS);
+            pos += step;
+        }
+    }
+    else
+    {
+        // Standard double hashing over the whole filter
+        uint64_t pos = (uint32_t) hash;
+        uint64_t step = hash >> 32;
+        for (unsigned int i = 0; i < filter->numProbes; ++i)
+        {
+            probes[i] = (size_t) (pos % filter->numBits);
+            pos += step;
+        }
+    }
+}
+
+LIBNEX_PUBLIC void BloomAddHash (BloomFilter_t* filter, uint64_t hash)
+{
+    assert (filter);
+    size_t probes[BLOOM_MAX_PROBES];
+    bloomProbe (filter, hash, probes);
+    BloomLock (filter);
+    for (unsigned int i = 0; i < filter->numProbes; ++i)
+        filter->bits[probes[i] / 64] |= (1ULL << (probes[i] % 64));
+    BloomUnlock (filter);
+}
+
+LIBNEX_PUBLIC bool BloomCheckHash (const BloomFilter_t* filter, uint64_t hash)
+{
+    assert (filter);
+    size_t probes[BLOOM_MAX_PROBES];
+    bloomProbe (filter, hash, probes);
+    for (unsigned int i = 0; i < filter->numProbes; ++i)
+    {
+        if (!(filter->bits[probes[i] / 64] & (1ULL << (probes[i] % 64))))
+            return false;
+    }
+    return true;
+}
+
+LIBNEX_PUBLIC void BloomAdd (BloomFilter_t* filter, const void* buf, size_t sz)
+{
+    BloomAddHash (filter, HashCreateHash64 (buf, sz));
+}
+
+LIBNEX_PUBLIC bool BloomCheck (const BloomFilter_t* filter, const void* buf, size_t sz)
+{
+    return BloomCheckHash (filter, HashCreateHash64 (buf, sz));
+}
+
+LIBNEX_PUBLIC bool BloomMerge (BloomFilter_t* dest, const BloomFilter_t* src)
+{
+    assert (dest && src);
+    // Ensure they are compatible
+    if (dest->numBits != src->numBits || dest->numProbes != src->numProbes || dest->flags != src->flags)
+        return false;
+    BloomLock (dest);
+    for (size_t i = 0; i < (dest->numBits / 64); ++i)
+        dest->bits[i] |= src->bits[i];
+    BloomUnlock (dest);
+    return true;
+}
+
+LIBNEX_PUBLIC size_t BloomSerializedSize (const BloomFilter_t* filter)
+{
+    assert (filter);
+    return BLOOM_HDR_SIZE + (filter->numBits / 8);
+}
+
+LIBNEX_PUBLIC size_t BloomSerialize (const BloomFilter_t* filter, uint8_t* buf, size_t sz)
+{
+    assert (filter && buf);
+    size_t needed = BloomSerializedSize (filter);
+    if (sz < needed)
+        return 0;
+    // Write out header
+    EndianStore32 (buf, BLOOM_MAGIC, ENDIAN_LITTLE);
+    EndianStore32 (buf + 4, (uint32_t) filter->flags, ENDIAN_LITTLE);
+    EndianStore32 (buf + 8, filter->numProbes, ENDIAN_LITTLE);
+    EndianStore32 (buf + 12, 0, ENDIAN_LITTLE);
+    EndianStore64 (buf + 16, filter->numBits, ENDIAN_LITTLE);
+    // Write out bit array
+    buf += BLOOM_HDR_SIZE;
+    for (size_t i = 0; i < (filter->numBits / 64); ++i)
+        EndianStore64 (buf + (i * 8), filter->bits[i], ENDIAN_LITTLE);
+    return needed;
+}
+
+LIBNEX_PUBLIC BloomFilter_t* BloomDeserialize (const uint8_t* buf, size_t sz)
+{
+    assert (buf);
+    if (sz < BLOOM_HDR_SIZE || EndianLoad32 (buf, ENDIAN_LITTLE) != BLOOM_MAGIC)
+        return NULL;
+    int flags = (int) EndianLoad32 (buf + 4, ENDIAN_LITTLE);
+    unsigned int numProbes = EndianLoad32 (buf + 8, ENDIAN_LITTLE);
+    uint64_t numBits = EndianLoad64 (buf + 16, ENDIAN_LITTLE);
+    // Validate the header against the buffer
+    if (!numBits || (numBits % BLOOM_BLOCK_BITS) || ((sz - BLOOM_HDR_SIZE) / 8) < (numBits / 64))
+        return NULL;
+    BloomFilter_t* filter = BloomCreate ((size_t) numBits, numProbes, flags);
+    if (!filter)
+        return NULL;
+    buf += BLOOM_HDR_SIZE;
+    for (size_t i = 0; i < (filter->numBits / 64); ++i)
+        filter->bits[i] = EndianLoad64 (buf + (i * 8), ENDIAN_LITTLE);
+    return filter;
+}
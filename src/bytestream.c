@@ -0,0 +1,446 @@
+/*
+    bytestream.c - contains functions to work with binary files
+    Copyright 2022 The NexNix Project
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    There should be a copy of the License distributed in a file named
+    LICENSE, if not, you may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/// @file bytestream.c
+
+#include "internal.h"
+#include <assert.h>
+#include <errno.h>
+#include <libnex/base.h>
+#include <libnex/bytestream.h>
+#include <libnex/endian.h>
+#include <libnex/varint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Makes sure at least need bytes are buffered, reading more in as needed.
+// Fewer may be buffered at end of file
+static short _byteFill (ByteStream_t* stream, size_t need)
+{
+    assert (stream && need <= stream->bufSize);
+    assert (stream->mode == BYTE_MODE_READ);
+    if ((stream->bufLen - stream->bufPos) >= need)
+        return BYTE_SUCCESS;
+    // Move what is left to the front, and read in after it
+    memmove (stream->buf, stream->buf + stream->bufPos, stream->bufLen - stream->bufPos);
+    stream->bufLen -= stream->bufPos;
+    stream->bufPos = 0;
+    while (stream->bufLen < need)
+    {
+        size_t bytesRead =
+            fread (stream->buf + stream->bufLen, 1, stream->bufSize - stream->bufLen, stream->file);
+        stream->bufLen += bytesRead;
+        if (bytesRead == 0)
+        {
+            if (ferror (stream->file))
+                return BYTE_SYS_ERROR;
+            stream->isEof = true;
+            break;
+        }
+    }
+    return BYTE_SUCCESS;
+}
+
+// Writes out the buffer
+static short _byteWriteFrame (ByteStream_t* stream)
+{
+    assert (stream);
+    assert (stream->mode != BYTE_MODE_READ);
+    if (fwrite (stream->buf, 1, stream->bufPos, stream->file) < stream->bufPos)
+        return BYTE_SYS_ERROR;
+    stream->bufPos = 0;
+    return BYTE_SUCCESS;
+}
+
+// Makes sure there is room for need bytes in the buffer
+static short _byteReserve (ByteStream_t* stream, size_t need)
+{
+    assert (need <= stream->bufSize);
+    if ((stream->bufSize - stream->bufPos) < need)
+        return _byteWriteFrame (stream);
+    return BYTE_SUCCESS;
+}
+
+// Grabs sz bytes for a typed read, returning a pointer to them in the buffer
+static short _byteReadValue (ByteStream_t* stream, size_t sz, const uint8_t** data)
+{
+    if (stream->mode != BYTE_MODE_READ)
+        return BYTE_INVALID_PARAMETER;
+    short res = _byteFill (stream, sz);
+    if (res != BYTE_SUCCESS)
+        return res;
+    if ((stream->bufLen - stream->bufPos) < sz)
+        return BYTE_EOF;
+    *data = stream->buf + stream->bufPos;
+    stream->bufPos += sz;
+    return BYTE_SUCCESS;
+}
+
+// Grabs sz bytes of room for a typed write, returning a pointer to them in the buffer
+static short _byteWriteValue (ByteStream_t* stream, size_t sz, uint8_t** data)
+{
+    if (stream->mode == BYTE_MODE_READ)
+        return BYTE_INVALID_PARAMETER;
+    short res = _byteReserve (stream, sz);
+    if (res != BYTE_SUCCESS)
+        return res;
+    *data = stream->buf + stream->bufPos;
+    stream->bufPos += sz;
+    return BYTE_SUCCESS;
+}
+
+LIBNEX_PUBLIC short ByteOpen (const char* file, ByteStream_t** stream, char mode)
+{
+    return ByteOpenEx (file, stream, mode, BYTE_DEFAULT_BUFSZ);
+}
+
+LIBNEX_PUBLIC short ByteOpenEx (const char* file, ByteStream_t** out, char mode, size_t bufSize)
+{
+    if (!file || !out || bufSize < BYTE_MIN_BUFSZ)
+        return BYTE_INVALID_PARAMETER;
+    // Figure out the mode
+    const char* fopenMode = NULL;
+    if (mode == BYTE_MODE_READ)
+        fopenMode = "rb";
+    else if (mode == BYTE_MODE_WRITE)
+        fopenMode = "wb";
+    else if (mode == BYTE_MODE_APPEND)
+        fopenMode = "ab";
+    else
+        return BYTE_INVALID_PARAMETER;
+    // Allocate the new stream
+    ByteStream_t* stream = (ByteStream_t*) malloc (sizeof (ByteStream_t));
+    if (!stream)
+        return BYTE_SYS_ERROR;
+    // Allocate the staging buffer
+    stream->buf = (uint8_t*) malloc (bufSize);
+    if (!stream->buf)
+    {
+        free (stream);
+        errno = ENOMEM;
+        return BYTE_SYS_ERROR;
+    }
+    stream->bufSize = bufSize;
+    stream->bufPos = 0;
+    stream->bufLen = 0;
+    stream->mode = mode;
+    stream->isEof = false;
+    // Open the file
+    stream->file = fopen (file, fopenMode);
+    if (!stream->file)
+    {
+        free (stream->buf);
+        free (stream);
+        return BYTE_SYS_ERROR;
+    }
+    ObjCreate ("ByteStream", &stream->obj);
+    *out = stream;
+    return BYTE_SUCCESS;
+}
+
+LIBNEX_PUBLIC short ByteFlush (ByteStream_t* stream)
+{
+    if (!stream || stream->mode == BYTE_MODE_READ)
+        return BYTE_INVALID_PARAMETER;
+    ByteLock (stream);
+    short res = _byteWriteFrame (stream);
+    if (res == BYTE_SUCCESS && fflush (stream->file))
+        res = BYTE_SYS_ERROR;
+    ByteUnlock (stream);
+    return res;
+}
+
+LIBNEX_PUBLIC short ByteClose (ByteStream_t* stream)
+{
+    if (!stream)
+        return BYTE_INVALID_PARAMETER;
+    short res = BYTE_SUCCESS;
+    // ObjDestroy takes the object lock itself, and destroys it with the last reference. After that this is
+    // the only owner left, so the stream is torn down without locking
+    if (!ObjDestroy (&stream->obj))
+    {
+        // Flush stream if in a write mode
+        if (stream->mode != BYTE_MODE_READ)
+            res = _byteWriteFrame (stream);
+        free (stream->buf);
+        if (fclose (stream->file))
+            res = BYTE_SYS_ERROR;
+        free (stream);
+    }
+    return res;
+}
+
+LIBNEX_PUBLIC short ByteRead (ByteStream_t* stream, void* buf, size_t sz, size_t* bytesRead)
+{
+    if (!stream || !buf || stream->mode != BYTE_MODE_READ)
+        return BYTE_INVALID_PARAMETER;
+    ByteLock (stream);
+    uint8_t* out = buf;
+    size_t done = 0;
+    short res = BYTE_SUCCESS;
+    while (done < sz)
+    {
+        // Copy out whatever is buffered
+        size_t avail = stream->bufLen - stream->bufPos;
+        if (avail)
+        {
+            size_t toCopy = (avail < (sz - done)) ? avail : (sz - done);
+            memcpy (out + done, stream->buf + stream->bufPos, toCopy);
+            stream->bufPos += toCopy;
+            done += toCopy;
+            continue;
+        }
+        if (stream->isEof)
+        {
+            res = BYTE_EOF;
+            break;
+        }
+        // Read big requests straight into the caller's buffer
+        if ((sz - done) >= stream->bufSize)
+        {
+            size_t want = sz - done;
+            size_t got = fread (out + done, 1, want, stream->file);
+            done += got;
+            if (got < want)
+            {
+                if (ferror (stream->file))
+                {
+                    res = BYTE_SYS_ERROR;
+                    break;
+                }
+                stream->isEof = true;
+            }
+            continue;
+        }
+        res = _byteFill (stream, 1);
+        if (res != BYTE_SUCCESS)
+            break;
+    }
+    if (bytesRead)
+        *bytesRead = done;
+    ByteUnlock (stream);
+    return res;
+}
+
+LIBNEX_PUBLIC short ByteWrite (ByteStream_t* stream, const void* buf, size_t sz)
+{
+    if (!stream || !buf || stream->mode == BYTE_MODE_READ)
+        return BYTE_INVALID_PARAMETER;
+    ByteLock (stream);
+    short res = BYTE_SUCCESS;
+    if (sz >= stream->bufSize)
+    {
+        // Write big requests straight out, after what is buffered
+        res = _byteWriteFrame (stream);
+        if (res == BYTE_SUCCESS && fwrite (buf, 1, sz, stream->file) < sz)
+            res = BYTE_SYS_ERROR;
+    }
+    else
+    {
+        res = _byteReserve (stream, sz);
+        if (res == BYTE_SUCCESS)
+        {
+            memcpy (stream->buf + stream->bufPos, buf, sz);
+            stream->bufPos += sz;
+        }
+    }
+    ByteUnlock (stream);
+    return res;
+}
+
+// Defines a typed read function
+#define BYTE_READ_FUNC(bits)                                                                        \
+    LIBNEX_PUBLIC short ByteReadU##bits (ByteStream_t* stream, uint##bits##_t* val, char endian)    \
+    {                                                                                               \
+        if (!stream || !val)                                                                        \
+            return BYTE_INVALID_PARAMETER;                                                          \
+        ByteLock (stream);                                                                          \
+        const uint8_t* data = NULL;                                                                 \
+        short res = _byteReadValue (stream, sizeof (uint##bits##_t), &data);                        \
+        if (res == BYTE_SUCCESS)                                                                    \
+            *val = EndianLoad##bits (data, endian);                                                 \
+        ByteUnlock (stream);                                                                        \
+        return res;                                                                                 \
+    }
+
+// Defines a typed write function
+#define BYTE_WRITE_FUNC(bits)                                                                       \
+    LIBNEX_PUBLIC short ByteWriteU##bits (ByteStream_t* stream, uint##bits##_t val, char endian)    \
+    {                                                                                               \
+        if (!stream)                                                                                \
+            return BYTE_INVALID_PARAMETER;                                                          \
+        ByteLock (stream);                                                                          \
+        uint8_t* data = NULL;                                                                       \
+        short res = _byteWriteValue (stream, sizeof (uint##bits##_t), &data);                       \
+        if (res == BYTE_SUCCESS)                                                                    \
+            EndianStore##bits (data, val, endian);                                                  \
+        ByteUnlock (stream);                                                                        \
+        return res;                                                                                 \
+    }
+
+BYTE_READ_FUNC (16)
+BYTE_READ_FUNC (32)
+BYTE_READ_FUNC (64)
+BYTE_WRITE_FUNC (16)
+BYTE_WRITE_FUNC (32)
+BYTE_WRITE_FUNC (64)
+
+LIBNEX_PUBLIC short ByteReadU8 (ByteStream_t* stream, uint8_t* val)
+{
+    if (!stream || !val)
+        return BYTE_INVALID_PARAMETER;
+    ByteLock (stream);
+    const uint8_t* data = NULL;
+    short res = _byteReadValue (stream, 1, &data);
+    if (res == BYTE_SUCCESS)
+        *val = *data;
+    ByteUnlock (stream);
+    return res;
+}
+
+LIBNEX_PUBLIC short ByteWriteU8 (ByteStream_t* stream, uint8_t val)
+{
+    if (!stream)
+        return BYTE_INVALID_PARAMETER;
+    ByteLock (stream);
+    uint8_t* data = NULL;
+    short res = _byteWriteValue (stream, 1, &data);
+    if (res == BYTE_SUCCESS)
+        *data = val;
+    ByteUnlock (stream);
+    return res;
+}
+
+// Reads a varint, either signed or unsigned
+static short _byteReadVar (ByteStream_t* stream, uint64_t* uval, int64_t* sval)
+{
+    if (stream->mode != BYTE_MODE_READ)
+        return BYTE_INVALID_PARAMETER;
+    short res = _byteFill (stream, VARINT_MAX_BYTES);
+    if (res != BYTE_SUCCESS)
+        return res;
+    const uint8_t* data = stream->buf + stream->bufPos;
+    size_t avail = stream->bufLen - stream->bufPos;
+    size_t len = uval ? VarintDecodeU (data, avail, uval) : VarintDecodeS (data, avail, sval);
+    if (!len)
+    {
+        // If we couldn't get a whole varint's worth of bytes, then the file ended in the middle of it
+        return (avail < VARINT_MAX_BYTES) ? BYTE_EOF : BYTE_BAD_VARINT;
+    }
+    stream->bufPos += len;
+    return BYTE_SUCCESS;
+}
+
+LIBNEX_PUBLIC short ByteReadVarU (ByteStream_t* stream, uint64_t* val)
+{
+    if (!stream || !val)
+        return BYTE_INVALID_PARAMETER;
+    ByteLock (stream);
+    short res = _byteReadVar (stream, val, NULL);
+    ByteUnlock (stream);
+    return res;
+}
+
+LIBNEX_PUBLIC short ByteReadVarS (ByteStream_t* stream, int64_t* val)
+{
+    if (!stream || !val)
+        return BYTE_INVALID_PARAMETER;
+    ByteLock (stream);
+    short res = _byteReadVar (stream, NULL, val);
+    ByteUnlock (stream);
+    return res;
+}
+
+LIBNEX_PUBLIC short ByteWriteVarU (ByteStream_t* stream, uint64_t val)
+{
+    if (!stream || stream->mode == BYTE_MODE_READ)
+        return BYTE_INVALID_PARAMETER;
+    ByteLock (stream);
+    short res = _byteReserve (stream, VARINT_MAX_BYTES);
+    if (res == BYTE_SUCCESS)
+        stream->bufPos += VarintEncodeU (stream->buf + stream->bufPos, val);
+    ByteUnlock (stream);
+    return res;
+}
+
+LIBNEX_PUBLIC short ByteWriteVarS (ByteStream_t* stream, int64_t val)
+{
+    if (!stream || stream->mode == BYTE_MODE_READ)
+        return BYTE_INVALID_PARAMETER;
+    ByteLock (stream);
+    short res = _byteReserve (stream, VARINT_MAX_BYTES);
+    if (res == BYTE_SUCCESS)
+        stream->bufPos += VarintEncodeS (stream->buf + stream->bufPos, val);
+    ByteUnlock (stream);
+    return res;
+}
+
+LIBNEX_PUBLIC short BytePeek (ByteStream_t* stream, size_t sz, const uint8_t** data, size_t* avail)
+{
+    if (!stream || !data || !avail || stream->mode != BYTE_MODE_READ)
+        return BYTE_INVALID_PARAMETER;
+    if (sz > stream->bufSize)
+        return BYTE_BUF_TOO_SMALL;
+    ByteLock (stream);
+    short res = _byteFill (stream, sz);
+    if (res == BYTE_SUCCESS)
+    {
+        *data = stream->buf + stream->bufPos;
+        *avail = stream->bufLen - stream->bufPos;
+    }
+    ByteUnlock (stream);
+    return res;
+}
+
+LIBNEX_PUBLIC short ByteConsume (ByteStream_t* stream, size_t sz)
+{
+    if (!stream || stream->mode != BYTE_MODE_READ)
+        return BYTE_INVALID_PARAMETER;
+    ByteLock (stream);
+    short res = BYTE_SUCCESS;
+    if (sz > (stream->bufLen - stream->bufPos))
+        res = BYTE_INVALID_PARAMETER;
+    else
+        stream->bufPos += sz;
+    ByteUnlock (stream);
+    return res;
+}
+
+// Error condition strings
+static const char* errorStrings[] = {
+    "",                                              // 0 doesn't represent anything
+    N_ ("No error"),                                 // BYTE_SUCCESS
+    NULL,                                            // BYTE_SYS_ERROR. This is NULL so ByteError calls strerror(3)
+    N_ ("Invalid parameter"),                        // BYTE_INVALID_PARAMETER
+    N_ ("Unexpected end of file"),                   // BYTE_EOF
+    N_ ("Malformed variable length integer"),        // BYTE_BAD_VARINT
+    N_ ("Request larger than the stream's buffer")    // BYTE_BUF_TOO_SMALL
+};
+
+LIBNEX_PUBLIC const char* ByteError (int code)
+{
+    // Initialize text domain if needed
+    __Libnex_i18n_init();
+    // Bounds check
+    if (code <= 0 || code >= (int) ARRAY_SIZE (errorStrings))
+        return NULL;
+    // Check if this corresponds to a system error
+    if (!errorStrings[code])
+        return strerror (errno);
+    return _ (errorStrings[code]);
+}
@@ -0,0 +1,228 @@
+/*
+    codepage.c - contains single byte codepage functions
+    Copyright 2022 The NexNix Project
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    There should be a copy of the License distributed in a file named
+    LICENSE, if not, you may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/// @file codepage.c
+
+#include "codepages/codepageTabs.h"
+#include "cpu.h"
+#include <assert.h>
+#include <libnex/base.h>
+#include <libnex/codepage.h>
+#include <libnex/lock.h>
+#include <libnex/safemalloc.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef LIBNEX_CPU_X86
+#include <immintrin.h>
+#endif
+
+// The built in codepages, indexed by ID
+static const struct
+{
+    const char* name;
+    const char32_t* table;
+} codepageBuiltinTab[] = {
+    {NULL, NULL},
+    {"ISO-8859-1", iso8859_1toUtf32},
+    {"ISO-8859-2", iso8859_2toUtf32},
+    {"ISO-8859-3", iso8859_3toUtf32},
+    {"ISO-8859-4", iso8859_4toUtf32},
+    {"ISO-8859-5", iso8859_5toUtf32},
+    {"ISO-8859-6", iso8859_6toUtf32},
+    {"ISO-8859-7", iso8859_7toUtf32},
+    {"ISO-8859-8", iso8859_8toUtf32},
+    {"ISO-8859-9", iso8859_9toUtf32},
+    {"ISO-8859-10", iso8859_10toUtf32},
+    {"ISO-8859-11", iso8859_11toUtf32},
+    {NULL, NULL},    // ISO-8859-12 was never published
+    {"ISO-8859-13", iso8859_13toUtf32},
+    {"ISO-8859-14", iso8859_14toUtf32},
+    {"ISO-8859-15", iso8859_15toUtf32},
+    {"ISO-8859-16", iso8859_16toUtf32},
+    {"IBM437", cp437toUtf32},
+    {"IBM850", cp850toUtf32},
+    {"IBM866", cp866toUtf32},
+    {"KOI8-R", koi8rtoUtf32},
+    {"KOI8-U", koi8utoUtf32},
+    {"windows-1252", win1252toUtf32},
+};
+
+// Built in codepages that have been created. Entries are published atomically, and codepageLock guards
+// creating them
+static Codepage_t* codepageBuiltins[CODEPAGE_MAX + 1];
+static lock_t codepageLock;
+
+// Decodes through the table one octet at a time
+static void codepageDecodeScalar (const Codepage_t* cp, char32_t* out, const uint8_t* in, size_t len)
+{
+    for (size_t i = 0; i < len; ++i)
+        out[i] = cp->toUnicode[in[i]];
+}
+
+#ifdef LIBNEX_CPU_X86
+// Decodes 32 octets at a time, gathering 8 characters at a time from the table
+// Blocks of ASCII don't need the table if the codepage's lower half is ASCII
+__attribute__ ((target ("avx2"))) static void codepageDecodeAvx2 (const Codepage_t* cp,
+                                                                   char32_t* out,
+                                                                   const uint8_t* in,
+                                                                   size_t len)
+{
+    size_t i = 0;
+    for (; (i + 32) <= len; i += 32)
+    {
+        int mask = _mm256_movemask_epi8 (_mm256_loadu_si256 ((const __m256i*) (in + i)));
+        bool isAscii = cp->isAscii && !mask;
+        for (int j = 0; j < 32; j += 8)
+        {
+            __m256i chars = _mm256_cvtepu8_epi32 (_mm_loadl_epi64 ((const __m128i*) (in + i + j)));
+            if (!isAscii)
+                chars = _mm256_i32gather_epi32 ((const int*) cp->toUnicode, chars, 4);
+            _mm256_storeu_si256 ((__m256i*) (out + i + j), chars);
+        }
+    }
+    codepageDecodeScalar (cp, out + i, in + i, len - i);
+}
+#endif
+
+static void (*codepageDecode) (const Codepage_t*, char32_t*, const uint8_t*, size_t) = codepageDecodeScalar;
+static once_t codepageInitOnce = ONCE_INIT;
+
+// Sets up the lock and picks the fastest kernels the CPU supports
+static void codepageInit (void)
+{
+    __Libnex_lock_init (&codepageLock);
+#ifdef LIBNEX_CPU_X86
+    if (CpuHasFeature (CPU_FEAT_AVX2))
+        codepageDecode = codepageDecodeAvx2;
+#endif
+}
+
+LIBNEX_PUBLIC Codepage_t* CodepageCreate (const char32_t* table, size_t size)
+{
+    if (!table || (size != 128 && size != 256))
+        return NULL;
+    // Build the decoding table. A 128 entry table only covers the upper half
+    char32_t toUnicode[256];
+    size_t first = 256 - size;
+    for (size_t octet = 0; octet < first; ++octet)
+        toUnicode[octet] = (char32_t) octet;
+    for (size_t i = 0; i < size; ++i)
+    {
+        char32_t c = table[i];
+        if (c > 0xFFFF || (c >= 0xD800 && c <= 0xDFFF))
+            return NULL;
+        size_t octet = first + i;
+        toUnicode[octet] = (c || !octet) ? c : 0xFFFD;
+    }
+
+    // Give each block of 256 characters that is used a page
+    uint16_t pageIdx[256] = {0};
+    size_t numPages = 1;
+    for (int octet = 0; octet < 256; ++octet)
+    {
+        char32_t c = toUnicode[octet];
+        if (c != 0xFFFD && !pageIdx[c >> 8])
+            pageIdx[c >> 8] = numPages++;
+    }
+    Codepage_t* cp = calloc_s (sizeof (Codepage_t) + (numPages * 256));
+    if (!cp)
+        return NULL;
+    memcpy (cp->toUnicode, toUnicode, sizeof (toUnicode));
+    memcpy (cp->pageIdx, pageIdx, sizeof (pageIdx));
+    cp->fromUnicode = (uint8_t (*)[256]) (cp + 1);
+    cp->numPages = numPages;
+
+    // Fill in the pages. Go backwards, so that the lowest octet wins if a character appears twice
+    for (int octet = 255; octet >= 0; --octet)
+    {
+        char32_t c = toUnicode[octet];
+        if (c != 0xFFFD)
+            cp->fromUnicode[pageIdx[c >> 8]][c & 0xFF] = (uint8_t) octet;
+    }
+    cp->isAscii = true;
+    for (char32_t c = 0; c < 0x80; ++c)
+    {
+        if (toUnicode[c] != c)
+            cp->isAscii = false;
+    }
+    return cp;
+}
+
+LIBNEX_PUBLIC void CodepageDestroy (Codepage_t* cp)
+{
+    assert (cp);
+    free (cp);
+}
+
+LIBNEX_PUBLIC const Codepage_t* CodepageGet (int id)
+{
+    if (id <= 0 || id > CODEPAGE_MAX || !codepageBuiltinTab[id].table)
+        return NULL;
+    // Once a codepage is published it never changes, so only creating it has to lock
+    Codepage_t* cp = __atomic_load_n (&codepageBuiltins[id], __ATOMIC_ACQUIRE);
+    if (cp)
+        return cp;
+    __Libnex_once (&codepageInitOnce, codepageInit);
+    __Libnex_lock_lock (&codepageLock);
+    cp = __atomic_load_n (&codepageBuiltins[id], __ATOMIC_RELAXED);
+    if (!cp)
+    {
+        cp = CodepageCreate (codepageBuiltinTab[id].table, 128);
+        __atomic_store_n (&codepageBuiltins[id], cp, __ATOMIC_RELEASE);
+    }
+    __Libnex_lock_unlock (&codepageLock);
+    return cp;
+}
+
+LIBNEX_PUBLIC int CodepageGetId (const char* name)
+{
+    assert (name);
+    for (int id = 1; id <= CODEPAGE_MAX; ++id)
+    {
+        if (codepageBuiltinTab[id].name && !strcmp (codepageBuiltinTab[id].name, name))
+            return id;
+    }
+    return 0;
+}
+
+LIBNEX_PUBLIC size_t CodepageDecode (const Codepage_t* cp, char32_t* out, const uint8_t* in, size_t len)
+{
+    assert (cp && out && in);
+    __Libnex_once (&codepageInitOnce, codepageInit);
+    codepageDecode (cp, out, in, len);
+    return len;
+}
+
+LIBNEX_PUBLIC size_t CodepageEncode (const Codepage_t* cp, uint8_t* out, const char32_t* in, size_t len)
+{
+    assert (cp && out && in);
+    size_t i = 0;
+    for (; i < len; ++i)
+    {
+        char32_t c = in[i];
+        if (c > 0xFFFF)
+            break;
+        uint8_t octet = cp->fromUnicode[cp->pageIdx[c >> 8]][c & 0xFF];
+        // Empty entries are 0 too, so make sure that octet 0 really is c
+        if (!octet && cp->toUnicode[0] != c)
+            break;
+        out[i] = octet;
+    }
+    return i;
+}
@@ -0,0 +1,68 @@
+/*
+    cpu.c - contains internal CPU feature detection
+    Copyright 2022 The NexNix Project
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    There should be a copy of the License distributed in a file named
+    LICENSE, if not, you may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include "cpu.h"
+#include <libnex/lock.h>
+
+#ifndef LIBNEX_BAREMETAL
+#ifdef LIBNEX_CPU_X86
+#include <cpuid.h>
+#elif defined LIBNEX_CPU_ARM && defined __linux__
+#include <sys/auxv.h>
+#define CPU_HWCAP_CRC32 (1 << 7)
+#endif
+#endif
+
+static unsigned int cpuFeatures = 0;
+static once_t cpuFeaturesOnce = ONCE_INIT;
+
+// Queries the CPU for its features
+static void cpuDetect (void)
+{
+#ifndef LIBNEX_BAREMETAL
+#ifdef LIBNEX_CPU_X86
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid (1, &eax, &ebx, &ecx, &edx))
+        return;
+    if (ecx & bit_SSSE3)
+        cpuFeatures |= CPU_FEAT_SSSE3;
+    if (ecx & bit_SSE4_2)
+        cpuFeatures |= CPU_FEAT_SSE42;
+    if ((ecx & bit_PCLMUL) && (ecx & bit_SSE4_1))
+        cpuFeatures |= CPU_FEAT_PCLMUL;
+    // AVX2 needs the OS to save YMM state, which XGETBV tells us
+    if ((ecx & bit_OSXSAVE) && (ecx & bit_AVX))
+    {
+        unsigned int xcr0Lo, xcr0Hi;
+        __asm__ ("xgetbv" : "=a"(xcr0Lo), "=d"(xcr0Hi) : "c"(0));
+        if ((xcr0Lo & 6) == 6 && __get_cpuid_count (7, 0, &eax, &ebx, &ecx, &edx) && (ebx & bit_AVX2))
+            cpuFeatures |= CPU_FEAT_AVX2;
+    }
+#elif defined LIBNEX_CPU_ARM && defined __linux__
+    unsigned long hwcap = getauxval (AT_HWCAP);
+    if (hwcap & CPU_HWCAP_CRC32)
+        cpuFeatures |= CPU_FEAT_ARM_CRC32;
+#endif
+#endif
+}
+
+unsigned int __Libnex_cpu_features()
+{
+    __Libnex_once (&cpuFeaturesOnce, cpuDetect);
+    return cpuFeatures;
+}
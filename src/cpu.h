@@ -0,0 +1,57 @@
+/*
+    cpu.h - contains internal CPU feature detection
+    Copyright 2022 The NexNix Project
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    There should be a copy of the License distributed in a file named
+    LICENSE, if not, you may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#ifndef _LIBNEX_CPU_H
+#define _LIBNEX_CPU_H
+
+#include <libnex/libnex_config.h>
+
+// Figure out which kernels the compiler can build
+#if defined __GNUC__ && defined __x86_64__
+#define LIBNEX_CPU_X86
+#elif defined __GNUC__ && defined __aarch64__
+#define LIBNEX_CPU_ARM
+#endif
+
+// CPU features
+#define CPU_FEAT_SSSE3     (1 << 0)    // x86 SSSE3
+#define CPU_FEAT_SSE42     (1 << 1)    // x86 SSE 4.2
+#define CPU_FEAT_PCLMUL    (1 << 2)    // x86 carry-less multiply
+#define CPU_FEAT_AVX2      (1 << 3)    // x86 AVX2, with OS support for saving YMM registers
+#define CPU_FEAT_ARM_CRC32 (1 << 4)    // ARMv8 CRC32 instructions
+
+// Gets the features of the CPU we are running on. The result is cached after the first call
+// Always returns 0 on baremetal, as the environment may not have enabled the extended state
+unsigned int __Libnex_cpu_features();
+
+// Checks if the CPU has a feature
+#define CpuHasFeature(feat) ((__Libnex_cpu_features() & (feat)) == (feat))
+
+#ifdef LIBNEX_KERNEL_HOOKS
+// Restricts the CRC kernels to the given features, as far as the CPU has them. Passing 0 forces the
+// table driven kernels, and passing ~0U goes back to the fastest ones. Only built for the tests and
+// benchmarks. It isn't thread safe, so no other thread may be using the CRC functions while it runs
+LIBNEX_PUBLIC void __Libnex_crc_set_features (unsigned int features);
+// The same for the Unicode buffer kernels. Passing 0 forces the baseline kernels, SSE2 or NEON where
+// the compiler targets them and scalar elsewhere
+LIBNEX_PUBLIC void __Libnex_unicode_set_features (unsigned int features);
+// And for the byte swapping kernels
+LIBNEX_PUBLIC void __Libnex_endian_set_features (unsigned int features);
+#endif
+
+#endif
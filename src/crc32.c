@@ -1,48 +1,607 @@
 /*
-    crc32.c - computes CRC32 checksum of buffer
+    crc32.c - computes CRC32, CRC32C, and CRC64 checksums of buffers
     Licensed under the CC0 license
     See https://creativecommons.org/publicdomain/zero/1.0/legalcode
 */
 
+#include "cpu.h"
 #include <libnex/crc32.h>
+#include <libnex/lock.h>
+#include <libnex/safemalloc.h>
+#include <stdbool.h>
+#include <stdlib.h>
 
-const uint32_t poly8Lookup[256] = {
-    0,          0x77073096, 0xEE0E612C, 0x990951BA, 0x076DC419, 0x706AF48F, 0xE963A535, 0x9E6495A3, 0x0EDB8832,
-    0x79DCB8A4, 0xE0D5E91E, 0x97D2D988, 0x09B64C2B, 0x7EB17CBD, 0xE7B82D07, 0x90BF1D91, 0x1DB71064, 0x6AB020F2,
-    0xF3B97148, 0x84BE41DE, 0x1ADAD47D, 0x6DDDE4EB, 0xF4D4B551, 0x83D385C7, 0x136C9856, 0x646BA8C0, 0xFD62F97A,
-    0x8A65C9EC, 0x14015C4F, 0x63066CD9, 0xFA0F3D63, 0x8D080DF5, 0x3B6E20C8, 0x4C69105E, 0xD56041E4, 0xA2677172,
-    0x3C03E4D1, 0x4B04D447, 0xD20D85FD, 0xA50AB56B, 0x35B5A8FA, 0x42B2986C, 0xDBBBC9D6, 0xACBCF940, 0x32D86CE3,
-    0x45DF5C75, 0xDCD60DCF, 0xABD13D59, 0x26D930AC, 0x51DE003A, 0xC8D75180, 0xBFD06116, 0x21B4F4B5, 0x56B3C423,
-    0xCFBA9599, 0xB8BDA50F, 0x2802B89E, 0x5F058808, 0xC60CD9B2, 0xB10BE924, 0x2F6F7C87, 0x58684C11, 0xC1611DAB,
-    0xB6662D3D, 0x76DC4190, 0x01DB7106, 0x98D220BC, 0xEFD5102A, 0x71B18589, 0x06B6B51F, 0x9FBFE4A5, 0xE8B8D433,
-    0x7807C9A2, 0x0F00F934, 0x9609A88E, 0xE10E9818, 0x7F6A0DBB, 0x086D3D2D, 0x91646C97, 0xE6635C01, 0x6B6B51F4,
-    0x1C6C6162, 0x856530D8, 0xF262004E, 0x6C0695ED, 0x1B01A57B, 0x8208F4C1, 0xF50FC457, 0x65B0D9C6, 0x12B7E950,
-    0x8BBEB8EA, 0xFCB9887C, 0x62DD1DDF, 0x15DA2D49, 0x8CD37CF3, 0xFBD44C65, 0x4DB26158, 0x3AB551CE, 0xA3BC0074,
-    0xD4BB30E2, 0x4ADFA541, 0x3DD895D7, 0xA4D1C46D, 0xD3D6F4FB, 0x4369E96A, 0x346ED9FC, 0xAD678846, 0xDA60B8D0,
-    0x44042D73, 0x33031DE5, 0xAA0A4C5F, 0xDD0D7CC9, 0x5005713C, 0x270241AA, 0xBE0B1010, 0xC90C2086, 0x5768B525,
-    0x206F85B3, 0xB966D409, 0xCE61E49F, 0x5EDEF90E, 0x29D9C998, 0xB0D09822, 0xC7D7A8B4, 0x59B33D17, 0x2EB40D81,
-    0xB7BD5C3B, 0xC0BA6CAD, 0xEDB88320, 0x9ABFB3B6, 0x03B6E20C, 0x74B1D29A, 0xEAD54739, 0x9DD277AF, 0x04DB2615,
-    0x73DC1683, 0xE3630B12, 0x94643B84, 0x0D6D6A3E, 0x7A6A5AA8, 0xE40ECF0B, 0x9309FF9D, 0x0A00AE27, 0x7D079EB1,
-    0xF00F9344, 0x8708A3D2, 0x1E01F268, 0x6906C2FE, 0xF762575D, 0x806567CB, 0x196C3671, 0x6E6B06E7, 0xFED41B76,
-    0x89D32BE0, 0x10DA7A5A, 0x67DD4ACC, 0xF9B9DF6F, 0x8EBEEFF9, 0x17B7BE43, 0x60B08ED5, 0xD6D6A3E8, 0xA1D1937E,
-    0x38D8C2C4, 0x4FDFF252, 0xD1BB67F1, 0xA6BC5767, 0x3FB506DD, 0x48B2364B, 0xD80D2BDA, 0xAF0A1B4C, 0x36034AF6,
-    0x41047A60, 0xDF60EFC3, 0xA867DF55, 0x316E8EEF, 0x4669BE79, 0xCB61B38C, 0xBC66831A, 0x256FD2A0, 0x5268E236,
-    0xCC0C7795, 0xBB0B4703, 0x220216B9, 0x5505262F, 0xC5BA3BBE, 0xB2BD0B28, 0x2BB45A92, 0x5CB36A04, 0xC2D7FFA7,
-    0xB5D0CF31, 0x2CD99E8B, 0x5BDEAE1D, 0x9B64C2B0, 0xEC63F226, 0x756AA39C, 0x026D930A, 0x9C0906A9, 0xEB0E363F,
-    0x72076785, 0x05005713, 0x95BF4A82, 0xE2B87A14, 0x7BB12BAE, 0x0CB61B38, 0x92D28E9B, 0xE5D5BE0D, 0x7CDCEFB7,
-    0x0BDBDF21, 0x86D3D2D4, 0xF1D4E242, 0x68DDB3F8, 0x1FDA836E, 0x81BE16CD, 0xF6B9265B, 0x6FB077E1, 0x18B74777,
-    0x88085AE6, 0xFF0F6A70, 0x66063BCA, 0x11010B5C, 0x8F659EFF, 0xF862AE69, 0x616BFFD3, 0x166CCF45, 0xA00AE278,
-    0xD70DD2EE, 0x4E048354, 0x3903B3C2, 0xA7672661, 0xD06016F7, 0x4969474D, 0x3E6E77DB, 0xAED16A4A, 0xD9D65ADC,
-    0x40DF0B66, 0x37D83BF0, 0xA9BCAE53, 0xDEBB9EC5, 0x47B2CF7F, 0x30B5FFE9, 0xBDBDF21C, 0xCABAC28A, 0x53B39330,
-    0x24B4A3A6, 0xBAD03605, 0xCDD70693, 0x54DE5729, 0x23D967BF, 0xB3667A2E, 0xC4614AB8, 0x5D681B02, 0x2A6F2B94,
-    0xB40BBE37, 0xC30C8EA1, 0x5A05DF1B, 0x2D02EF8D};
+#ifdef LIBNEX_CPU_X86
+#include <immintrin.h>
+#elif defined LIBNEX_CPU_ARM
+#include <arm_acle.h>
+#endif
+
+// Reflected polynomials
+#define CRC32_POLY  0xEDB88320
+#define CRC32C_POLY 0x82F63B78
+#define CRC64_POLY  0xC96C5795D7870F42ULL
+
+// Generates slicing tables for a reflected 32 bit polynomial. tab[0] is the usual
+// byte at a time table, and tab[n] advances a CRC byte through n more zero bytes
+static void crcGenSlices32 (uint32_t poly, uint32_t (*tab)[256], int numSlices)
+{
+    for (uint32_t i = 0; i < 256; ++i)
+    {
+        uint32_t crc = i;
+        for (int bit = 0; bit < 8; ++bit)
+            crc = (crc & 1) ? (crc >> 1) ^ poly : crc >> 1;
+        tab[0][i] = crc;
+    }
+    for (int slice = 1; slice < numSlices; ++slice)
+    {
+        for (int i = 0; i < 256; ++i)
+        {
+            uint32_t prev = tab[slice - 1][i];
+            tab[slice][i] = (prev >> 8) ^ tab[0][prev & 0xFF];
+        }
+    }
+}
+
+// Generates slicing tables for a reflected 64 bit polynomial
+static void crcGenSlices64 (uint64_t poly, uint64_t (*tab)[256], int numSlices)
+{
+    for (uint64_t i = 0; i < 256; ++i)
+    {
+        uint64_t crc = i;
+        for (int bit = 0; bit < 8; ++bit)
+            crc = (crc & 1) ? (crc >> 1) ^ poly : crc >> 1;
+        tab[0][i] = crc;
+    }
+    for (int slice = 1; slice < numSlices; ++slice)
+    {
+        for (int i = 0; i < 256; ++i)
+        {
+            uint64_t prev = tab[slice - 1][i];
+            tab[slice][i] = (prev >> 8) ^ tab[0][prev & 0xFF];
+        }
+    }
+}
+
+// Reads a little endian 32 bit value from p. Compilers turn this into one load
+static inline uint32_t crcLoad32 (const uint8_t* p)
+{
+    return (uint32_t) p[0] | ((uint32_t) p[1] << 8) | ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+// Reads a little endian 64 bit value from p
+static inline uint64_t crcLoad64 (const uint8_t* p)
+{
+    return (uint64_t) crcLoad32 (p) | ((uint64_t) crcLoad32 (p + 4) << 32);
+}
+
+// Updates a 32 bit CRC with len bytes of p using slicing-by-16 tables t.
+// crc is the raw (non-inverted) register value
+static inline uint32_t crcUpdateSlice32 (uint32_t (*t)[256], uint32_t crc, const uint8_t* p, size_t bytelength)
+{
+    // Process 16 bytes at a time
+    while (bytelength >= 16)
+    {
+        uint32_t a = crc ^ crcLoad32 (p);
+        uint32_t b = crcLoad32 (p + 4);
+        uint32_t c = crcLoad32 (p + 8);
+        uint32_t d = crcLoad32 (p + 12);
+        crc = t[15][a & 0xFF] ^ t[14][(a >> 8) & 0xFF] ^ t[13][(a >> 16) & 0xFF] ^ t[12][a >> 24] ^
+              t[11][b & 0xFF] ^ t[10][(b >> 8) & 0xFF] ^ t[9][(b >> 16) & 0xFF] ^ t[8][b >> 24] ^
+              t[7][c & 0xFF] ^ t[6][(c >> 8) & 0xFF] ^ t[5][(c >> 16) & 0xFF] ^ t[4][c >> 24] ^
+              t[3][d & 0xFF] ^ t[2][(d >> 8) & 0xFF] ^ t[1][(d >> 16) & 0xFF] ^ t[0][d >> 24];
+        p += 16;
+        bytelength -= 16;
+    }
+    // Then 8 bytes
+    if (bytelength >= 8)
+    {
+        uint32_t a = crc ^ crcLoad32 (p);
+        uint32_t b = crcLoad32 (p + 4);
+        crc = t[7][a & 0xFF] ^ t[6][(a >> 8) & 0xFF] ^ t[5][(a >> 16) & 0xFF] ^ t[4][a >> 24] ^
+              t[3][b & 0xFF] ^ t[2][(b >> 8) & 0xFF] ^ t[1][(b >> 16) & 0xFF] ^ t[0][b >> 24];
+        p += 8;
+        bytelength -= 8;
+    }
+    // Finish off byte by byte
+    // Adapted from https://wiki.osdev.org/Crc32
+    while (bytelength-- != 0)
+        crc = t[0][((uint8_t) crc ^ *(p++))] ^ (crc >> 8);
+    return crc;
+}
+
+// Updates a 64 bit CRC with len bytes of p using slicing-by-8 tables t
+static inline uint64_t crcUpdateSlice64 (uint64_t (*t)[256], uint64_t crc, const uint8_t* p, size_t bytelength)
+{
+    while (bytelength >= 8)
+    {
+        crc ^= crcLoad64 (p);
+        crc = t[7][crc & 0xFF] ^ t[6][(crc >> 8) & 0xFF] ^ t[5][(crc >> 16) & 0xFF] ^
+              t[4][(crc >> 24) & 0xFF] ^ t[3][(crc >> 32) & 0xFF] ^ t[2][(crc >> 40) & 0xFF] ^
+              t[1][(crc >> 48) & 0xFF] ^ t[0][crc >> 56];
+        p += 8;
+        bytelength -= 8;
+    }
+    while (bytelength-- != 0)
+        crc = t[0][((uint8_t) crc ^ *(p++))] ^ (crc >> 8);
+    return crc;
+}
+
+// Multiplies a and b modulo a reflected 32 bit polynomial
+static uint32_t crcMultModP32 (uint32_t poly, uint32_t a, uint32_t b)
+{
+    uint32_t m = (uint32_t) 1 << 31;
+    uint32_t p = 0;
+    for (;;)
+    {
+        if (a & m)
+        {
+            p ^= b;
+            if ((a & (m - 1)) == 0)
+                break;
+        }
+        m >>= 1;
+        b = (b & 1) ? (b >> 1) ^ poly : b >> 1;
+    }
+    return p;
+}
+
+// Multiplies a and b modulo a reflected 64 bit polynomial
+static uint64_t crcMultModP64 (uint64_t poly, uint64_t a, uint64_t b)
+{
+    uint64_t m = (uint64_t) 1 << 63;
+    uint64_t p = 0;
+    for (;;)
+    {
+        if (a & m)
+        {
+            p ^= b;
+            if ((a & (m - 1)) == 0)
+                break;
+        }
+        m >>= 1;
+        b = (b & 1) ? (b >> 1) ^ poly : b >> 1;
+    }
+    return p;
+}
+
+// Generates x^(2^n) modulo a 32 bit polynomial, for n from 0 to 31
+static void crcGenX2n32 (uint32_t poly, uint32_t* tab)
+{
+    uint32_t p = (uint32_t) 1 << 30;    // x^1
+    tab[0] = p;
+    for (int n = 1; n < 32; ++n)
+        tab[n] = p = crcMultModP32 (poly, p, p);
+}
+
+// Generates x^(2^n) modulo a 64 bit polynomial, for n from 0 to 63
+static void crcGenX2n64 (uint64_t poly, uint64_t* tab)
+{
+    uint64_t p = (uint64_t) 1 << 62;    // x^1
+    tab[0] = p;
+    for (int n = 1; n < 64; ++n)
+        tab[n] = p = crcMultModP64 (poly, p, p);
+}
+
+// Computes x^(n * 2^k) modulo a 32 bit polynomial, given its x^(2^n) table
+static uint32_t crcX2nModP32 (uint32_t poly, const uint32_t* tab, uint64_t n, unsigned int k)
+{
+    uint32_t p = (uint32_t) 1 << 31;    // x^0 == 1
+    while (n)
+    {
+        if (n & 1)
+            p = crcMultModP32 (poly, tab[k & 31], p);
+        n >>= 1;
+        ++k;
+    }
+    return p;
+}
+
+// Computes x^(n * 2^k) modulo a 64 bit polynomial, given its x^(2^n) table
+static uint64_t crcX2nModP64 (uint64_t poly, const uint64_t* tab, uint64_t n, unsigned int k)
+{
+    uint64_t p = (uint64_t) 1 << 63;    // x^0 == 1
+    while (n)
+    {
+        if (n & 1)
+            p = crcMultModP64 (poly, tab[k & 63], p);
+        n >>= 1;
+        ++k;
+    }
+    return p;
+}
+
+// Slicing tables for each CRC
+static uint32_t crc32Slices[16][256];
+static uint32_t crc32cSlices[16][256];
+static uint64_t crc64Slices[8][256];
+
+// x^(2^n) tables for each CRC. Used to combine CRCs
+static uint32_t crc32X2nTable[32];
+static uint32_t crc32cX2nTable[32];
+static uint64_t crc64X2nTable[64];
+
+static uint32_t crc32UpdateSlice (uint32_t crc, const uint8_t* p, size_t bytelength)
+{
+    return crcUpdateSlice32 (crc32Slices, crc, p, bytelength);
+}
+
+static uint32_t crc32cUpdateSlice (uint32_t crc, const uint8_t* p, size_t bytelength)
+{
+    return crcUpdateSlice32 (crc32cSlices, crc, p, bytelength);
+}
+
+#ifdef LIBNEX_CPU_X86
+// Folding constants for the reflected CRC32 polynomial, from Intel's paper
+// "Fast CRC Computation for Generic Polynomials Using PCLMULQDQ Instruction"
+static const uint64_t __attribute__ ((aligned (16))) crc32FoldK1K2[] = {0x0154442BD4, 0x01C6E41596};
+static const uint64_t __attribute__ ((aligned (16))) crc32FoldK3K4[] = {0x01751997D0, 0x00CCAA009E};
+static const uint64_t __attribute__ ((aligned (16))) crc32FoldK5K0[] = {0x0163CD6124, 0x0000000000};
+static const uint64_t __attribute__ ((aligned (16))) crc32FoldPoly[] = {0x01DB710641, 0x01F7011641};
+
+// Updates a CRC by folding 64 bytes at a time with carry-less multiplies
+__attribute__ ((target ("pclmul,sse4.1"))) static uint32_t crc32UpdatePclmul (uint32_t crc,
+                                                                               const uint8_t* p,
+                                                                               size_t bytelength)
+{
+    if (bytelength < 64)
+        return crc32UpdateSlice (crc, p, bytelength);
+    // Leave the tail for the tables
+    size_t tail = bytelength & 15;
+    bytelength -= tail;
+
+    __m128i x0, x1, x2, x3, x4, x5, x6, x7, x8, y5, y6, y7, y8;
+    x1 = _mm_loadu_si128 ((const __m128i*) (p + 0x00));
+    x2 = _mm_loadu_si128 ((const __m128i*) (p + 0x10));
+    x3 = _mm_loadu_si128 ((const __m128i*) (p + 0x20));
+    x4 = _mm_loadu_si128 ((const __m128i*) (p + 0x30));
+    x1 = _mm_xor_si128 (x1, _mm_cvtsi32_si128 ((int) crc));
+    x0 = _mm_load_si128 ((const __m128i*) crc32FoldK1K2);
+    p += 64;
+    bytelength -= 64;
+
+    // Fold 4 blocks in parallel
+    while (bytelength >= 64)
+    {
+        x5 = _mm_clmulepi64_si128 (x1, x0, 0x00);
+        x6 = _mm_clmulepi64_si128 (x2, x0, 0x00);
+        x7 = _mm_clmulepi64_si128 (x3, x0, 0x00);
+        x8 = _mm_clmulepi64_si128 (x4, x0, 0x00);
+        x1 = _mm_clmulepi64_si128 (x1, x0, 0x11);
+        x2 = _mm_clmulepi64_si128 (x2, x0, 0x11);
+        x3 = _mm_clmulepi64_si128 (x3, x0, 0x11);
+        x4 = _mm_clmulepi64_si128 (x4, x0, 0x11);
+        y5 = _mm_loadu_si128 ((const __m128i*) (p + 0x00));
+        y6 = _mm_loadu_si128 ((const __m128i*) (p + 0x10));
+        y7 = _mm_loadu_si128 ((const __m128i*) (p + 0x20));
+        y8 = _mm_loadu_si128 ((const __m128i*) (p + 0x30));
+        x1 = _mm_xor_si128 (_mm_xor_si128 (x1, x5), y5);
+        x2 = _mm_xor_si128 (_mm_xor_si128 (x2, x6), y6);
+        x3 = _mm_xor_si128 (_mm_xor_si128 (x3, x7), y7);
+        x4 = _mm_xor_si128 (_mm_xor_si128 (x4, x8), y8);
+        p += 64;
+        bytelength -= 64;
+    }
+
+    // Fold the 4 blocks into one
+    x0 = _mm_load_si128 ((const __m128i*) crc32FoldK3K4);
+    x5 = _mm_clmulepi64_si128 (x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128 (x1, x0, 0x11);
+    x1 = _mm_xor_si128 (_mm_xor_si128 (x1, x2), x5);
+    x5 = _mm_clmulepi64_si128 (x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128 (x1, x0, 0x11);
+    x1 = _mm_xor_si128 (_mm_xor_si128 (x1, x3), x5);
+    x5 = _mm_clmulepi64_si128 (x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128 (x1, x0, 0x11);
+    x1 = _mm_xor_si128 (_mm_xor_si128 (x1, x4), x5);
+
+    // Fold in remaining 16 byte blocks
+    while (bytelength >= 16)
+    {
+        x2 = _mm_loadu_si128 ((const __m128i*) p);
+        x5 = _mm_clmulepi64_si128 (x1, x0, 0x00);
+        x1 = _mm_clmulepi64_si128 (x1, x0, 0x11);
+        x1 = _mm_xor_si128 (_mm_xor_si128 (x1, x2), x5);
+        p += 16;
+        bytelength -= 16;
+    }
+
+    // Fold 128 bits down to 64
+    x2 = _mm_clmulepi64_si128 (x1, x0, 0x10);
+    x3 = _mm_setr_epi32 (~0, 0, ~0, 0);
+    x1 = _mm_srli_si128 (x1, 8);
+    x1 = _mm_xor_si128 (x1, x2);
+    x0 = _mm_loadl_epi64 ((const __m128i*) crc32FoldK5K0);
+    x2 = _mm_srli_si128 (x1, 4);
+    x1 = _mm_and_si128 (x1, x3);
+    x1 = _mm_clmulepi64_si128 (x1, x0, 0x00);
+    x1 = _mm_xor_si128 (x1, x2);
+
+    // Barrett reduce to 32 bits
+    x0 = _mm_load_si128 ((const __m128i*) crc32FoldPoly);
+    x2 = _mm_and_si128 (x1, x3);
+    x2 = _mm_clmulepi64_si128 (x2, x0, 0x10);
+    x2 = _mm_and_si128 (x2, x3);
+    x2 = _mm_clmulepi64_si128 (x2, x0, 0x00);
+    x1 = _mm_xor_si128 (x1, x2);
+    crc = (uint32_t) _mm_extract_epi32 (x1, 1);
+    return crc32UpdateSlice (crc, p, tail);
+}
+
+// Updates a CRC32C with the SSE 4.2 crc32 instruction, 8 bytes at a time
+__attribute__ ((target ("sse4.2"))) static uint32_t crc32cUpdateSse42 (uint32_t crc,
+                                                                       const uint8_t* p,
+                                                                       size_t bytelength)
+{
+    uint64_t crc64 = crc;
+    while (bytelength >= 8)
+    {
+        uint64_t val;
+        __builtin_memcpy (&val, p, 8);
+        crc64 = _mm_crc32_u64 (crc64, val);
+        p += 8;
+        bytelength -= 8;
+    }
+    crc = (uint32_t) crc64;
+    while (bytelength--)
+        crc = _mm_crc32_u8 (crc, *p++);
+    return crc;
+}
+#elif defined LIBNEX_CPU_ARM
+// Updates a CRC with the ARMv8 CRC32 instructions, 8 bytes at a time
+__attribute__ ((target ("+crc"))) static uint32_t crc32UpdateArm (uint32_t crc,
+                                                                  const uint8_t* p,
+                                                                  size_t bytelength)
+{
+    while (bytelength >= 8)
+    {
+        uint64_t val;
+        __builtin_memcpy (&val, p, 8);
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        val = __builtin_bswap64 (val);
+#endif
+        crc = __crc32d (crc, val);
+        p += 8;
+        bytelength -= 8;
+    }
+    while (bytelength--)
+        crc = __crc32b (crc, *p++);
+    return crc;
+}
+
+// Updates a CRC32C with the ARMv8 CRC32 instructions, 8 bytes at a time
+__attribute__ ((target ("+crc"))) static uint32_t crc32cUpdateArm (uint32_t crc,
+                                                                   const uint8_t* p,
+                                                                   size_t bytelength)
+{
+    while (bytelength >= 8)
+    {
+        uint64_t val;
+        __builtin_memcpy (&val, p, 8);
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        val = __builtin_bswap64 (val);
+#endif
+        crc = __crc32cd (crc, val);
+        p += 8;
+        bytelength -= 8;
+    }
+    while (bytelength--)
+        crc = __crc32cb (crc, *p++);
+    return crc;
+}
+#endif
+
+// The kernels that the update functions use
+static uint32_t (*crc32Kernel) (uint32_t, const uint8_t*, size_t) = crc32UpdateSlice;
+static uint32_t (*crc32cKernel) (uint32_t, const uint8_t*, size_t) = crc32cUpdateSlice;
+static once_t crcInitOnce = ONCE_INIT;
+
+// Picks the fastest kernels that only use the given CPU features
+static void crcPickKernels (unsigned int features)
+{
+    crc32Kernel = crc32UpdateSlice;
+    crc32cKernel = crc32cUpdateSlice;
+#ifdef LIBNEX_CPU_X86
+    if (features & CPU_FEAT_PCLMUL)
+        crc32Kernel = crc32UpdatePclmul;
+    if (features & CPU_FEAT_SSE42)
+        crc32cKernel = crc32cUpdateSse42;
+#elif defined LIBNEX_CPU_ARM
+    if (features & CPU_FEAT_ARM_CRC32)
+    {
+        crc32Kernel = crc32UpdateArm;
+        crc32cKernel = crc32cUpdateArm;
+    }
+#endif
+}
+
+// Generates tables and picks the fastest kernels the CPU supports
+static void crcInit (void)
+{
+    crcGenSlices32 (CRC32_POLY, crc32Slices, 16);
+    crcGenSlices32 (CRC32C_POLY, crc32cSlices, 16);
+    crcGenSlices64 (CRC64_POLY, crc64Slices, 8);
+    crcGenX2n32 (CRC32_POLY, crc32X2nTable);
+    crcGenX2n32 (CRC32C_POLY, crc32cX2nTable);
+    crcGenX2n64 (CRC64_POLY, crc64X2nTable);
+    crcPickKernels (__Libnex_cpu_features());
+}
+
+#ifdef LIBNEX_KERNEL_HOOKS
+LIBNEX_PUBLIC void __Libnex_crc_set_features (unsigned int features)
+{
+    __Libnex_once (&crcInitOnce, crcInit);
+    crcPickKernels (features & __Libnex_cpu_features());
+}
+#endif
+
+// Updates a CRC with len bytes of p. crc is the raw (non-inverted) register value
+static uint32_t crc32Update (uint32_t crc, const uint8_t* p, size_t bytelength)
+{
+    __Libnex_once (&crcInitOnce, crcInit);
+    return crc32Kernel (crc, p, bytelength);
+}
 
 // Calculate CRC32 checksum of buffer
-// Adapted from https://wiki.osdev.org/Crc32
 uint32_t Crc32Calc (const uint8_t* p, size_t bytelength)
 {
-    uint32_t crc = 0xFFFFFFFF;
-    while (bytelength-- != 0)
-        crc = poly8Lookup[((uint8_t) crc ^ *(p++))] ^ (crc >> 8);
+    return Crc32Final (crc32Update (Crc32Init(), p, bytelength));
+}
+
+LIBNEX_PUBLIC uint32_t Crc32Init()
+{
+    return 0xFFFFFFFF;
+}
+
+LIBNEX_PUBLIC uint32_t Crc32Update (uint32_t crc, const uint8_t* buf, size_t len)
+{
+    return crc32Update (crc, buf, len);
+}
+
+LIBNEX_PUBLIC uint32_t Crc32Final (uint32_t crc)
+{
+    return ~crc;
+}
+
+LIBNEX_PUBLIC uint32_t Crc32Combine (uint32_t crcA, uint32_t crcB, uint64_t lenB)
+{
+    __Libnex_once (&crcInitOnce, crcInit);
+    // Shift crcA past lenB zero bytes, then add in crcB
+    return crcMultModP32 (CRC32_POLY, crcX2nModP32 (CRC32_POLY, crc32X2nTable, lenB, 3), crcA) ^ crcB;
+}
+
+LIBNEX_PUBLIC uint32_t Crc32cCalc (const uint8_t* buf, size_t len)
+{
+    return Crc32cFinal (Crc32cUpdate (Crc32cInit(), buf, len));
+}
+
+LIBNEX_PUBLIC uint32_t Crc32cInit()
+{
+    return 0xFFFFFFFF;
+}
+
+LIBNEX_PUBLIC uint32_t Crc32cUpdate (uint32_t crc, const uint8_t* buf, size_t len)
+{
+    __Libnex_once (&crcInitOnce, crcInit);
+    return crc32cKernel (crc, buf, len);
+}
+
+LIBNEX_PUBLIC uint32_t Crc32cFinal (uint32_t crc)
+{
     return ~crc;
 }
+
+LIBNEX_PUBLIC uint32_t Crc32cCombine (uint32_t crcA, uint32_t crcB, uint64_t lenB)
+{
+    __Libnex_once (&crcInitOnce, crcInit);
+    return crcMultModP32 (CRC32C_POLY, crcX2nModP32 (CRC32C_POLY, crc32cX2nTable, lenB, 3), crcA) ^ crcB;
+}
+
+LIBNEX_PUBLIC uint64_t Crc64Calc (const uint8_t* buf, size_t len)
+{
+    return Crc64Final (Crc64Update (Crc64Init(), buf, len));
+}
+
+LIBNEX_PUBLIC uint64_t Crc64Init()
+{
+    return 0xFFFFFFFFFFFFFFFFULL;
+}
+
+LIBNEX_PUBLIC uint64_t Crc64Update (uint64_t crc, const uint8_t* buf, size_t len)
+{
+    __Libnex_once (&crcInitOnce, crcInit);
+    return crcUpdateSlice64 (crc64Slices, crc, buf, len);
+}
+
+LIBNEX_PUBLIC uint64_t Crc64Final (uint64_t crc)
+{
+    return ~crc;
+}
+
+LIBNEX_PUBLIC uint64_t Crc64Combine (uint64_t crcA, uint64_t crcB, uint64_t lenB)
+{
+    __Libnex_once (&crcInitOnce, crcInit);
+    return crcMultModP64 (CRC64_POLY, crcX2nModP64 (CRC64_POLY, crc64X2nTable, lenB, 3), crcA) ^ crcB;
+}
+
+#ifndef LIBNEX_BAREMETAL
+// Chunks smaller than this aren't worth a thread
+#define CRC32_MIN_CHUNK (256 * 1024)
+
+// A chunk of a parallel CRC computation
+typedef struct _crc32Chunk
+{
+    const uint8_t* buf;    // Start of chunk
+    size_t len;            // Length of chunk
+    uint32_t crc;          // Checksum of chunk, once computed
+#ifdef HAVE_C11_THREADS
+    thrd_t thread;    // Thread computing this chunk
+#else
+    pthread_t thread;
+#endif
+    bool started;    // If thread was started
+} crc32Chunk_t;
+
+// Computes the checksum of a chunk
+#ifdef HAVE_C11_THREADS
+static int crc32Worker (void* arg)
+#else
+static void* crc32Worker (void* arg)
+#endif
+{
+    crc32Chunk_t* chunk = arg;
+    chunk->crc = Crc32Calc (chunk->buf, chunk->len);
+#ifdef HAVE_C11_THREADS
+    return 0;
+#else
+    return NULL;
+#endif
+}
+
+LIBNEX_PUBLIC uint32_t Crc32CalcParallel (const uint8_t* buf, size_t len, unsigned int nthreads)
+{
+    if (nthreads > (len / CRC32_MIN_CHUNK))
+        nthreads = (unsigned int) (len / CRC32_MIN_CHUNK);
+    if (nthreads <= 1)
+        return Crc32Calc (buf, len);
+    crc32Chunk_t* chunks = calloc_s (nthreads * sizeof (crc32Chunk_t));
+    if (!chunks)
+        return Crc32Calc (buf, len);
+    // Split buffer into equal chunks, with the last one taking the remainder
+    size_t chunkLen = len / nthreads;
+    for (unsigned int i = 0; i < nthreads; ++i)
+    {
+        chunks[i].buf = buf + (i * chunkLen);
+        chunks[i].len = (i == (nthreads - 1)) ? len - (i * chunkLen) : chunkLen;
+    }
+    // Start a worker for every chunk but the first, which we compute ourselves
+    for (unsigned int i = 1; i < nthreads; ++i)
+    {
+#ifdef HAVE_C11_THREADS
+        chunks[i].started = thrd_create (&chunks[i].thread, crc32Worker, &chunks[i]) == thrd_success;
+#else
+        chunks[i].started = pthread_create (&chunks[i].thread, NULL, crc32Worker, &chunks[i]) == 0;
+#endif
+    }
+    crc32Worker (&chunks[0]);
+    // Wait for each worker and merge its checksum in. If a thread couldn't be started,
+    // compute the chunk here instead
+    uint32_t crc = chunks[0].crc;
+    for (unsigned int i = 1; i < nthreads; ++i)
+    {
+        if (chunks[i].started)
+        {
+#ifdef HAVE_C11_THREADS
+            thrd_join (chunks[i].thread, NULL);
+#else
+            pthread_join (chunks[i].thread, NULL);
+#endif
+        }
+        else
+            crc32Worker (&chunks[i]);
+        crc = Crc32Combine (crc, chunks[i].crc, chunks[i].len);
+    }
+    free (chunks);
+    return crc;
+}
+#endif
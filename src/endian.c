@@ -18,108 +18,205 @@
 
 /// @file endian.c
 
+// Emit the out of line copies of the inline functions in endian.h. These keep
+// the exported symbols around for programs built against older headers
+#define LIBNEX_ENDIAN_OUTLINE
+#include "cpu.h"
 #include <libnex/endian.h>
+#include <libnex/lock.h>
+#include <string.h>
 
-LIBNEX_PUBLIC char EndianHost()
+#ifdef LIBNEX_CPU_X86
+#include <immintrin.h>
+#elif defined LIBNEX_CPU_ARM && !defined LIBNEX_BAREMETAL
+#include <arm_neon.h>
+#endif
+
+// Swaps count elements of size bytes each from src into dst, one at a time
+static void endianSwapScalar (uint8_t* dst, const uint8_t* src, size_t count, int size)
 {
-    // Declare a 16 bit value
-    uint16_t val = 0x9867;
-    // Cast to pointer so we can access the individual bytes
-    uint8_t* val8 = (uint8_t*) &val;
-    // Check what order the bytes are in
-    if (val8[0] == 0x98)
-        return ENDIAN_BIG;
-    else if (val8[0] == 0x67)
-        return ENDIAN_LITTLE;
-    return 0;
+    if (size == 2)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            uint16_t val;
+            memcpy (&val, src + (i * 2), 2);
+            val = EndianSwap16 (val);
+            memcpy (dst + (i * 2), &val, 2);
+        }
+    }
+    else if (size == 4)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            uint32_t val;
+            memcpy (&val, src + (i * 4), 4);
+            val = EndianSwap32 (val);
+            memcpy (dst + (i * 4), &val, 4);
+        }
+    }
+    else
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            uint64_t val;
+            memcpy (&val, src + (i * 8), 8);
+            val = EndianSwap64 (val);
+            memcpy (dst + (i * 8), &val, 8);
+        }
+    }
 }
 
-LIBNEX_PUBLIC int EndianWrite16 (uint16_t* buf, uint16_t val, const char endian)
+#ifdef LIBNEX_CPU_X86
+// Shuffle masks that reverse each 2, 4, or 8 byte element of a 16 byte vector
+static const uint8_t __attribute__ ((aligned (16))) endianShufMasks[3][16] = {
+    {1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14},
+    {3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12},
+    {7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8}};
+
+// Swaps elements 16 bytes at a time with pshufb
+__attribute__ ((target ("ssse3"))) static void endianSwapSsse3 (uint8_t* dst,
+                                                                 const uint8_t* src,
+                                                                 size_t count,
+                                                                 int size)
 {
-    if (!buf)
-        return 0;
-    // Swapping must occur is target endian and host endian are different
-    if (endian != EndianHost())
-        *buf = EndianSwap16 (val);
-    else
-        *buf = val;
-    return 1;
+    __m128i mask = _mm_load_si128 ((const __m128i*) endianShufMasks[size >> 2]);
+    size_t bytes = count * size;
+    size_t i = 0;
+    for (; (i + 16) <= bytes; i += 16)
+    {
+        __m128i val = _mm_loadu_si128 ((const __m128i*) (src + i));
+        _mm_storeu_si128 ((__m128i*) (dst + i), _mm_shuffle_epi8 (val, mask));
+    }
+    endianSwapScalar (dst + i, src + i, (bytes - i) / size, size);
 }
 
-LIBNEX_PUBLIC int EndianWrite32 (uint32_t* buf, uint32_t val, const char endian)
+// Swaps elements 64 bytes at a time with vpshufb
+__attribute__ ((target ("avx2"))) static void endianSwapAvx2 (uint8_t* dst,
+                                                               const uint8_t* src,
+                                                               size_t count,
+                                                               int size)
 {
-    if (!buf)
-        return 0;
-    // Swapping must occur is target endian and host endian are different
-    if (endian != EndianHost())
-        *buf = EndianSwap32 (val);
+    __m256i mask = _mm256_broadcastsi128_si256 (_mm_load_si128 ((const __m128i*) endianShufMasks[size >> 2]));
+    size_t bytes = count * size;
+    size_t i = 0;
+    for (; (i + 64) <= bytes; i += 64)
+    {
+        __m256i val1 = _mm256_loadu_si256 ((const __m256i*) (src + i));
+        __m256i val2 = _mm256_loadu_si256 ((const __m256i*) (src + i + 32));
+        _mm256_storeu_si256 ((__m256i*) (dst + i), _mm256_shuffle_epi8 (val1, mask));
+        _mm256_storeu_si256 ((__m256i*) (dst + i + 32), _mm256_shuffle_epi8 (val2, mask));
+    }
+    for (; (i + 32) <= bytes; i += 32)
+    {
+        __m256i val = _mm256_loadu_si256 ((const __m256i*) (src + i));
+        _mm256_storeu_si256 ((__m256i*) (dst + i), _mm256_shuffle_epi8 (val, mask));
+    }
+    endianSwapScalar (dst + i, src + i, (bytes - i) / size, size);
+}
+#elif defined LIBNEX_CPU_ARM && !defined LIBNEX_BAREMETAL
+// Swaps elements 16 bytes at a time with rev
+static void endianSwapNeon (uint8_t* dst, const uint8_t* src, size_t count, int size)
+{
+    size_t bytes = count * size;
+    size_t i = 0;
+    if (size == 2)
+    {
+        for (; (i + 16) <= bytes; i += 16)
+            vst1q_u8 (dst + i, vrev16q_u8 (vld1q_u8 (src + i)));
+    }
+    else if (size == 4)
+    {
+        for (; (i + 16) <= bytes; i += 16)
+            vst1q_u8 (dst + i, vrev32q_u8 (vld1q_u8 (src + i)));
+    }
     else
-        *buf = val;
-    return 1;
+    {
+        for (; (i + 16) <= bytes; i += 16)
+            vst1q_u8 (dst + i, vrev64q_u8 (vld1q_u8 (src + i)));
+    }
+    endianSwapScalar (dst + i, src + i, (bytes - i) / size, size);
 }
+#endif
+
+// The kernel that the buffer functions use
+static void (*endianSwapKernel) (uint8_t*, const uint8_t*, size_t, int);
+static once_t endianInitOnce = ONCE_INIT;
 
-LIBNEX_PUBLIC int EndianWrite64 (uint64_t* buf, uint64_t val, const char endian)
+// Picks the fastest kernel out of the ones features allow
+static void endianPickKernel (unsigned int features)
 {
-    if (!buf)
-        return 0;
-    // Swapping must occur is target endian and host endian are different
-    if (endian != EndianHost())
-        *buf = EndianSwap64 (val);
-    else
-        *buf = val;
-    return 1;
+#if defined LIBNEX_CPU_ARM && !defined LIBNEX_BAREMETAL
+    endianSwapKernel = endianSwapNeon;
+#else
+    endianSwapKernel = endianSwapScalar;
+#endif
+#ifdef LIBNEX_CPU_X86
+    if (features & CPU_FEAT_AVX2)
+        endianSwapKernel = endianSwapAvx2;
+    else if (features & CPU_FEAT_SSSE3)
+        endianSwapKernel = endianSwapSsse3;
+#else
+    (void) features;
+#endif
 }
 
-LIBNEX_PUBLIC uint16_t EndianRead16 (const uint16_t* buf, const char endian)
+// Picks the fastest kernel the CPU supports
+static void endianInit (void)
 {
-    if (!buf)
-        return 0;
-    if (endian != EndianHost())
-        return EndianSwap16 (*buf);
-    else
-        return *buf;
+    endianPickKernel (__Libnex_cpu_features());
 }
 
-LIBNEX_PUBLIC uint32_t EndianRead32 (const uint32_t* buf, const char endian)
+#ifdef LIBNEX_KERNEL_HOOKS
+LIBNEX_PUBLIC void __Libnex_endian_set_features (unsigned int features)
 {
-    if (!buf)
-        return 0;
-    if (endian != EndianHost())
-        return EndianSwap32 (*buf);
-    else
-        return *buf;
+    __Libnex_once (&endianInitOnce, endianInit);
+    endianPickKernel (features & __Libnex_cpu_features());
 }
+#endif
 
-LIBNEX_PUBLIC uint64_t EndianRead64 (const uint64_t* buf, const char endian)
+// Swaps a buffer of count elements of size bytes each
+static void endianSwapBuf (void* dst, const void* src, size_t count, int size)
 {
-    if (!buf)
-        return 0;
-    if (endian != EndianHost())
-        return EndianSwap64 (*buf);
-    else
-        return *buf;
+    __Libnex_once (&endianInitOnce, endianInit);
+    endianSwapKernel (dst, src, count, size);
 }
 
-LIBNEX_PUBLIC uint16_t EndianChange16 (uint16_t val, const char endian)
+// Converts a buffer of count elements of size bytes each between host order and endian
+static void endianConvertBuf (void* dst, const void* src, size_t count, int size, const char endian)
 {
     if (endian != EndianHost())
-        return EndianSwap16 (val);
-    else
-        return val;
+        endianSwapBuf (dst, src, count, size);
+    else if (dst != src)
+        memcpy (dst, src, count * size);
 }
 
-LIBNEX_PUBLIC uint32_t EndianChange32 (uint32_t val, const char endian)
+LIBNEX_PUBLIC void EndianSwapBuf16 (void* dst, const void* src, size_t count)
 {
-    if (endian != EndianHost())
-        return EndianSwap32 (val);
-    else
-        return val;
+    endianSwapBuf (dst, src, count, 2);
 }
 
-LIBNEX_PUBLIC uint64_t EndianChange64 (uint64_t val, const char endian)
+LIBNEX_PUBLIC void EndianSwapBuf32 (void* dst, const void* src, size_t count)
 {
-    if (endian != EndianHost())
-        return EndianSwap64 (val);
-    else
-        return val;
+    endianSwapBuf (dst, src, count, 4);
+}
+
+LIBNEX_PUBLIC void EndianSwapBuf64 (void* dst, const void* src, size_t count)
+{
+    endianSwapBuf (dst, src, count, 8);
+}
+
+LIBNEX_PUBLIC void EndianConvertBuf16 (void* dst, const void* src, size_t count, const char endian)
+{
+    endianConvertBuf (dst, src, count, 2, endian);
+}
+
+LIBNEX_PUBLIC void EndianConvertBuf32 (void* dst, const void* src, size_t count, const char endian)
+{
+    endianConvertBuf (dst, src, count, 4, endian);
+}
+
+LIBNEX_PUBLIC void EndianConvertBuf64 (void* dst, const void* src, size_t count, const char endian)
+{
+    endianConvertBuf (dst, src, count, 8, endian);
 }
@@ -16,12 +16,21 @@
     limitations under the License.
 */
 
+#include <assert.h>
 #include <libnex/hash.h>
+#include <libnex/lock.h>
+#include <libnex/safemalloc.h>
+#include <stdlib.h>
+#include <string.h>
 
 // Hash function parameters
 #define HASH_FNV1A_PRIME       16777619
 #define HASH_FNV1A_OFFSET_BASE 2166136261
 
+// 64-bit hash function parameters
+#define HASH_FNV1A_PRIME64       1099511628211ULL
+#define HASH_FNV1A_OFFSET_BASE64 14695981039346656037ULL
+
 uint32_t HashCreateHash (const void* data, size_t sz)
 {
     // Get buffer bounds
@@ -51,3 +60,314 @@ uint32_t HashCreateHashStr (const char* str)
     }
     return hash;
 }
+
+LIBNEX_PUBLIC uint64_t HashCreateHash64 (const void* data, size_t sz)
+{
+    const uint8_t* buf = data;
+    const uint8_t* bufEnd = buf + sz;
+    uint64_t hash = HASH_FNV1A_OFFSET_BASE64;
+    while (buf < bufEnd)
+    {
+        hash ^= (uint64_t) *buf++;
+        hash *= HASH_FNV1A_PRIME64;
+    }
+    return hash;
+}
+
+// Gets bucket index of hash in a bucket array of size numBuckets
+#define HashBucket(hash, numBuckets) ((hash) & ((numBuckets) - 1))
+
+// Rounds sz up to a power of 2
+static size_t hashRoundBuckets (size_t sz)
+{
+    size_t res = 1;
+    while (res < sz)
+        res <<= 1;
+    return res;
+}
+
+// Finds entry with key in a chain of entries
+static HashEntry_t* hashFindInChain (HashEntry_t* entry, uint32_t hash, const void* key, size_t keyLen)
+{
+    while (entry)
+    {
+        if (entry->hash == hash && entry->keyLen == keyLen && !memcmp (entry->key, key, keyLen))
+            return entry;
+        entry = entry->next;
+    }
+    return NULL;
+}
+
+// Migrates up to count buckets from old bucket array to new one. Assumes table is locked
+static void hashMigrateBuckets (HashTable_t* table, size_t count)
+{
+    if (!table->oldBuckets)
+        return;
+    while (count && table->migratePos < table->numOldBuckets)
+    {
+        // Move each entry in this bucket to its new home
+        HashEntry_t* entry = table->oldBuckets[table->migratePos];
+        while (entry)
+        {
+            HashEntry_t* next = entry->next;
+            size_t bucket = HashBucket (entry->hash, table->numBuckets);
+            entry->next = table->buckets[bucket];
+            table->buckets[bucket] = entry;
+            entry = next;
+        }
+        table->oldBuckets[table->migratePos] = NULL;
+        ++table->migratePos;
+        --count;
+    }
+    // Check if we are done
+    if (table->migratePos == table->numOldBuckets)
+    {
+        free (table->oldBuckets);
+        table->oldBuckets = NULL;
+        table->numOldBuckets = 0;
+        table->migratePos = 0;
+    }
+}
+
+// Grows the table if the load factor has been reached. Assumes table is locked
+static bool hashGrowMaybe (HashTable_t* table)
+{
+    if (table->numEntries < table->numBuckets)
+        return true;
+    // If a previous migration is still running, finish it now
+    hashMigrateBuckets (table, SIZE_MAX);
+    // Allocate new bucket array
+    HashEntry_t** newBuckets = calloc_s (table->numBuckets * 2 * sizeof (HashEntry_t*));
+    if (!newBuckets)
+        return false;
+    table->oldBuckets = table->buckets;
+    table->numOldBuckets = table->numBuckets;
+    table->migratePos = 0;
+    table->buckets = newBuckets;
+    table->numBuckets *= 2;
+    // If we aren't incremental, pay for the whole thing now
+    if (!(table->flags & HASH_FLAG_INCREMENTAL))
+        hashMigrateBuckets (table, SIZE_MAX);
+    return true;
+}
+
+LIBNEX_PUBLIC HashTable_t* HashCreate (size_t numBuckets, int flags)
+{
+    HashTable_t* table = calloc_s (sizeof (HashTable_t));
+    if (!table)
+        return NULL;
+    if (!numBuckets)
+        numBuckets = HASH_DEFAULT_BUCKETS;
+    table->numBuckets = hashRoundBuckets (numBuckets);
+    table->buckets = calloc_s (table->numBuckets * sizeof (HashEntry_t*));
+    if (!table->buckets)
+    {
+        free (table);
+        return NULL;
+    }
+    table->flags = flags;
+    ObjCreate ("HashTable_t", &table->obj);
+    return table;
+}
+
+// Destroys every entry in a bucket array
+static void hashDestroyBuckets (HashTable_t* table, HashEntry_t** buckets, size_t numBuckets)
+{
+    for (size_t i = 0; i < numBuckets; ++i)
+    {
+        HashEntry_t* entry = buckets[i];
+        while (entry)
+        {
+            HashEntry_t* next = entry->next;
+            if (table->destroyFunc)
+                table->destroyFunc (entry->data);
+            free (entry);
+            entry = next;
+        }
+    }
+    free (buckets);
+}
+
+LIBNEX_PUBLIC void HashDestroy (HashTable_t* table)
+{
+    assert (table);
+    HashLock (table);
+    if (!ObjDestroy (&table->obj))
+    {
+        HashUnlock (table);
+        if (table->oldBuckets)
+            hashDestroyBuckets (table, table->oldBuckets, table->numOldBuckets);
+        hashDestroyBuckets (table, table->buckets, table->numBuckets);
+        free (table);
+    }
+    else
+        HashUnlock (table);
+}
+
+LIBNEX_PUBLIC void HashSetDestroy (HashTable_t* table, HashEntryDestroy func)
+{
+    assert (table);
+    HashLock (table);
+    table->destroyFunc = func;
+    HashUnlock (table);
+}
+
+// Gets pointer to bucket that an entry with hash lives in. Assumes table is locked
+static HashEntry_t** hashGetBucket (HashTable_t* table, uint32_t hash)
+{
+    // If this bucket hasn't been migrated yet, then it's in the old array
+    if (table->oldBuckets)
+    {
+        size_t oldBucket = HashBucket (hash, table->numOldBuckets);
+        if (oldBucket >= table->migratePos)
+            return &table->oldBuckets[oldBucket];
+    }
+    return &table->buckets[HashBucket (hash, table->numBuckets)];
+}
+
+LIBNEX_PUBLIC HashEntry_t* HashAdd (HashTable_t* table, const void* key, size_t keyLen, void* data)
+{
+    assert (table && key);
+    uint32_t hash = HashCreateHash (key, keyLen);
+    HashLock (table);
+    // Do a bit of migration work
+    hashMigrateBuckets (table, HASH_MIGRATE_STEP);
+    // Ensure this key doesn't exist
+    if (hashFindInChain (*hashGetBucket (table, hash), hash, key, keyLen))
+    {
+        HashUnlock (table);
+        return NULL;
+    }
+    if (!hashGrowMaybe (table))
+    {
+        HashUnlock (table);
+        return NULL;
+    }
+    HashEntry_t* entry = malloc_s (sizeof (HashEntry_t));
+    if (!entry)
+    {
+        HashUnlock (table);
+        return NULL;
+    }
+    entry->key = key;
+    entry->keyLen = keyLen;
+    entry->hash = hash;
+    entry->data = data;
+    // Link it into bucket
+    HashEntry_t** bucket = hashGetBucket (table, hash);
+    entry->next = *bucket;
+    *bucket = entry;
+    ++table->numEntries;
+    HashUnlock (table);
+    return entry;
+}
+
+LIBNEX_PUBLIC HashEntry_t* HashFind (HashTable_t* table, const void* key, size_t keyLen)
+{
+    assert (table && key);
+    uint32_t hash = HashCreateHash (key, keyLen);
+    HashLock (table);
+    HashEntry_t* entry = hashFindInChain (*hashGetBucket (table, hash), hash, key, keyLen);
+    HashUnlock (table);
+    return entry;
+}
+
+LIBNEX_PUBLIC bool HashRemove (HashTable_t* table, const void* key, size_t keyLen)
+{
+    assert (table && key);
+    uint32_t hash = HashCreateHash (key, keyLen);
+    HashLock (table);
+    hashMigrateBuckets (table, HASH_MIGRATE_STEP);
+    // Find the link pointing to the entry
+    HashEntry_t** link = hashGetBucket (table, hash);
+    while (*link)
+    {
+        HashEntry_t* entry = *link;
+        if (entry->hash == hash && entry->keyLen == keyLen && !memcmp (entry->key, key, keyLen))
+        {
+            *link = entry->next;
+            --table->numEntries;
+            HashUnlock (table);
+            if (table->destroyFunc)
+                table->destroyFunc (entry->data);
+            free (entry);
+            return true;
+        }
+        link = &entry->next;
+    }
+    HashUnlock (table);
+    return false;
+}
+
+// Removes entries matched by pred in a bucket array. Assumes table is locked
+static size_t hashRemoveIfBuckets (HashTable_t* table,
+                                   HashEntry_t** buckets,
+                                   size_t start,
+                                   size_t numBuckets,
+                                   HashEntryPred pred,
+                                   void* arg)
+{
+    size_t removed = 0;
+    for (size_t i = start; i < numBuckets; ++i)
+    {
+        HashEntry_t** link = &buckets[i];
+        while (*link)
+        {
+            HashEntry_t* entry = *link;
+            if (pred (entry, arg))
+            {
+                *link = entry->next;
+                if (table->destroyFunc)
+                    table->destroyFunc (entry->data);
+                free (entry);
+                ++removed;
+            }
+            else
+                link = &entry->next;
+        }
+    }
+    return removed;
+}
+
+LIBNEX_PUBLIC size_t HashRemoveIf (HashTable_t* table, HashEntryPred pred, void* arg)
+{
+    assert (table && pred);
+    HashLock (table);
+    size_t removed = 0;
+    // Unmigrated buckets are still in the old array
+    if (table->oldBuckets)
+    {
+        removed += hashRemoveIfBuckets (table,
+                                        table->oldBuckets,
+                                        table->migratePos,
+                                        table->numOldBuckets,
+                                        pred,
+                                        arg);
+    }
+    removed += hashRemoveIfBuckets (table, table->buckets, 0, table->numBuckets, pred, arg);
+    table->numEntries -= removed;
+    HashUnlock (table);
+    return removed;
+}
+
+LIBNEX_PUBLIC size_t HashMigrate (HashTable_t* table, size_t count)
+{
+    assert (table);
+    HashLock (table);
+    hashMigrateBuckets (table, count);
+    size_t left = table->numOldBuckets - table->migratePos;
+    HashUnlock (table);
+    return left;
+}
+
+LIBNEX_PUBLIC void HashGetStats (HashTable_t* table, HashStats_t* stats)
+{
+    assert (table && stats);
+    HashLock (table);
+    stats->numEntries = table->numEntries;
+    stats->numBuckets = table->numBuckets;
+    stats->numOldBuckets = table->numOldBuckets;
+    stats->bucketsLeft = table->numOldBuckets - table->migratePos;
+    stats->isResizing = table->oldBuckets != NULL;
+    HashUnlock (table);
+}
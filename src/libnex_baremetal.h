@@ -22,11 +22,14 @@
 #define _LIBNEX_H
 
 #include <libnex/bits.h>
+#include <libnex/bloom.h>
+#include <libnex/codepage.h>
 #include <libnex/container.h>
 #include <libnex/crc32.h>
 #include <libnex/endian.h>
 #include <libnex/safestring.h>
 #include <libnex/unicode.h>
+#include <libnex/varint.h>
 #include <libnex/array.h>
 #include <libnex/list.h>
 
@@ -27,6 +27,7 @@
 #cmakedefine HAVE_VISIBILITY
 #cmakedefine HAVE_DECLSPEC_EXPORT
 #cmakedefine LIBNEX_ENABLE_NLS
+#cmakedefine LIBNEX_KERNEL_HOOKS
 #ifdef LIBNEX_ENABLE_NLS
 #define LIBNEX_LOCALE_BASE "@LIBNEX_LOCALE_BASE@"
 #endif
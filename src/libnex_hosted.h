@@ -22,6 +22,9 @@
 #define _LIBNEX_H
 
 #include <libnex/bits.h>
+#include <libnex/bloom.h>
+#include <libnex/codepage.h>
+#include <libnex/bytestream.h>
 #include <libnex/container.h>
 #include <libnex/crc32.h>
 #include <libnex/endian.h>
@@ -32,6 +35,7 @@
 #include <libnex/safestring.h>
 #include <libnex/textstream.h>
 #include <libnex/unicode.h>
+#include <libnex/varint.h>
 #include <libnex/array.h>
 #include <libnex/list.h>
 
@@ -99,3 +99,38 @@ void __Libnex_lock_destroy (lock_t* lock)
     UNUSED (lock);
 #endif
 }
+
+/**
+ * @brief Runs a function exactly once
+ *
+ * Wraps over call_once or pthread_once. Every caller returns after func has finished
+ * @param once the flag tracking if func has run. Must be initialized to ONCE_INIT
+ * @param func the function to run
+ */
+void __Libnex_once (once_t* once, void (*func) (void))
+{
+#ifdef HAVE_C11_THREADS
+    call_once (once, func);
+#elif defined HAVE_PTHREADS
+    pthread_once (once, func);
+#elif defined LIBNEX_BAREMETAL
+    // 0 means not run, 1 means running, 2 means done
+    char expected = 0;
+    if (__atomic_compare_exchange_n (once, &expected, 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE))
+    {
+        func();
+        __atomic_store_n (once, 2, __ATOMIC_RELEASE);
+    }
+    else
+    {
+        while (__atomic_load_n (once, __ATOMIC_ACQUIRE) != 2)
+            ;
+    }
+#else
+    if (!*once)
+    {
+        func();
+        *once = 1;
+    }
+#endif
+}
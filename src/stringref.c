@@ -18,9 +18,12 @@
 
 /// @file stringref.c
 
+#include <assert.h>
+#include <libnex/lock.h>
 #include <libnex/safemalloc.h>
 #include <libnex/stringref.h>
 #include <stdlib.h>
+#include <string.h>
 
 void destroyRef (const Object_t* obj)
 {
@@ -42,3 +45,97 @@ LIBNEX_PUBLIC StringRef_t* StrRefCreate (const void* s)
     ObjSetDestroy (&newRef->obj, destroyRef);
     return newRef;
 }
+
+// Drops the pool's reference to a string
+static void destroyPoolEntry (void* data)
+{
+    StrRefDestroy ((StringRef_t*) data);
+}
+
+LIBNEX_PUBLIC StrRefPool_t* StrRefPoolCreate()
+{
+    StrRefPool_t* pool = malloc_s (sizeof (StrRefPool_t));
+    if (!pool)
+        return NULL;
+    pool->table = HashCreate (0, HASH_FLAG_INCREMENTAL);
+    if (!pool->table)
+    {
+        free (pool);
+        return NULL;
+    }
+    HashSetDestroy (pool->table, destroyPoolEntry);
+    ObjCreate ("StrRefPool_t", &pool->obj);
+    return pool;
+}
+
+LIBNEX_PUBLIC void StrRefPoolDestroy (StrRefPool_t* pool)
+{
+    assert (pool);
+    StrRefPoolLock (pool);
+    if (!ObjDestroy (&pool->obj))
+    {
+        StrRefPoolUnlock (pool);
+        HashDestroy (pool->table);
+        free (pool);
+    }
+    else
+        StrRefPoolUnlock (pool);
+}
+
+LIBNEX_PUBLIC StringRef_t* StrRefInternBuf (StrRefPool_t* pool, const void* s, size_t sz)
+{
+    assert (pool && s);
+    StrRefPoolLock (pool);
+    // Check if we already have this string
+    HashEntry_t* entry = HashFind (pool->table, s, sz);
+    if (entry)
+    {
+        StringRef_t* ref = StrRefNew (HashEntryData (entry));
+        StrRefPoolUnlock (pool);
+        return ref;
+    }
+    // Copy it, leaving room for a terminator wide enough for char32_t
+    uint8_t* str = malloc_s (sz + sizeof (uint32_t));
+    if (!str)
+    {
+        StrRefPoolUnlock (pool);
+        return NULL;
+    }
+    memcpy (str, s, sz);
+    memset (str + sz, 0, sizeof (uint32_t));
+    StringRef_t* ref = StrRefCreate (str);
+    // The key points into the string itself, which lives as long as the pool's reference
+    if (!HashAdd (pool->table, str, sz, ref))
+    {
+        StrRefPoolUnlock (pool);
+        StrRefDestroy (ref);
+        return NULL;
+    }
+    StrRefPoolUnlock (pool);
+    return StrRefNew (ref);
+}
+
+LIBNEX_PUBLIC StringRef_t* StrRefIntern (StrRefPool_t* pool, const char* s)
+{
+    return StrRefInternBuf (pool, s, strlen (s));
+}
+
+// Checks if only the pool references a string
+static bool isUnreferenced (const HashEntry_t* entry, void* arg)
+{
+    UNUSED (arg);
+    StringRef_t* ref = HashEntryData (entry);
+    ObjLock (&ref->obj);
+    bool res = ref->obj.refCount == 1;
+    ObjUnlock (&ref->obj);
+    return res;
+}
+
+LIBNEX_PUBLIC size_t StrRefPoolPurge (StrRefPool_t* pool)
+{
+    assert (pool);
+    StrRefPoolLock (pool);
+    size_t evicted = HashRemoveIf (pool->table, isUnreferenced, NULL);
+    StrRefPoolUnlock (pool);
+    return evicted;
+}
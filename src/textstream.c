@@ -18,12 +18,10 @@
 
 /// @file textstream.c
 
-#include "codepages/win1252toUtf32.h"
 #include "internal.h"
 #include <assert.h>
 #include <errno.h>
 #include <libnex/base.h>
-#include <libnex/bits.h>
 #include <libnex/endian.h>
 #include <libnex/safemalloc.h>
 #include <libnex/textstream.h>
@@ -33,33 +31,35 @@
 #include <string.h>
 #include <sys/stat.h>
 
-// Helper macros
-#define TEXT_DEFAULT_BUFSZ 1024    // Staging buffer has a default size of 4 KiB
-
-// Reads in a new frame if needed. Returns error code or TEXT_SUCCESS
-static short _textReadFrameMaybe (TextStream_t* stream)
+// Makes sure at least need octets are left in the frame. What's left of the frame is moved to the
+// start of the buffer, and the next frame is read in behind it, so that characters can straddle frames
+// Fewer than need octets are left if the file ends first. Returns error code or TEXT_SUCCESS
+static short _textFill (TextStream_t* stream, size_t need)
 {
     assert (stream);
     assert (stream->mode == TEXT_MODE_READ);
-    // Check if we need to read in a new frame
-    if (stream->bufPos >= stream->bufSize)
+    assert (need <= stream->bufCap);
+    size_t left = stream->bufSize - stream->bufPos;
+    if (left >= need)
+        return TEXT_SUCCESS;
+    memmove (stream->buf, stream->buf + stream->bufPos, left);
+    stream->bufPos = 0;
+    stream->bufSize = left;
+    // Read it in
+    size_t bytesRead = fread (stream->buf + left, 1, stream->bufCap - left, stream->file);
+    if (!bytesRead && ferror (stream->file))
+        return TEXT_SYS_ERROR;
+    stream->bufSize += bytesRead;
+    // If the frame filled up, the file is being read through, so make the next frame bigger
+    if (stream->isAdaptive && stream->bufSize == stream->bufCap && stream->bufCap < TEXT_MAX_BUFSZ)
     {
-        // Read it in
-        size_t bytesRead = fread (stream->buf, 1, stream->bufSize, stream->file);
-        // Check if we are at the end of the file
-        if (feof (stream->file) && !bytesRead)
+        // Not growing isn't an error, we just keep the current size
+        uint8_t* buf = (uint8_t*) realloc (stream->buf, stream->bufCap * 2);
+        if (buf)
         {
-            // Report EOF. Note that EOF may come when we aren't finished parsing yet.
-            // For this reason, onlt report EOF when bytesRead == 0, and we truly are finished
-            stream->isEof = true;
-            return TEXT_SUCCESS;
+            stream->buf = buf;
+            stream->bufCap *= 2;
         }
-        // Check for failure
-        if (bytesRead == 0)
-            return TEXT_SYS_ERROR;
-        // Ensure the buffer size is limited to the number of bytes read
-        stream->bufSize = bytesRead;
-        stream->bufPos = 0;
     }
     return TEXT_SUCCESS;
 }
@@ -81,180 +81,150 @@ static short _textWriteFrameMaybe (TextStream_t* stream, bool force)
     return TEXT_SUCCESS;
 }
 
-// Macro to help checking for a newline
-#define CHECK_NEWLINE            \
-    if (stopOnLine)              \
-    {                            \
-        if (buf[i] == '\n')      \
-            break;               \
-        else if (buf[i] == '\r') \
-        {                        \
-            buf[i] = '\n';       \
-            foundCr = true;      \
-        }                        \
-    }
-
-// Macro to help reading in a buffer
-#define READ_BUFFER                     \
-    res = _textReadFrameMaybe (stream); \
-    if (res != TEXT_SUCCESS)            \
-        return res;                     \
-    if (stream->isEof)                  \
-        goto end;
-
 // Macro to help writing a buffer
 #define WRITE_BUFFER                            \
     res = _textWriteFrameMaybe (stream, false); \
     if (res != TEXT_SUCCESS)                    \
         return res;
 
-// Decodes count characters of text
-static short _textDecode (TextStream_t* stream, char32_t* buf, size_t count, size_t* charsRead, bool stopOnLine)
+// Gets the size of the units that make up the stream's characters
+static size_t _textUnitSize (const TextStream_t* stream)
 {
-    assert (stream && buf);
+    if (stream->encoding == TEXT_ENC_UTF32)
+        return 4;
+    else if (stream->encoding == TEXT_ENC_UTF16)
+        return 2;
+    return 1;
+}
 
-    bool foundCr = false;
-    size_t charsParsed = 0;
-    short res = TEXT_SUCCESS;
-    int i = 0;
-    // Decide what encoding we are decoding
-    if (stream->encoding == TEXT_ENC_ASCII)
+// Loads the unit at in
+static char32_t _textLoadUnit (const TextStream_t* stream, const uint8_t* in)
+{
+    if (stream->encoding == TEXT_ENC_UTF32)
+        return EndianLoad32 (in, stream->order);
+    else if (stream->encoding == TEXT_ENC_UTF16)
+        return EndianLoad16 (in, stream->order);
+    return *in;
+}
+
+// Gets the number of octets of in up to and including the first CR or LF, or len if there is none
+static size_t _textLineLen (const TextStream_t* stream, const uint8_t* in, size_t len)
+{
+    if (stream->encoding == TEXT_ENC_UTF32 || stream->encoding == TEXT_ENC_UTF16)
     {
-        // This is easy. Loop through stream->buf, casting.
-        for (; i < (count - 1); ++i)
+        size_t unitSize = _textUnitSize (stream);
+        for (size_t i = 0; (i + unitSize) <= len; i += unitSize)
         {
-            // Maybe read the buffer
-            READ_BUFFER
-            assert (foundCr ? stopOnLine : true);
-            // If we are simply skipping an LF, don't copy out a character
-            if (!foundCr)
-                buf[i] = (char32_t) stream->buf[stream->bufPos];
-            // If we are looking for a LF, only advance if an LF is found
-            if (!foundCr || (foundCr && stream->buf[stream->bufPos] == '\n'))
-            {
-                ++stream->bufPos;
-                ++charsParsed;
-            }
-            // Check if we should stop on newline
-            CHECK_NEWLINE
+            char32_t c = _textLoadUnit (stream, in + i);
+            if (c == '\n' || c == '\r')
+                return i + unitSize;
         }
+        return len;
     }
-    else if (stream->encoding == TEXT_ENC_WIN1252)
+    // Every other encoding is ASCII compatible, and CR and LF never appear inside of a UTF-8 sequence
+    const uint8_t* lf = memchr (in, '\n', len);
+    size_t lineLen = lf ? (size_t) (lf - in) + 1 : len;
+    const uint8_t* cr = memchr (in, '\r', lineLen);
+    return cr ? (size_t) (cr - in) + 1 : lineLen;
+}
+
+// Decodes as many whole characters of in as fit in out. A character cut off at the end of in
+// is left alone. Returns the number of characters decoded, and sets consumed to the octets used
+static size_t _textDecodeRun (TextStream_t* stream,
+                              char32_t* out,
+                              size_t outSz,
+                              const uint8_t* in,
+                              size_t len,
+                              size_t* consumed)
+{
+    size_t decoded = 0;
+    if (stream->codepage)
     {
-        // Loop through the buffer
-        for (; i < (count - 1); ++i)
-        {
-            READ_BUFFER
-            assert (foundCr ? stopOnLine : true);
-            // If we are simply skipping an LF, don't copy out a character
-            if (!foundCr)
-            {
-                // Here is the algorithm for decoding: If stream->buf[stream->bufPos] doesn't have bit 7 set,
-                // or it is an ISO-8859-1 character, we copy it directly.
-                // Else, we go into the Windows 1252 to Unicode decoding table
-                // to get the right character
-                if (BitGet (stream->buf[stream->bufPos], 7) == 0 || stream->buf[stream->bufPos] >= 0xA0)
-                {
-                    // This character lies in the ASCII or ISO-8859-1 realm
-                    buf[i] = (char32_t) stream->buf[stream->bufPos];
-                }
-                else
-                {
-                    // Translate from table
-                    buf[i] = win1252toUtf32[BitClearNew (stream->buf[stream->bufPos], 7)];
-                }
-            }
-            // If we are looking for a LF, only advance if an LF is found
-            if (!foundCr || (foundCr && stream->buf[stream->bufPos] == '\n'))
-            {
-                ++stream->bufPos;
-                ++charsParsed;
-            }
-            CHECK_NEWLINE
-        }
+        // Single byte sets decode one character per octet
+        decoded = (len < outSz) ? len : outSz;
+        CodepageDecode (stream->codepage, out, in, decoded);
+        *consumed = decoded;
     }
     else if (stream->encoding == TEXT_ENC_UTF32)
     {
-        for (; i < (count - 1); ++i)
-        {
-            // Maybe read the buffer
-            READ_BUFFER
-            assert (foundCr ? stopOnLine : true);
-            // If we are simply skipping an LF, don't copy out a character
-            if (!foundCr)
-                buf[i] = EndianRead32 ((char32_t*) (stream->buf + stream->bufPos), stream->order);
-            // If we are looking for a LF, only advance if an LF is found
-            if (!foundCr ||
-                (foundCr && (EndianRead32 ((char32_t*) (stream->buf + stream->bufPos), stream->order) == '\n')))
-            {
-                stream->bufPos += 4;
-                ++charsParsed;
-            }
-            // Check if we should stop on newline
-            CHECK_NEWLINE
-        }
+        decoded = ((len / 4) < outSz) ? (len / 4) : outSz;
+        for (size_t i = 0; i < decoded; ++i)
+            out[i] = EndianLoad32 (in + (i * 4), stream->order);
+        *consumed = decoded * 4;
     }
     else if (stream->encoding == TEXT_ENC_UTF16)
     {
-        for (; i < (count - 1); ++i)
-        {
-            READ_BUFFER
-            assert (foundCr ? stopOnLine : true);
-            if (!foundCr)
-            {
-                // FIXME: If stream->buf's last 16 bit element is a surrogate pair,
-                // then this will return TEXT_INVALID_CHAR (as it would be an incomplete pair)
-                ssize_t u16sParsed = (ssize_t) UnicodeDecode16 (&buf[i],
-                                                                ((uint16_t*) (stream->buf + stream->bufPos)),
-                                                                stream->bufSize - stream->bufPos,
-                                                                stream->order);
-                if (u16sParsed == 0)
-                    return TEXT_INVALID_CHAR;
-                stream->bufPos += (u16sParsed * 2);
-                ++charsParsed;
-            }
-            if (foundCr && (EndianRead16 ((uint16_t*) (stream->buf + stream->bufPos), stream->order) == '\n'))
-            {
-                stream->bufPos += 2;
-                ++charsParsed;
-            }
-            CHECK_NEWLINE
-        }
+        // Without a state, a split surrogate pair is left for the next frame
+        size_t u16sParsed = 0;
+        decoded = UnicodeDecode16Buf (out, outSz, (const uint16_t*) in, len / 2, stream->order, NULL, &u16sParsed);
+        *consumed = u16sParsed * 2;
     }
     else if (stream->encoding == TEXT_ENC_UTF8)
+        decoded = UnicodeDecode8Buf (out, outSz, in, len, consumed);
+    return decoded;
+}
+
+// Decodes count characters of text
+// Whole runs of the frame are decoded at a time, and the next frame is only read in once one runs out
+static short _textDecode (TextStream_t* stream, char32_t* buf, size_t count, size_t* charsRead, bool stopOnLine)
+{
+    assert (stream && buf);
+
+    size_t charsParsed = 0;
+    short res = TEXT_SUCCESS;
+    size_t i = 0;
+    while (i < (count - 1))
     {
-        for (; i < (count - 1); ++i)
+        // Decode as much of the frame as we can, stopping at the end of the line if need be
+        size_t avail = stream->bufSize - stream->bufPos;
+        const uint8_t* in = stream->buf + stream->bufPos;
+        size_t len = stopOnLine ? _textLineLen (stream, in, avail) : avail;
+        size_t consumed = 0;
+        size_t decoded = len ? _textDecodeRun (stream, buf + i, count - 1 - i, in, len, &consumed) : 0;
+        stream->bufPos += consumed;
+        i += decoded;
+        charsParsed += decoded;
+        if (stopOnLine && decoded && (buf[i - 1] == '\n' || buf[i - 1] == '\r'))
         {
-            assert (foundCr ? stopOnLine : true);
-            if (!foundCr)
+            // Turn CR and CR LF into LF
+            if (buf[i - 1] == '\r')
             {
-                // Decode part by part
-                Utf8State_t state;
-                UnicodeStateInit (state);
-                while (!UnicodeIsAccepted (state))
+                buf[i - 1] = '\n';
+                size_t unitSize = _textUnitSize (stream);
+                res = _textFill (stream, unitSize);
+                if (res != TEXT_SUCCESS)
+                    return res;
+                if ((stream->bufSize - stream->bufPos) >= unitSize &&
+                    _textLoadUnit (stream, stream->buf + stream->bufPos) == '\n')
                 {
-                    // Read in a buffer if needed
-                    READ_BUFFER
-                    size_t u8sparsed = UnicodeDecodePart8 (&buf[i], stream->buf[stream->bufPos], &state);
-                    if (u8sparsed == 0)
-                    {
-                        buf[i] = 0xFFFD;
-                        stream->bufPos += 1;
-                        break;
-                    }
-                    stream->bufPos += u8sparsed;
+                    stream->bufPos += unitSize;
+                    ++charsParsed;
                 }
-                ++charsParsed;
             }
-            if (foundCr && stream->buf[stream->bufPos] == '\n')
-            {
-                ++stream->bufPos;
-                ++charsParsed;
-            }
-            CHECK_NEWLINE
+            break;
         }
+        if (consumed)
+            continue;
+
+        // Either the frame is used up, or a character straddles it and the next one.
+        // Read in the next frame behind what's left
+        res = _textFill (stream, avail + 1);
+        if (res != TEXT_SUCCESS)
+            return res;
+        if ((stream->bufSize - stream->bufPos) > avail)
+            continue;
+        if (!avail)
+        {
+            // Report EOF. Note that EOF may come when we aren't finished parsing yet.
+            // For this reason, only report EOF when the frame is used up, and we truly are finished
+            stream->isEof = true;
+            break;
+        }
+        // The file ends in the middle of a character
+        buf[i++] = 0xFFFD;
+        ++charsParsed;
+        stream->bufPos = stream->bufSize;
     }
-end:
     buf[i] = 0;
     if (charsRead)
         *charsRead = charsParsed;
@@ -280,48 +250,20 @@ static short _textEncode (TextStream_t* stream, const char32_t* buf, size_t coun
             WRITE_BUFFER
         }
     }
-    else if (stream->encoding == TEXT_ENC_WIN1252)
+    else if (stream->codepage)
     {
-        // Loop through buffer
-        for (int i = 0; i < count; ++i)
+        // Encode as much as fits in the frame at a time
+        while (charsEncoded < count)
         {
-            res = _textWriteFrameMaybe (stream, false);
-            if (res != TEXT_SUCCESS)
-                return res;
-            // Check if this character's Unicode code
-            // is the same as its Windows-1252 one. If it is, directly copy to destination
-            // buffer
-            if (buf[i] <= 0x7F || (buf[i] >= 0xA0 && buf[i] <= 0xFF))
-            {
-                // Copy out
-                stream->buf[stream->bufPos] = (uint8_t) buf[i];
-            }
-            // It's a Windows-1252 character
-            else
-            {
-                // This is kind of slow, but the best way overall.
-                // We loop through the translation table until we find character that matches
-                // buf[i]. We set bit 7 on the index, and that's the character
-                const int tableSize = ARRAY_SIZE (win1252toUtf32);
-                int tableIndex = 0;
-                int charFound = 0;
-                while (tableIndex < tableSize)
-                {
-                    // Check for a match
-                    if (win1252toUtf32[tableIndex] == buf[i])
-                    {
-                        // Set bit 7 on tableIndex, and that is the character
-                        stream->buf[stream->bufPos] = BitSetNew (tableIndex, 7);
-                        charFound = 1;
-                        break;
-                    }
-                    ++tableIndex;
-                }
-                if (!charFound)
-                    return TEXT_INVALID_CHAR;
-            }
-            ++charsEncoded;
-            ++stream->bufPos;
+            size_t len = count - charsEncoded;
+            if (len > (stream->bufSize - stream->bufPos))
+                len = stream->bufSize - stream->bufPos;
+            size_t encoded =
+                CodepageEncode (stream->codepage, stream->buf + stream->bufPos, buf + charsEncoded, len);
+            stream->bufPos += encoded;
+            charsEncoded += encoded;
+            if (encoded < len)
+                return TEXT_INVALID_CHAR;
             WRITE_BUFFER
         }
     }
@@ -330,7 +272,14 @@ static short _textEncode (TextStream_t* stream, const char32_t* buf, size_t coun
         // Copy out
         for (int i = 0; i < count; ++i)
         {
-            EndianWrite32 ((char32_t*) (stream->buf + stream->bufPos), buf[i], stream->order);
+            // The frame might not be a multiple of 4 octets
+            if ((stream->bufSize - stream->bufPos) < 4)
+            {
+                res = _textWriteFrameMaybe (stream, true);
+                if (res != TEXT_SUCCESS)
+                    return res;
+            }
+            EndianStore32 (stream->buf + stream->bufPos, buf[i], stream->order);
             ++charsEncoded;
             stream->bufPos += 4;
             WRITE_BUFFER
@@ -341,6 +290,13 @@ static short _textEncode (TextStream_t* stream, const char32_t* buf, size_t coun
         // Copy out, encoding it
         for (int i = 0; i < count; ++i)
         {
+            // Make sure a surrogate pair doesn't run off the end of the frame
+            if ((stream->bufSize - stream->bufPos) < 4)
+            {
+                res = _textWriteFrameMaybe (stream, true);
+                if (res != TEXT_SUCCESS)
+                    return res;
+            }
             size_t u16sEncoded =
                 UnicodeEncode16 ((uint16_t*) (stream->buf + stream->bufPos), buf[i], stream->order);
             ++charsEncoded;
@@ -350,17 +306,26 @@ static short _textEncode (TextStream_t* stream, const char32_t* buf, size_t coun
     }
     else if (stream->encoding == TEXT_ENC_UTF8)
     {
-        // Copy out, encoding everything
-        for (int i = 0; i < count; ++i)
+        // Encode as much as fits in the frame at a time
+        while (charsEncoded < count)
         {
-            size_t u8sEncoded =
-                UnicodeEncode8 (stream->buf + stream->bufPos, buf[i], stream->bufSize - stream->bufPos);
-            if (u8sEncoded == 0)
+            size_t encoded = 0;
+            stream->bufPos += UnicodeEncode8Buf (stream->buf + stream->bufPos,
+                                                 stream->bufSize - stream->bufPos,
+                                                 buf + charsEncoded,
+                                                 count - charsEncoded,
+                                                 &encoded);
+            charsEncoded += encoded;
+            if (charsEncoded == count)
+                break;
+            // Either the next character is invalid, or the frame is full
+            if (buf[charsEncoded] > 0x10FFFF)
                 return TEXT_INVALID_CHAR;
-            stream->bufPos += u8sEncoded;
-            ++charsEncoded;
-            WRITE_BUFFER
+            res = _textWriteFrameMaybe (stream, true);
+            if (res != TEXT_SUCCESS)
+                return res;
         }
+        WRITE_BUFFER
     }
     return res;
 }
@@ -410,6 +375,96 @@ LIBNEX_PUBLIC short TextWrite (TextStream_t* stream, const char32_t* buf, size_t
     return res;
 }
 
+// Checks if every 32 bit unit of buf is a valid character in the given order
+static bool _textIsUtf32 (const uint8_t* buf, size_t len, char order)
+{
+    if (len < 4)
+        return false;
+    for (size_t i = 0; (i + 4) <= len; i += 4)
+    {
+        char32_t c = EndianLoad32 (buf + i, order);
+        if (c > 0x10FFFF || (c >= 0xD800 && c <= 0xDFFF))
+            return false;
+    }
+    return true;
+}
+
+LIBNEX_PUBLIC size_t TextDetectEncoding (const uint8_t* buf, size_t len, char* enc, char* order)
+{
+    assert (buf && enc && order);
+    if (len > TEXT_DETECT_MAX)
+        len = TEXT_DETECT_MAX;
+    // Check for a BOM. UTF-32's little endian BOM starts with UTF-16's, so check for it first
+    *order = TEXT_ORDER_NONE;
+    if (len >= 4 && (*order = UnicodeReadBom32 (buf)) != TEXT_ORDER_NONE)
+    {
+        *enc = TEXT_ENC_UTF32;
+        return 4;
+    }
+    if (len >= 2 && (*order = UnicodeReadBom16 (buf)) != TEXT_ORDER_NONE)
+    {
+        *enc = TEXT_ENC_UTF16;
+        return 2;
+    }
+    *enc = TEXT_ENC_UTF8;
+    if (len >= 3 && UnicodeReadBom8 (buf))
+        return 3;
+
+    // Text in UTF-16 or UTF-32 almost always has zero octets, and text in anything else almost never does
+    if (memchr (buf, 0, len))
+    {
+        if (_textIsUtf32 (buf, len, TEXT_ORDER_LE) || _textIsUtf32 (buf, len, TEXT_ORDER_BE))
+        {
+            *enc = TEXT_ENC_UTF32;
+            *order = _textIsUtf32 (buf, len, TEXT_ORDER_LE) ? TEXT_ORDER_LE : TEXT_ORDER_BE;
+            return 0;
+        }
+        // Characters below U+0100 have their upper octet be zero. Which half of the 16 bit units that
+        // octet is in gives the byte order
+        size_t zeroEven = 0;
+        size_t zeroOdd = 0;
+        for (size_t i = 0; (i + 2) <= len; i += 2)
+        {
+            zeroEven += !buf[i];
+            zeroOdd += !buf[i + 1];
+        }
+        size_t units = len / 2;
+        if (zeroOdd > (units / 4) && (zeroEven * 8) < zeroOdd)
+        {
+            *enc = TEXT_ENC_UTF16;
+            *order = TEXT_ORDER_LE;
+            return 0;
+        }
+        if (zeroEven > (units / 4) && (zeroOdd * 8) < zeroEven)
+        {
+            *enc = TEXT_ENC_UTF16;
+            *order = TEXT_ORDER_BE;
+            return 0;
+        }
+    }
+
+    // Validate it as UTF-8. The prefix may end in the middle of a sequence, so don't finish validating
+    Utf8ValidState_t state;
+    UnicodeValidateInit8 (state);
+    if (!UnicodeValidatePart8 (&state, buf, len, NULL))
+        *enc = TEXT_ENC_WIN1252;
+    return 0;
+}
+
+// Finds the codepage single byte encoding encoding is decoded with. Returns false if encoding isn't supported
+static bool _textGetCodepage (char encoding, const Codepage_t** out)
+{
+    *out = NULL;
+    if (encoding > TEXT_ENC_CODEPAGE_BASE)
+        *out = CodepageGet (encoding - TEXT_ENC_CODEPAGE_BASE);
+    // ASCII is decoded as ISO-8859-1, so that octets with bit 7 set are let through
+    else if (encoding == TEXT_ENC_ASCII)
+        *out = CodepageGet (CODEPAGE_ISO8859_1);
+    else if (encoding == TEXT_ENC_WIN1252)
+        *out = CodepageGet (CODEPAGE_WIN1252);
+    return encoding == TEXT_ENC_UTF32 || encoding == TEXT_ENC_UTF16 || encoding == TEXT_ENC_UTF8 || *out;
+}
+
 LIBNEX_PUBLIC short TextOpen (const char* file,
                               TextStream_t** out,
                               char mode,
@@ -417,19 +472,32 @@ LIBNEX_PUBLIC short TextOpen (const char* file,
                               bool hasBom,
                               char order)
 {
-    // Allocate the new stream
-    TextStream_t* stream = (TextStream_t*) malloc (sizeof (TextStream_t));
-    if (!stream)
-        return TEXT_SYS_ERROR;
-    // Allocate the staging buffer
-    stream->buf = (uint8_t*) malloc (TEXT_DEFAULT_BUFSZ);
-    if (!stream->buf)
-    {
-        free (stream);
-        errno = ENOMEM;
-        return TEXT_SYS_ERROR;
-    }
-    stream->bufSize = TEXT_DEFAULT_BUFSZ;
+    return TextOpenEx (file, out, mode, encoding, hasBom, order, NULL);
+}
+
+LIBNEX_PUBLIC short TextOpenEx (const char* file,
+                                TextStream_t** out,
+                                char mode,
+                                char encoding,
+                                bool hasBom,
+                                char order,
+                                const TextOptions_t* opts)
+{
+    // Check the parameters before the file is opened, as opening it for writing would truncate it
+    // Detection has to read the file, so it can't create one
+    if (!out || (encoding == TEXT_ENC_AUTO && mode != TEXT_MODE_READ))
+        return TEXT_INVALID_PARAMETER;
+    if (mode == TEXT_MODE_WRITE && order != TEXT_ORDER_BE && order != TEXT_ORDER_LE && order != TEXT_ORDER_NONE)
+        return TEXT_INVALID_PARAMETER;
+    // If encoding is 0, then chances are, file is in an unsupported format.
+    // The reason for this is because if we use libchardet, and TextGetEncId sees that
+    // libchardet found an encoding that we don't support, it will return 0. Then, when the user passes
+    // that ID, we will see that here
+    if (!encoding)
+        return TEXT_INVALID_ENC;
+    const Codepage_t* codepage = NULL;
+    if (encoding != TEXT_ENC_AUTO && !_textGetCodepage (encoding, &codepage))
+        return TEXT_INVALID_PARAMETER;
     // Figure out the mode
     char* fopenMode = NULL;
     if (mode == TEXT_MODE_READ)
@@ -439,27 +507,54 @@ LIBNEX_PUBLIC short TextOpen (const char* file,
     else if (mode == TEXT_MODE_APPEND)
         fopenMode = "a";
     else
+        return TEXT_INVALID_PARAMETER;
+    size_t bufSize = opts ? opts->bufSize : TEXT_DEFAULT_BUFSZ;
+    if (bufSize < TEXT_MIN_BUFSZ)
+        return TEXT_INVALID_PARAMETER;
+    // Allocate the new stream
+    TextStream_t* stream = (TextStream_t*) malloc (sizeof (TextStream_t));
+    if (!stream)
+        return TEXT_SYS_ERROR;
+    // Allocate the staging buffer
+    stream->buf = (uint8_t*) malloc (bufSize);
+    if (!stream->buf)
     {
         free (stream);
-        return TEXT_INVALID_PARAMETER;
+        errno = ENOMEM;
+        return TEXT_SYS_ERROR;
     }
+    stream->bufSize = bufSize;
+    stream->bufCap = bufSize;
+    stream->isAdaptive = opts && opts->isAdaptive;
     stream->mode = mode;
     // Open the file
     stream->file = fopen (file, fopenMode);
     if (!stream->file)
     {
+        free (stream->buf);
         free (stream);
         return TEXT_SYS_ERROR;
     }
-    // If encoding is 0, then chances are, file is in an unsupported format.
-    // The reason for this is because if we use libchardet, and TextGetEncId sees that
-    // libchardet found an encoding that we don't support, it will return 0. Then, when the user passes
-    // that ID, we will see that here
-    if (!encoding)
+    // We stage everything through our own buffer, so stdio's buffer would just be an extra copy
+    (void) setvbuf (stream->file, NULL, _IONBF, 0);
+    // Detect the encoding from the first frame. The frame is kept, so the file is still only read once
+    bool isDetected = false;
+    size_t bomSize = 0;
+    if (encoding == TEXT_ENC_AUTO)
     {
-        (void) fclose (stream->file);
-        free (stream);
-        return TEXT_INVALID_ENC;
+        stream->bufSize = fread (stream->buf, 1, stream->bufSize, stream->file);
+        if (ferror (stream->file))
+        {
+            (void) fclose (stream->file);
+            free (stream->buf);
+            free (stream);
+            return TEXT_SYS_ERROR;
+        }
+        bomSize = TextDetectEncoding (stream->buf, stream->bufSize, &encoding, &order);
+        isDetected = true;
+        hasBom = false;
+        // Every encoding that can be detected is supported
+        (void) _textGetCodepage (encoding, &codepage);
     }
     // Set the encoding
     stream->encoding = encoding;
@@ -473,6 +568,7 @@ LIBNEX_PUBLIC short TextOpen (const char* file,
             if (fread (bom, 2, 1, stream->file) != 1)
             {
                 (void) fclose (stream->file);
+                free (stream->buf);
                 free (stream);
                 return TEXT_SYS_ERROR;
             }
@@ -480,6 +576,7 @@ LIBNEX_PUBLIC short TextOpen (const char* file,
             if (stream->order == TEXT_ORDER_NONE)
             {
                 fclose (stream->file);
+                free (stream->buf);
                 free (stream);
                 return TEXT_BAD_BOM;
             }
@@ -490,12 +587,14 @@ LIBNEX_PUBLIC short TextOpen (const char* file,
             if (fread (bom, 3, 1, stream->file) != 1)
             {
                 (void) fclose (stream->file);
+                free (stream->buf);
                 free (stream);
                 return TEXT_SYS_ERROR;
             }
             if (!UnicodeReadBom8 (bom))
             {
                 (void) fclose (stream->file);
+                free (stream->buf);
                 free (stream);
                 return TEXT_BAD_BOM;
             }
@@ -507,6 +606,7 @@ LIBNEX_PUBLIC short TextOpen (const char* file,
             if (fread (bom, 4, 1, stream->file) != 1)
             {
                 (void) fclose (stream->file);
+                free (stream->buf);
                 free (stream);
                 return TEXT_SYS_ERROR;
             }
@@ -514,6 +614,7 @@ LIBNEX_PUBLIC short TextOpen (const char* file,
             if (stream->order == TEXT_ORDER_NONE)
             {
                 (void) fclose (stream->file);
+                free (stream->buf);
                 free (stream);
                 return TEXT_BAD_BOM;
             }
@@ -522,7 +623,8 @@ LIBNEX_PUBLIC short TextOpen (const char* file,
     else
     {
         // It we are creating a new file, set the order based on the parameter
-        if (mode == TEXT_MODE_WRITE)
+        // If the encoding was detected, the order was detected with it
+        if (mode == TEXT_MODE_WRITE || isDetected)
             stream->order = order;
         else
         {
@@ -537,22 +639,13 @@ LIBNEX_PUBLIC short TextOpen (const char* file,
                 stream->order = TEXT_ORDER_NONE;
         }
     }
-    // Set size of encoding
-    if (!(encoding == TEXT_ENC_ASCII || encoding == TEXT_ENC_WIN1252 || encoding == TEXT_ENC_UTF32 ||
-          encoding == TEXT_ENC_UTF16 || encoding == TEXT_ENC_UTF8))
-    {
-        (void) fclose (stream->file);
-        free (stream);
-        return TEXT_INVALID_PARAMETER;
-    }
+    stream->codepage = codepage;
 
     // Finally, create the object
     ObjCreate ("TextStream", &stream->obj);
     // Check if we need to write out a BOM
     if (mode == TEXT_MODE_WRITE)
     {
-        if (order != TEXT_ORDER_BE && order != TEXT_ORDER_LE && order != TEXT_ORDER_NONE)
-            return TEXT_INVALID_PARAMETER;
         if (encoding == TEXT_ENC_UTF16)
         {
             if (order == TEXT_ORDER_NONE)
@@ -563,6 +656,7 @@ LIBNEX_PUBLIC short TextOpen (const char* file,
             if (fwrite (&bom, 1, 2, stream->file) != 2)
             {
                 (void) fclose (stream->file);
+                free (stream->buf);
                 free (stream);
                 return TEXT_SYS_ERROR;
             }
@@ -577,6 +671,7 @@ LIBNEX_PUBLIC short TextOpen (const char* file,
             if (fwrite (&bom, 1, 4, stream->file) != 4)
             {
                 (void) fclose (stream->file);
+                free (stream->buf);
                 free (stream);
                 return TEXT_SYS_ERROR;
             }
@@ -586,16 +681,11 @@ LIBNEX_PUBLIC short TextOpen (const char* file,
     else if (mode == TEXT_MODE_READ)
     {
         // Set up frame buffer. We set it equal to the max size so _textReadFrame knows
-        // to read in a buffer
-        stream->bufPos = stream->bufSize;
+        // to read in a buffer. If the encoding was detected, the first frame is already read in,
+        // and we just skip over the BOM
+        stream->bufPos = isDetected ? bomSize : stream->bufSize;
     }
     stream->isEof = false;
-    if (!out)
-    {
-        (void) fclose (stream->file);
-        free (stream);
-        return TEXT_INVALID_PARAMETER;
-    }
     *out = stream;
     return TEXT_SUCCESS;
 }
@@ -638,6 +728,7 @@ LIBNEX_PUBLIC short TextClose (TextStream_t* stream)
 
 LIBNEX_PUBLIC void TextGetEncId (const char* encName, char* enc, char* order)
 {
+    int codepage = 0;
     if (!strcmp (encName, "ASCII") || !strcmp (encName, "UTF-8"))
     {
         *enc = TEXT_ENC_UTF8;
@@ -663,12 +754,16 @@ LIBNEX_PUBLIC void TextGetEncId (const char* encName, char* enc, char* order)
         *enc = TEXT_ENC_UTF32;
         *order = TEXT_ORDER_BE;
     }
-    // Note: proper ISO-8859-3 support coming soon
-    else if (!strcmp (encName, "windows-1252") || !strcmp (encName, "ISO-8859-3"))
+    else if (!strcmp (encName, "windows-1252"))
     {
         *enc = TEXT_ENC_WIN1252;
         *order = TEXT_ORDER_NONE;
     }
+    else if ((codepage = CodepageGetId (encName)) != 0)
+    {
+        *enc = TEXT_ENC_CODEPAGE (codepage);
+        *order = TEXT_ORDER_NONE;
+    }
     else
     {
         *enc = 0;
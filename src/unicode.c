@@ -18,12 +18,21 @@
 
 /// @file unicode.c
 
+#include "cpu.h"
 #include "unicode/utf16stateTab.h"
 #include "unicode/utf8stateTab.h"
+#include <libnex/codepage.h>
+#include <libnex/lock.h>
 #include <libnex/safemalloc.h>
 #include <libnex/unicode.h>
 #include <string.h>
 
+#ifdef LIBNEX_CPU_X86
+#include <immintrin.h>
+#elif defined LIBNEX_CPU_ARM && !defined LIBNEX_BAREMETAL
+#include <arm_neon.h>
+#endif
+
 // UTF-16 parser states
 #define UTF16_START         0
 #define UTF16_LOW_SURROGATE 3
@@ -44,16 +53,16 @@ LIBNEX_PUBLIC size_t UnicodeDecode16 (char32_t* out, const uint16_t* in, size_t
         if (in > (oin + sz))
             return 0;
         if (state == UTF16_START)
-            state = utf16stateTab[EndianRead16 (in, endian) >> 10];
+            state = utf16stateTab[EndianLoad16 (in, endian) >> 10];
         else
         {
-            if (state != utf16stateTab[EndianRead16 (in, endian) >> 10])
+            if (state != utf16stateTab[EndianLoad16 (in, endian) >> 10])
             {
                 *out = 0xFFFD;
                 return in - oin;
             }
         }
-        uint16_t val = EndianRead16 (in, endian);
+        uint16_t val = EndianLoad16 (in, endian);
         codepoint |= ((val & utf16maskTab[state]) << utf16shiftTab[state]);
         if (state == UTF16_LOW_SURROGATE)
             codepoint += 0x10000;
@@ -77,18 +86,18 @@ LIBNEX_PUBLIC size_t UnicodeEncode16 (uint16_t* out, char32_t in, char endian)
         // Encode first surrogate
         uint16_t sur1 = 0xD800;
         sur1 |= (in >> 10);
-        EndianWrite16 (out, sur1, endian);
+        EndianStore16 (out, sur1, endian);
         ++out;
         // Encode second surrogate
         uint16_t sur2 = 0xDC00;
         sur2 |= BitClearRange (in, 10, 10);
-        EndianWrite16 (out, sur2, endian);
+        EndianStore16 (out, sur2, endian);
         return 2;
     }
     else
     {
         // Cast to UTF-16
-        EndianWrite16 (out, (uint16_t) in, endian);
+        EndianStore16 (out, (uint16_t) in, endian);
         return 1;
     }
 }
@@ -98,53 +107,52 @@ LIBNEX_PUBLIC size_t UnicodeEncode16 (uint16_t* out, char32_t in, char endian)
 #define UTF8_START  0
 #define UTF8_ACCEPT 6
 
-// Checks if this is a bad octet
-#define IsBadOctect(oct) ((oct) == 0xC0 || (oct) == 0xC1 || ((oct) >= 0xF5))
-
-LIBNEX_PUBLIC size_t UnicodeDecodePart8 (char32_t* out, uint8_t in, Utf8State_t* state)
+// Runs one octet through the DFA
+static inline size_t unicodeStep8 (char32_t* out, uint8_t in, Utf8State_t* state)
 {
-    // If this sequence has been accepted, return
-    if (state->state == UTF8_ACCEPT)
+    // Anything past the accept state is garbage, and is rejected
+    if (state->state > UTF8_ACCEPT)
         return 0;
-
-    // Check if we need to initialize the state
-    if (state->state == UTF8_START)
+    const Utf8Trans_t* trans = &utf8dfaTab[state->state][utf8classTab[in]];
+    if (!(trans->flags & UTF8_DFA_CONSUME))
     {
-        // Get the intial state
-        state->state = utf8stateTab[in >> 3];
-        state->prevState = 0;
-        // Ensure this isn't a continuation
-        if (state->state == UTF8_CONT)
-            return 0;
-        // Get the size of this character
-        state->bytesLeft = utf8sizeTab[state->state];
-        state->bytesRequired = state->bytesLeft;
-        *out = 0;
+        // A bad lead octet still starts a sequence, and moves to a new state
+        if (trans->flags & UTF8_DFA_LOAD)
+        {
+            state->bytesLeft = trans->size;
+            state->bytesRequired = trans->size;
+            *out = 0;
+        }
+        if (trans->flags & UTF8_DFA_STORE)
+        {
+            state->prevState = 0;
+            state->state = trans->next;
+        }
+        return 0;
     }
-    else
+
+    // A lead octet decides the whole state by itself. The next state of an ASCII octet is the accept state
+    if (trans->flags & UTF8_DFA_LOAD)
     {
-        // Ensure this is the right state
-        if (state->state != utf8stateTab[in >> 3])
-            return 0;
+        *out = in & trans->mask;
+        memcpy (state, trans, sizeof (Utf8State_t));
+        return 1;
     }
 
-    // Ensure in isn't a bad octet
-    if (IsBadOctect (in))
-        return 0;
-
-    // Update the codepoint
-    *out = (in & utf8maskTab[state->state]) | ((*out) << utf8shiftTab[state->state]);
-
-    // Set the state
-    state->prevState = state->state;
-    state->state = utf8nextTab[state->prevState];
-
-    // Should we accept this sequence?
-    if ((--state->bytesLeft) == 0)
-        state->state = UTF8_ACCEPT;
+    // Add the octet to the codepoint, accepting the sequence if this is the last octet
+    uint8_t bytesLeft = state->bytesLeft - 1;
+    *out = (in & trans->mask) | (*out << trans->shift);
+    state->prevState = trans->cur;
+    state->bytesLeft = bytesLeft;
+    state->state = bytesLeft ? trans->next : UTF8_ACCEPT;
     return 1;
 }
 
+LIBNEX_PUBLIC size_t UnicodeDecodePart8 (char32_t* out, uint8_t in, Utf8State_t* state)
+{
+    return unicodeStep8 (out, in, state);
+}
+
 LIBNEX_PUBLIC size_t UnicodeDecode8 (char32_t* out, const uint8_t* in, size_t sz)
 {
     Utf8State_t state;
@@ -156,13 +164,1132 @@ LIBNEX_PUBLIC size_t UnicodeDecode8 (char32_t* out, const uint8_t* in, size_t sz
         if (in > (oin + sz))
             return 0;
         // Decode current octet
-        if (!UnicodeDecodePart8 (out, *in, &state))
+        if (!unicodeStep8 (out, *in, &state))
             *out = 0xFFFD;
         ++in;
     } while (!UnicodeIsAccepted (state));
     return in - oin;
 }
 
+// Widens the run of ASCII bytes at the start of in, stopping at the first non-ASCII byte
+// Returns the number of bytes widened
+static size_t unicodeWidenAsciiScalar (char32_t* out, const uint8_t* in, size_t len)
+{
+    size_t i = 0;
+    // Check 8 bytes at a time for bit 7
+    for (; (i + 8) <= len; i += 8)
+    {
+        uint64_t val;
+        memcpy (&val, in + i, 8);
+        if (val & 0x8080808080808080ULL)
+            break;
+        for (int j = 0; j < 8; ++j)
+            out[i + j] = in[i + j];
+    }
+    for (; i < len && in[i] < 0x80; ++i)
+        out[i] = in[i];
+    return i;
+}
+
+#ifdef LIBNEX_CPU_X86
+#ifdef __SSE2__
+// Widens 16 bytes at a time. A block containing non-ASCII is still widened in full,
+// but only the leading ASCII part of it is counted
+static size_t unicodeWidenAsciiSse2 (char32_t* out, const uint8_t* in, size_t len)
+{
+    __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+    for (; (i + 16) <= len; i += 16)
+    {
+        __m128i bytes = _mm_loadu_si128 ((const __m128i*) (in + i));
+        unsigned int mask = (unsigned int) _mm_movemask_epi8 (bytes);
+        __m128i lo = _mm_unpacklo_epi8 (bytes, zero);
+        __m128i hi = _mm_unpackhi_epi8 (bytes, zero);
+        _mm_storeu_si128 ((__m128i*) (out + i), _mm_unpacklo_epi16 (lo, zero));
+        _mm_storeu_si128 ((__m128i*) (out + i + 4), _mm_unpackhi_epi16 (lo, zero));
+        _mm_storeu_si128 ((__m128i*) (out + i + 8), _mm_unpacklo_epi16 (hi, zero));
+        _mm_storeu_si128 ((__m128i*) (out + i + 12), _mm_unpackhi_epi16 (hi, zero));
+        if (mask)
+            return i + __builtin_ctz (mask);
+    }
+    return i + unicodeWidenAsciiScalar (out + i, in + i, len - i);
+}
+#endif
+
+// Widens 32 bytes at a time
+__attribute__ ((target ("avx2"))) static size_t unicodeWidenAsciiAvx2 (char32_t* out,
+                                                                        const uint8_t* in,
+                                                                        size_t len)
+{
+    size_t i = 0;
+    for (; (i + 32) <= len; i += 32)
+    {
+        unsigned int mask = (unsigned int) _mm256_movemask_epi8 (_mm256_loadu_si256 ((const __m256i*) (in + i)));
+        for (int j = 0; j < 32; j += 8)
+        {
+            __m128i bytes = _mm_loadl_epi64 ((const __m128i*) (in + i + j));
+            _mm256_storeu_si256 ((__m256i*) (out + i + j), _mm256_cvtepu8_epi32 (bytes));
+        }
+        if (mask)
+            return i + __builtin_ctz (mask);
+    }
+    return i + unicodeWidenAsciiScalar (out + i, in + i, len - i);
+}
+#elif defined LIBNEX_CPU_ARM && !defined LIBNEX_BAREMETAL
+// Widens 16 bytes at a time
+static size_t unicodeWidenAsciiNeon (char32_t* out, const uint8_t* in, size_t len)
+{
+    size_t i = 0;
+    for (; (i + 16) <= len; i += 16)
+    {
+        uint8x16_t bytes = vld1q_u8 (in + i);
+        if (vmaxvq_u8 (bytes) >= 0x80)
+            break;
+        uint16x8_t lo = vmovl_u8 (vget_low_u8 (bytes));
+        uint16x8_t hi = vmovl_u8 (vget_high_u8 (bytes));
+        vst1q_u32 ((uint32_t*) (out + i), vmovl_u16 (vget_low_u16 (lo)));
+        vst1q_u32 ((uint32_t*) (out + i + 4), vmovl_u16 (vget_high_u16 (lo)));
+        vst1q_u32 ((uint32_t*) (out + i + 8), vmovl_u16 (vget_low_u16 (hi)));
+        vst1q_u32 ((uint32_t*) (out + i + 12), vmovl_u16 (vget_high_u16 (hi)));
+    }
+    return i + unicodeWidenAsciiScalar (out + i, in + i, len - i);
+}
+#endif
+
+// Gets the number of octets needed to encode c as UTF-8, or 0 if it can't be encoded
+static inline size_t unicodeSize8 (char32_t c)
+{
+    if (c <= 0x7F)
+        return 1;
+    else if (c <= 0x7FF)
+        return 2;
+    else if (c <= 0xFFFF)
+        return 3;
+    else if (c <= 0x10FFFF)
+        return 4;
+    return 0;
+}
+
+// Sums up the encoded size of in, stopping at the first character that can't be encoded
+static size_t unicodeLength8Scalar (const char32_t* in, size_t inSz, size_t* consumed)
+{
+    size_t len = 0;
+    size_t i = 0;
+    for (; i < inSz; ++i)
+    {
+        size_t sz = unicodeSize8 (in[i]);
+        if (!sz)
+            break;
+        len += sz;
+    }
+    *consumed = i;
+    return len;
+}
+
+// Narrowing kernels take whole blocks of in, and return the number of characters they encoded
+// They stop at the first block they can't handle, or when out might not have room for a block
+// Targets without a vector unit have none, and encode a character at a time
+
+#ifdef LIBNEX_CPU_X86
+// Checks if none of the bits in mask are set in val
+#define IsAllClear(val, mask) \
+    (_mm_movemask_epi8 (_mm_cmpeq_epi8 (_mm_and_si128 (val, mask), _mm_setzero_si128())) == 0xFFFF)
+
+#ifdef __SSE2__
+// Sums up the encoded size of in 4 characters at a time
+static size_t unicodeLength8Sse2 (const char32_t* in, size_t inSz, size_t* consumed)
+{
+    size_t len = 0;
+    size_t i = 0;
+    bool invalid = false;
+    while (!invalid && (i + 4) <= inSz)
+    {
+        // Each lane counts the extra octets of its characters. Flush them before they can overflow
+        __m128i extra = _mm_setzero_si128();
+        size_t start = i;
+        for (; (i + 4) <= inSz && (i - start) < (1 << 24); i += 4)
+        {
+            __m128i val = _mm_loadu_si128 ((const __m128i*) (in + i));
+            if (_mm_movemask_epi8 (_mm_cmpgt_epi32 (_mm_srli_epi32 (val, 16), _mm_set1_epi32 (0x10))))
+            {
+                invalid = true;
+                break;
+            }
+            extra = _mm_sub_epi32 (extra, _mm_cmpgt_epi32 (val, _mm_set1_epi32 (0x7F)));
+            extra = _mm_sub_epi32 (extra, _mm_cmpgt_epi32 (val, _mm_set1_epi32 (0x7FF)));
+            extra = _mm_sub_epi32 (extra, _mm_cmpgt_epi32 (val, _mm_set1_epi32 (0xFFFF)));
+        }
+        uint32_t lanes[4];
+        _mm_storeu_si128 ((__m128i*) lanes, extra);
+        len += (i - start) + lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    }
+    size_t tail = 0;
+    len += unicodeLength8Scalar (in + i, inSz - i, &tail);
+    *consumed = i + tail;
+    return len;
+}
+
+// Narrows blocks of 16 ASCII characters
+static size_t unicodeNarrowSse2 (uint8_t* out, size_t outSz, const char32_t* in, size_t inSz, size_t* written)
+{
+    __m128i highBits = _mm_set1_epi32 ((int) 0xFFFFFF80);
+    size_t i = 0;
+    for (; (i + 16) <= inSz && (i + 16) <= outSz; i += 16)
+    {
+        __m128i val0 = _mm_loadu_si128 ((const __m128i*) (in + i));
+        __m128i val1 = _mm_loadu_si128 ((const __m128i*) (in + i + 4));
+        __m128i val2 = _mm_loadu_si128 ((const __m128i*) (in + i + 8));
+        __m128i val3 = _mm_loadu_si128 ((const __m128i*) (in + i + 12));
+        __m128i all = _mm_or_si128 (_mm_or_si128 (val0, val1), _mm_or_si128 (val2, val3));
+        if (!IsAllClear (all, highBits))
+            break;
+        __m128i bytes = _mm_packus_epi16 (_mm_packs_epi32 (val0, val1), _mm_packs_epi32 (val2, val3));
+        _mm_storeu_si128 ((__m128i*) (out + i), bytes);
+    }
+    *written = i;
+    return i;
+}
+#endif
+
+// Shuffle masks that pack 8 16 bit lanes down to 1 or 2 octets each
+// Indexed by a mask of which lanes take 2 octets
+static uint8_t __attribute__ ((aligned (16))) unicodePackTab[256][16];
+
+// Encodes 8 16 bit lanes below U+0800 as UTF-8. Always stores 16 octets
+// Returns the number of octets that are part of the encoded text
+__attribute__ ((target ("ssse3"))) static inline size_t unicodePack2Ssse3 (uint8_t* out, __m128i chars)
+{
+    // Build both encodings of each character, then keep the right one
+    __m128i lead = _mm_or_si128 (_mm_srli_epi16 (chars, 6), _mm_set1_epi16 (0xC0));
+    __m128i cont = _mm_or_si128 (_mm_and_si128 (chars, _mm_set1_epi16 (0x3F)), _mm_set1_epi16 (0x80));
+    __m128i twoOctets = _mm_or_si128 (lead, _mm_slli_epi16 (cont, 8));
+    __m128i isTwo = _mm_cmpgt_epi16 (chars, _mm_set1_epi16 (0x7F));
+    __m128i lanes = _mm_or_si128 (_mm_and_si128 (isTwo, twoOctets), _mm_andnot_si128 (isTwo, chars));
+    unsigned int mask = (unsigned int) _mm_movemask_epi8 (_mm_packs_epi16 (isTwo, _mm_setzero_si128()));
+    __m128i shuf = _mm_load_si128 ((const __m128i*) unicodePackTab[mask]);
+    _mm_storeu_si128 ((__m128i*) out, _mm_shuffle_epi8 (lanes, shuf));
+    return 8 + __builtin_popcount (mask);
+}
+
+// Narrows blocks of 16 ASCII characters, or 8 characters below U+0800
+__attribute__ ((target ("ssse3"))) static size_t unicodeNarrowSsse3 (uint8_t* out,
+                                                                      size_t outSz,
+                                                                      const char32_t* in,
+                                                                      size_t inSz,
+                                                                      size_t* written)
+{
+    size_t inPos = 0;
+    size_t outPos = 0;
+    while ((outPos + 16) <= outSz && (inPos + 8) <= inSz)
+    {
+        __m128i val0 = _mm_loadu_si128 ((const __m128i*) (in + inPos));
+        __m128i val1 = _mm_loadu_si128 ((const __m128i*) (in + inPos + 4));
+        if ((inPos + 16) <= inSz)
+        {
+            __m128i val2 = _mm_loadu_si128 ((const __m128i*) (in + inPos + 8));
+            __m128i val3 = _mm_loadu_si128 ((const __m128i*) (in + inPos + 12));
+            __m128i all = _mm_or_si128 (_mm_or_si128 (val0, val1), _mm_or_si128 (val2, val3));
+            if (IsAllClear (all, _mm_set1_epi32 ((int) 0xFFFFFF80)))
+            {
+                __m128i bytes = _mm_packus_epi16 (_mm_packs_epi32 (val0, val1), _mm_packs_epi32 (val2, val3));
+                _mm_storeu_si128 ((__m128i*) (out + outPos), bytes);
+                inPos += 16;
+                outPos += 16;
+                continue;
+            }
+        }
+        if (!IsAllClear (_mm_or_si128 (val0, val1), _mm_set1_epi32 ((int) 0xFFFFF800)))
+            break;
+        outPos += unicodePack2Ssse3 (out + outPos, _mm_packs_epi32 (val0, val1));
+        inPos += 8;
+    }
+    *written = outPos;
+    return inPos;
+}
+#elif defined LIBNEX_CPU_ARM && !defined LIBNEX_BAREMETAL
+// Narrows blocks of 16 ASCII characters
+static size_t unicodeNarrowNeon (uint8_t* out, size_t outSz, const char32_t* in, size_t inSz, size_t* written)
+{
+    size_t i = 0;
+    for (; (i + 16) <= inSz && (i + 16) <= outSz; i += 16)
+    {
+        uint32x4_t val0 = vld1q_u32 ((const uint32_t*) (in + i));
+        uint32x4_t val1 = vld1q_u32 ((const uint32_t*) (in + i + 4));
+        uint32x4_t val2 = vld1q_u32 ((const uint32_t*) (in + i + 8));
+        uint32x4_t val3 = vld1q_u32 ((const uint32_t*) (in + i + 12));
+        uint32x4_t all = vorrq_u32 (vorrq_u32 (val0, val1), vorrq_u32 (val2, val3));
+        if (vmaxvq_u32 (all) >= 0x80)
+            break;
+        uint16x8_t lo = vcombine_u16 (vmovn_u32 (val0), vmovn_u32 (val1));
+        uint16x8_t hi = vcombine_u16 (vmovn_u32 (val2), vmovn_u32 (val3));
+        vst1q_u8 (out + i, vcombine_u8 (vmovn_u16 (lo), vmovn_u16 (hi)));
+    }
+    *written = i;
+    return i;
+}
+#endif
+
+// Checks if a UTF-16 unit is a surrogate
+#define IsSurrogate(unit) (((unit) & 0xF800) == 0xD800)
+
+// Widens the run of non-surrogate UTF-16 units at the start of in, byte swapping them if swap is set
+// Returns the number of units widened
+static size_t unicodeWiden16Scalar (char32_t* out, const uint16_t* in, size_t len, int swap)
+{
+    size_t i = 0;
+    for (; i < len; ++i)
+    {
+        uint16_t unit = swap ? EndianSwap16 (in[i]) : in[i];
+        if (IsSurrogate (unit))
+            break;
+        out[i] = unit;
+    }
+    return i;
+}
+
+#ifdef LIBNEX_CPU_X86
+#ifdef __SSE2__
+// Widens 8 units at a time
+static size_t unicodeWiden16Sse2 (char32_t* out, const uint16_t* in, size_t len, int swap)
+{
+    __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+    for (; (i + 8) <= len; i += 8)
+    {
+        __m128i units = _mm_loadu_si128 ((const __m128i*) (in + i));
+        if (swap)
+            units = _mm_or_si128 (_mm_slli_epi16 (units, 8), _mm_srli_epi16 (units, 8));
+        __m128i isSurrogate = _mm_cmpeq_epi16 (_mm_and_si128 (units, _mm_set1_epi16 ((short) 0xF800)),
+                                               _mm_set1_epi16 ((short) 0xD800));
+        unsigned int mask = (unsigned int) _mm_movemask_epi8 (isSurrogate);
+        _mm_storeu_si128 ((__m128i*) (out + i), _mm_unpacklo_epi16 (units, zero));
+        _mm_storeu_si128 ((__m128i*) (out + i + 4), _mm_unpackhi_epi16 (units, zero));
+        if (mask)
+            return i + (__builtin_ctz (mask) / 2);
+    }
+    return i + unicodeWiden16Scalar (out + i, in + i, len - i, swap);
+}
+#endif
+
+// Widens 16 units at a time
+__attribute__ ((target ("avx2"))) static size_t unicodeWiden16Avx2 (char32_t* out,
+                                                                     const uint16_t* in,
+                                                                     size_t len,
+                                                                     int swap)
+{
+    size_t i = 0;
+    for (; (i + 16) <= len; i += 16)
+    {
+        __m256i units = _mm256_loadu_si256 ((const __m256i*) (in + i));
+        if (swap)
+            units = _mm256_or_si256 (_mm256_slli_epi16 (units, 8), _mm256_srli_epi16 (units, 8));
+        __m256i isSurrogate = _mm256_cmpeq_epi16 (_mm256_and_si256 (units, _mm256_set1_epi16 ((short) 0xF800)),
+                                                  _mm256_set1_epi16 ((short) 0xD800));
+        unsigned int mask = (unsigned int) _mm256_movemask_epi8 (isSurrogate);
+        __m128i lo = _mm256_castsi256_si128 (units);
+        __m128i hi = _mm256_extracti128_si256 (units, 1);
+        _mm256_storeu_si256 ((__m256i*) (out + i), _mm256_cvtepu16_epi32 (lo));
+        _mm256_storeu_si256 ((__m256i*) (out + i + 8), _mm256_cvtepu16_epi32 (hi));
+        if (mask)
+            return i + (__builtin_ctz (mask) / 2);
+    }
+    return i + unicodeWiden16Scalar (out + i, in + i, len - i, swap);
+}
+#elif defined LIBNEX_CPU_ARM && !defined LIBNEX_BAREMETAL
+// Widens 8 units at a time
+static size_t unicodeWiden16Neon (char32_t* out, const uint16_t* in, size_t len, int swap)
+{
+    size_t i = 0;
+    for (; (i + 8) <= len; i += 8)
+    {
+        uint16x8_t units = vld1q_u16 (in + i);
+        if (swap)
+            units = vreinterpretq_u16_u8 (vrev16q_u8 (vreinterpretq_u8_u16 (units)));
+        uint16x8_t isSurrogate = vceqq_u16 (vandq_u16 (units, vdupq_n_u16 (0xF800)), vdupq_n_u16 (0xD800));
+        if (vmaxvq_u16 (isSurrogate))
+            break;
+        vst1q_u32 ((uint32_t*) (out + i), vmovl_u16 (vget_low_u16 (units)));
+        vst1q_u32 ((uint32_t*) (out + i + 4), vmovl_u16 (vget_high_u16 (units)));
+    }
+    return i + unicodeWiden16Scalar (out + i, in + i, len - i, swap);
+}
+#endif
+
+// Gets the length of the run of ASCII at the start of in
+static size_t unicodeAsciiLen (const uint8_t* in, size_t len)
+{
+    size_t i = 0;
+#if defined LIBNEX_CPU_X86 && defined __SSE2__
+    for (; (i + 16) <= len; i += 16)
+    {
+        unsigned int mask = (unsigned int) _mm_movemask_epi8 (_mm_loadu_si128 ((const __m128i*) (in + i)));
+        if (mask)
+            return i + __builtin_ctz (mask);
+    }
+#endif
+    for (; (i + 8) <= len; i += 8)
+    {
+        uint64_t val;
+        memcpy (&val, in + i, 8);
+        if (val & 0x8080808080808080ULL)
+            break;
+    }
+    for (; i < len && in[i] < 0x80; ++i)
+        ;
+    return i;
+}
+
+// Widens the run of ASCII at the start of in to UTF-16, byte swapping it if swap is set
+// Returns the number of octets widened
+static size_t unicodeWidenAscii16Scalar (uint16_t* out, const uint8_t* in, size_t len, int swap)
+{
+    size_t i = 0;
+    for (; i < len && in[i] < 0x80; ++i)
+        out[i] = swap ? (uint16_t) (in[i] << 8) : in[i];
+    return i;
+}
+
+// Narrowing kernels for UTF-16 take whole blocks of units, and return the number of units they encoded
+// They stop at the first block they can't handle, or when out might not have room for a block
+// Targets without a vector unit have none, and encode a unit at a time
+
+#ifdef LIBNEX_CPU_X86
+// Swaps the bytes of each 16 bit lane
+#define SwapLanes16(val) _mm_or_si128 (_mm_slli_epi16 (val, 8), _mm_srli_epi16 (val, 8))
+
+#ifdef __SSE2__
+// Widens 16 octets at a time
+static size_t unicodeWidenAscii16Sse2 (uint16_t* out, const uint8_t* in, size_t len, int swap)
+{
+    __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+    for (; (i + 16) <= len; i += 16)
+    {
+        __m128i bytes = _mm_loadu_si128 ((const __m128i*) (in + i));
+        unsigned int mask = (unsigned int) _mm_movemask_epi8 (bytes);
+        if (swap)
+        {
+            _mm_storeu_si128 ((__m128i*) (out + i), _mm_unpacklo_epi8 (zero, bytes));
+            _mm_storeu_si128 ((__m128i*) (out + i + 8), _mm_unpackhi_epi8 (zero, bytes));
+        }
+        else
+        {
+            _mm_storeu_si128 ((__m128i*) (out + i), _mm_unpacklo_epi8 (bytes, zero));
+            _mm_storeu_si128 ((__m128i*) (out + i + 8), _mm_unpackhi_epi8 (bytes, zero));
+        }
+        if (mask)
+            return i + __builtin_ctz (mask);
+    }
+    return i + unicodeWidenAscii16Scalar (out + i, in + i, len - i, swap);
+}
+
+// Narrows blocks of 8 ASCII units
+static size_t unicodeNarrow16Sse2 (uint8_t* out,
+                                   size_t outSz,
+                                   const uint16_t* in,
+                                   size_t inSz,
+                                   int swap,
+                                   size_t* written)
+{
+    size_t i = 0;
+    for (; (i + 8) <= inSz && (i + 8) <= outSz; i += 8)
+    {
+        __m128i units = _mm_loadu_si128 ((const __m128i*) (in + i));
+        if (swap)
+            units = SwapLanes16 (units);
+        if (!IsAllClear (units, _mm_set1_epi16 ((short) 0xFF80)))
+            break;
+        _mm_storel_epi64 ((__m128i*) (out + i), _mm_packus_epi16 (units, units));
+    }
+    *written = i;
+    return i;
+}
+
+// Sums up the UTF-8 size of blocks of 8 units with no surrogates
+// Returns the number of units counted
+static size_t unicodeLength16To8 (const uint16_t* in, size_t inSz, int swap, size_t* len)
+{
+    __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+    for (; (i + 8) <= inSz; i += 8)
+    {
+        __m128i units = _mm_loadu_si128 ((const __m128i*) (in + i));
+        if (swap)
+            units = SwapLanes16 (units);
+        __m128i isSurrogate = _mm_cmpeq_epi16 (_mm_and_si128 (units, _mm_set1_epi16 ((short) 0xF800)),
+                                               _mm_set1_epi16 ((short) 0xD800));
+        if (_mm_movemask_epi8 (isSurrogate))
+            break;
+        // Each mask has 2 bits per unit that fits in fewer octets
+        __m128i oneOctet = _mm_cmpeq_epi16 (_mm_subs_epu16 (units, _mm_set1_epi16 (0x7F)), zero);
+        __m128i twoOctets = _mm_cmpeq_epi16 (_mm_subs_epu16 (units, _mm_set1_epi16 (0x7FF)), zero);
+        unsigned int mask1 = (unsigned int) _mm_movemask_epi8 (oneOctet);
+        unsigned int mask2 = (unsigned int) _mm_movemask_epi8 (twoOctets);
+        *len += 24 - ((__builtin_popcount (mask1) + __builtin_popcount (mask2)) / 2);
+    }
+    return i;
+}
+#endif
+
+// Widens 32 octets at a time
+__attribute__ ((target ("avx2"))) static size_t unicodeWidenAscii16Avx2 (uint16_t* out,
+                                                                          const uint8_t* in,
+                                                                          size_t len,
+                                                                          int swap)
+{
+    size_t i = 0;
+    for (; (i + 32) <= len; i += 32)
+    {
+        __m256i bytes = _mm256_loadu_si256 ((const __m256i*) (in + i));
+        unsigned int mask = (unsigned int) _mm256_movemask_epi8 (bytes);
+        __m256i lo = _mm256_cvtepu8_epi16 (_mm256_castsi256_si128 (bytes));
+        __m256i hi = _mm256_cvtepu8_epi16 (_mm256_extracti128_si256 (bytes, 1));
+        if (swap)
+        {
+            lo = _mm256_slli_epi16 (lo, 8);
+            hi = _mm256_slli_epi16 (hi, 8);
+        }
+        _mm256_storeu_si256 ((__m256i*) (out + i), lo);
+        _mm256_storeu_si256 ((__m256i*) (out + i + 16), hi);
+        if (mask)
+            return i + __builtin_ctz (mask);
+    }
+    return i + unicodeWidenAscii16Scalar (out + i, in + i, len - i, swap);
+}
+
+// Narrows blocks of 8 units below U+0800
+__attribute__ ((target ("ssse3"))) static size_t unicodeNarrow16Ssse3 (uint8_t* out,
+                                                                        size_t outSz,
+                                                                        const uint16_t* in,
+                                                                        size_t inSz,
+                                                                        int swap,
+                                                                        size_t* written)
+{
+    size_t inPos = 0;
+    size_t outPos = 0;
+    while ((outPos + 16) <= outSz && (inPos + 8) <= inSz)
+    {
+        __m128i units = _mm_loadu_si128 ((const __m128i*) (in + inPos));
+        if (swap)
+            units = SwapLanes16 (units);
+        if (IsAllClear (units, _mm_set1_epi16 ((short) 0xFF80)))
+        {
+            _mm_storel_epi64 ((__m128i*) (out + outPos), _mm_packus_epi16 (units, units));
+            outPos += 8;
+        }
+        else if (IsAllClear (units, _mm_set1_epi16 ((short) 0xF800)))
+            outPos += unicodePack2Ssse3 (out + outPos, units);
+        else
+            break;
+        inPos += 8;
+    }
+    *written = outPos;
+    return inPos;
+}
+#elif defined LIBNEX_CPU_ARM && !defined LIBNEX_BAREMETAL
+// Widens 16 octets at a time
+static size_t unicodeWidenAscii16Neon (uint16_t* out, const uint8_t* in, size_t len, int swap)
+{
+    size_t i = 0;
+    for (; (i + 16) <= len; i += 16)
+    {
+        uint8x16_t bytes = vld1q_u8 (in + i);
+        if (vmaxvq_u8 (bytes) >= 0x80)
+            break;
+        uint16x8_t lo = vmovl_u8 (vget_low_u8 (bytes));
+        uint16x8_t hi = vmovl_u8 (vget_high_u8 (bytes));
+        if (swap)
+        {
+            lo = vshlq_n_u16 (lo, 8);
+            hi = vshlq_n_u16 (hi, 8);
+        }
+        vst1q_u16 (out + i, lo);
+        vst1q_u16 (out + i + 8, hi);
+    }
+    return i + unicodeWidenAscii16Scalar (out + i, in + i, len - i, swap);
+}
+
+// Narrows blocks of 8 ASCII units
+static size_t unicodeNarrow16Neon (uint8_t* out,
+                                   size_t outSz,
+                                   const uint16_t* in,
+                                   size_t inSz,
+                                   int swap,
+                                   size_t* written)
+{
+    size_t i = 0;
+    for (; (i + 8) <= inSz && (i + 8) <= outSz; i += 8)
+    {
+        uint16x8_t units = vld1q_u16 (in + i);
+        if (swap)
+            units = vreinterpretq_u16_u8 (vrev16q_u8 (vreinterpretq_u8_u16 (units)));
+        if (vmaxvq_u16 (units) >= 0x80)
+            break;
+        vst1_u8 (out + i, vmovn_u16 (units));
+    }
+    *written = i;
+    return i;
+}
+#endif
+
+// Finds the first invalid sequence in buf, checking UTF-8 strictly
+// Returns the offset of the first octet of it, or len if buf is valid. If buf ends in the middle of
+// an otherwise valid sequence, tail is set to the start of it. Otherwise, tail is set to len
+static size_t unicodeValidateScalar (const uint8_t* buf, size_t len, size_t* tail)
+{
+    *tail = len;
+    size_t i = 0;
+    while (i < len)
+    {
+        // Skip over ASCII 8 octets at a time
+        uint64_t val;
+        if ((i + 8) <= len && (memcpy (&val, buf + i, 8), !(val & 0x8080808080808080ULL)))
+        {
+            i += 8;
+            continue;
+        }
+        uint8_t lead = buf[i];
+        if (lead < 0x80)
+        {
+            ++i;
+            continue;
+        }
+        // Figure out the size, and the range of the second octet. Narrowing that range
+        // rules out overlong forms, surrogates, and characters past U+10FFFF
+        size_t seqSz = 0;
+        uint8_t low = 0x80, high = 0xBF;
+        if (lead >= 0xC2 && lead <= 0xDF)
+            seqSz = 2;
+        else if (lead >= 0xE0 && lead <= 0xEF)
+        {
+            seqSz = 3;
+            if (lead == 0xE0)
+                low = 0xA0;
+            else if (lead == 0xED)
+                high = 0x9F;
+        }
+        else if (lead >= 0xF0 && lead <= 0xF4)
+        {
+            seqSz = 4;
+            if (lead == 0xF0)
+                low = 0x90;
+            else if (lead == 0xF4)
+                high = 0x8F;
+        }
+        else
+            return i;
+        for (size_t j = 1; j < seqSz; ++j)
+        {
+            if ((i + j) >= len)
+            {
+                *tail = i;
+                return len;
+            }
+            uint8_t cont = buf[i + j];
+            if (cont < low || cont > high)
+                return i;
+            low = 0x80;
+            high = 0xBF;
+        }
+        i += seqSz;
+    }
+    return len;
+}
+
+// Backs pos up to the start of the sequence that it is in the middle of, if any
+static size_t unicodeSeqStart8 (const uint8_t* buf, size_t pos)
+{
+    for (size_t i = 1; i <= 3 && i <= pos; ++i)
+    {
+        uint8_t octet = buf[pos - i];
+        if (octet < 0x80)
+            break;
+        else if (octet >= 0xC0)
+        {
+            size_t seqSz = (octet >= 0xF0) ? 4 : (octet >= 0xE0) ? 3 : 2;
+            if (seqSz > i)
+                return pos - i;
+            break;
+        }
+    }
+    return pos;
+}
+
+// Validation kernels check whole blocks of buf, and return how far they got
+// They stop at the first block with an error, which is then found with unicodeValidateScalar
+static size_t unicodeValidateNone (const uint8_t* buf, size_t len)
+{
+    UNUSED (buf);
+    UNUSED (len);
+    return 0;
+}
+
+// Error flags for the vector validators. This is the lookup table algorithm from
+// "Validating UTF-8 In Less Than One Instruction Per Byte" by John Keiser and Daniel Lemire.
+// Each table is indexed by one nibble of a pair of adjacent octets. A pair is only invalid
+// if all three tables agree on a flag
+#define UTF8_TOO_SHORT  (1 << 0)    // A lead octet or ASCII follows a lead octet
+#define UTF8_TOO_LONG   (1 << 1)    // A continuation follows ASCII
+#define UTF8_OVERLONG_3 (1 << 2)    // 11100000 100xxxxx
+#define UTF8_TOO_LARGE  (1 << 3)    // Past U+10FFFF
+#define UTF8_SURROGATE  (1 << 4)    // 11101101 101xxxxx
+#define UTF8_OVERLONG_2 (1 << 5)    // 1100000x 10xxxxxx
+#define UTF8_TOO_LARGE2 (1 << 6)    // Past U+10FFFF, with a second octet of 1000xxxx
+#define UTF8_OVERLONG_4 (1 << 6)    // 11110000 1000xxxx
+#define UTF8_TWO_CONTS  (1 << 7)    // Two continuations in a row. Checked against the expected length
+#define UTF8_CARRY      (UTF8_TOO_SHORT | UTF8_TOO_LONG | UTF8_TWO_CONTS)
+
+// clang-format off
+// Indexed by the high nibble of the first octet
+static const uint8_t __attribute__ ((aligned (16))) utf8ValidTab1High[16] = {
+    UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG,
+    UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG,
+    UTF8_TWO_CONTS, UTF8_TWO_CONTS, UTF8_TWO_CONTS, UTF8_TWO_CONTS,
+    UTF8_TOO_SHORT | UTF8_OVERLONG_2,
+    UTF8_TOO_SHORT,
+    UTF8_TOO_SHORT | UTF8_OVERLONG_3 | UTF8_SURROGATE,
+    UTF8_TOO_SHORT | UTF8_TOO_LARGE | UTF8_TOO_LARGE2 | UTF8_OVERLONG_4};
+
+// Indexed by the low nibble of the first octet
+static const uint8_t __attribute__ ((aligned (16))) utf8ValidTab1Low[16] = {
+    UTF8_CARRY | UTF8_OVERLONG_3 | UTF8_OVERLONG_2 | UTF8_OVERLONG_4,
+    UTF8_CARRY | UTF8_OVERLONG_2,
+    UTF8_CARRY,
+    UTF8_CARRY,
+    UTF8_CARRY | UTF8_TOO_LARGE,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE2,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE2,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE2,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE2,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE2,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE2,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE2,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE2,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE2 | UTF8_SURROGATE,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE2,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE2};
+
+// Indexed by the high nibble of the second octet
+static const uint8_t __attribute__ ((aligned (16))) utf8ValidTab2High[16] = {
+    UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT,
+    UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT,
+    UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_OVERLONG_3 | UTF8_TOO_LARGE2 | UTF8_OVERLONG_4,
+    UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_OVERLONG_3 | UTF8_TOO_LARGE,
+    UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_SURROGATE | UTF8_TOO_LARGE,
+    UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_SURROGATE | UTF8_TOO_LARGE,
+    UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT};
+
+// Subtracted from the last octets of a block. Anything left over means a sequence is cut off
+static const uint8_t __attribute__ ((aligned (32))) utf8ValidMaxTab[32] = {
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xEF, 0xDF, 0xBF};
+// clang-format on
+
+#ifdef LIBNEX_CPU_X86
+// Checks a block of 16 octets. prev is the block before it
+// Returns a vector that is non-zero if there is an error
+__attribute__ ((target ("ssse3"))) static inline __m128i unicodeCheckBlockSsse3 (__m128i input, __m128i prev)
+{
+    __m128i nibble = _mm_set1_epi8 (0x0F);
+    __m128i prev1 = _mm_alignr_epi8 (input, prev, 15);
+    __m128i byte1High = _mm_shuffle_epi8 (_mm_load_si128 ((const __m128i*) utf8ValidTab1High),
+                                          _mm_and_si128 (_mm_srli_epi16 (prev1, 4), nibble));
+    __m128i byte1Low =
+        _mm_shuffle_epi8 (_mm_load_si128 ((const __m128i*) utf8ValidTab1Low), _mm_and_si128 (prev1, nibble));
+    __m128i byte2High = _mm_shuffle_epi8 (_mm_load_si128 ((const __m128i*) utf8ValidTab2High),
+                                          _mm_and_si128 (_mm_srli_epi16 (input, 4), nibble));
+    __m128i special = _mm_and_si128 (_mm_and_si128 (byte1High, byte1Low), byte2High);
+    // Third and fourth octets of a sequence must be continuations, and nothing else can be
+    __m128i isThird = _mm_subs_epu8 (_mm_alignr_epi8 (input, prev, 14), _mm_set1_epi8 (0xE0 - 0x80));
+    __m128i isFourth = _mm_subs_epu8 (_mm_alignr_epi8 (input, prev, 13), _mm_set1_epi8 (0xF0 - 0x80));
+    __m128i must23 = _mm_and_si128 (_mm_or_si128 (isThird, isFourth), _mm_set1_epi8 ((char) 0x80));
+    return _mm_xor_si128 (must23, special);
+}
+
+// Validates 16 octets at a time
+__attribute__ ((target ("ssse3"))) static size_t unicodeValidateSsse3 (const uint8_t* buf, size_t len)
+{
+    __m128i zero = _mm_setzero_si128();
+    __m128i prev = zero;
+    __m128i prevIncomplete = zero;
+    size_t i = 0;
+    for (; (i + 16) <= len; i += 16)
+    {
+        __m128i input = _mm_loadu_si128 ((const __m128i*) (buf + i));
+        __m128i error = prevIncomplete;
+        // ASCII only has to check that the last block didn't cut off a sequence
+        if (_mm_movemask_epi8 (input))
+            error = _mm_or_si128 (error, unicodeCheckBlockSsse3 (input, prev));
+        if (!IsAllClear (error, _mm_set1_epi8 ((char) 0xFF)))
+            break;
+        prevIncomplete = _mm_subs_epu8 (input, _mm_load_si128 ((const __m128i*) (utf8ValidMaxTab + 16)));
+        prev = input;
+    }
+    return i;
+}
+
+// Looks up the low nibble of each octet of idx in a 16 entry table
+#define Lookup16Avx2(tab, idx) \
+    _mm256_shuffle_epi8 (_mm256_broadcastsi128_si256 (_mm_load_si128 ((const __m128i*) (tab))), idx)
+
+// Checks a block of 32 octets. prev is the block before it
+// Returns a vector that is non-zero if there is an error
+__attribute__ ((target ("avx2"))) static inline __m256i unicodeCheckBlockAvx2 (__m256i input, __m256i prev)
+{
+    __m256i nibble = _mm256_set1_epi8 (0x0F);
+    // Line the previous octets up with each octet of input. alignr works on each lane,
+    // so it is given the high lane of prev and the low lane of input
+    __m256i shifted = _mm256_permute2x128_si256 (prev, input, 0x21);
+    __m256i prev1 = _mm256_alignr_epi8 (input, shifted, 15);
+    __m256i byte1High = Lookup16Avx2 (utf8ValidTab1High, _mm256_and_si256 (_mm256_srli_epi16 (prev1, 4), nibble));
+    __m256i byte1Low = Lookup16Avx2 (utf8ValidTab1Low, _mm256_and_si256 (prev1, nibble));
+    __m256i byte2High = Lookup16Avx2 (utf8ValidTab2High, _mm256_and_si256 (_mm256_srli_epi16 (input, 4), nibble));
+    __m256i special = _mm256_and_si256 (_mm256_and_si256 (byte1High, byte1Low), byte2High);
+    __m256i prev2 = _mm256_alignr_epi8 (input, shifted, 14);
+    __m256i prev3 = _mm256_alignr_epi8 (input, shifted, 13);
+    __m256i isThird = _mm256_subs_epu8 (prev2, _mm256_set1_epi8 (0xE0 - 0x80));
+    __m256i isFourth = _mm256_subs_epu8 (prev3, _mm256_set1_epi8 (0xF0 - 0x80));
+    __m256i must23 = _mm256_and_si256 (_mm256_or_si256 (isThird, isFourth), _mm256_set1_epi8 ((char) 0x80));
+    return _mm256_xor_si256 (must23, special);
+}
+
+// Validates 32 octets at a time
+__attribute__ ((target ("avx2"))) static size_t unicodeValidateAvx2 (const uint8_t* buf, size_t len)
+{
+    __m256i maxTab = _mm256_load_si256 ((const __m256i*) utf8ValidMaxTab);
+    __m256i prev = _mm256_setzero_si256();
+    __m256i prevIncomplete = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; (i + 32) <= len; i += 32)
+    {
+        __m256i input = _mm256_loadu_si256 ((const __m256i*) (buf + i));
+        __m256i error = prevIncomplete;
+        if (_mm256_movemask_epi8 (input))
+            error = _mm256_or_si256 (error, unicodeCheckBlockAvx2 (input, prev));
+        if (!_mm256_testz_si256 (error, error))
+            break;
+        prevIncomplete = _mm256_subs_epu8 (input, maxTab);
+        prev = input;
+    }
+    return i;
+}
+#elif defined LIBNEX_CPU_ARM && !defined LIBNEX_BAREMETAL
+// Validates 16 octets at a time
+static size_t unicodeValidateNeon (const uint8_t* buf, size_t len)
+{
+    uint8x16_t nibble = vdupq_n_u8 (0x0F);
+    uint8x16_t tab1High = vld1q_u8 (utf8ValidTab1High);
+    uint8x16_t tab1Low = vld1q_u8 (utf8ValidTab1Low);
+    uint8x16_t tab2High = vld1q_u8 (utf8ValidTab2High);
+    uint8x16_t maxTab = vld1q_u8 (utf8ValidMaxTab + 16);
+    uint8x16_t prev = vdupq_n_u8 (0);
+    uint8x16_t prevIncomplete = vdupq_n_u8 (0);
+    size_t i = 0;
+    for (; (i + 16) <= len; i += 16)
+    {
+        uint8x16_t input = vld1q_u8 (buf + i);
+        uint8x16_t error = prevIncomplete;
+        if (vmaxvq_u8 (input) >= 0x80)
+        {
+            uint8x16_t prev1 = vextq_u8 (prev, input, 15);
+            uint8x16_t byte1High = vqtbl1q_u8 (tab1High, vshrq_n_u8 (prev1, 4));
+            uint8x16_t byte1Low = vqtbl1q_u8 (tab1Low, vandq_u8 (prev1, nibble));
+            uint8x16_t byte2High = vqtbl1q_u8 (tab2High, vshrq_n_u8 (input, 4));
+            uint8x16_t special = vandq_u8 (vandq_u8 (byte1High, byte1Low), byte2High);
+            uint8x16_t isThird = vqsubq_u8 (vextq_u8 (prev, input, 14), vdupq_n_u8 (0xE0 - 0x80));
+            uint8x16_t isFourth = vqsubq_u8 (vextq_u8 (prev, input, 13), vdupq_n_u8 (0xF0 - 0x80));
+            uint8x16_t must23 = vandq_u8 (vorrq_u8 (isThird, isFourth), vdupq_n_u8 (0x80));
+            error = vorrq_u8 (error, veorq_u8 (must23, special));
+        }
+        if (vmaxvq_u8 (error))
+            break;
+        prevIncomplete = vqsubq_u8 (input, maxTab);
+        prev = input;
+    }
+    return i;
+}
+#endif
+
+// Counts the octets of buf that aren't continuations, which is the number of characters in valid UTF-8
+static size_t unicodeCount8Scalar (const uint8_t* buf, size_t len)
+{
+    size_t count = 0;
+    for (size_t i = 0; i < len; ++i)
+        count += (buf[i] & 0xC0) != 0x80;
+    return count;
+}
+
+// Counts the UTF-16 units of buf that aren't low surrogates, which is the number of characters
+// in valid UTF-16. lowMask and lowVal pick out low surrogates in the byte order of buf
+static size_t unicodeCount16Scalar (const uint16_t* buf, size_t len, uint16_t lowMask, uint16_t lowVal)
+{
+    size_t count = 0;
+    for (size_t i = 0; i < len; ++i)
+        count += (buf[i] & lowMask) != lowVal;
+    return count;
+}
+
+#ifdef LIBNEX_CPU_X86
+#ifdef __SSE2__
+// Counts 16 octets at a time
+static size_t unicodeCount8Sse2 (const uint8_t* buf, size_t len)
+{
+    size_t count = 0;
+    size_t i = 0;
+    for (; (i + 16) <= len; i += 16)
+    {
+        // Continuations are the only octets at or below -65 as signed values
+        __m128i octets = _mm_loadu_si128 ((const __m128i*) (buf + i));
+        count += __builtin_popcount (_mm_movemask_epi8 (_mm_cmpgt_epi8 (octets, _mm_set1_epi8 (-65))));
+    }
+    return count + unicodeCount8Scalar (buf + i, len - i);
+}
+
+// Counts 8 units at a time
+static size_t unicodeCount16Sse2 (const uint16_t* buf, size_t len, uint16_t lowMask, uint16_t lowVal)
+{
+    size_t count = 0;
+    size_t i = 0;
+    for (; (i + 8) <= len; i += 8)
+    {
+        __m128i units = _mm_loadu_si128 ((const __m128i*) (buf + i));
+        __m128i isLow = _mm_cmpeq_epi16 (_mm_and_si128 (units, _mm_set1_epi16 ((short) lowMask)),
+                                         _mm_set1_epi16 ((short) lowVal));
+        count += 8 - (__builtin_popcount (_mm_movemask_epi8 (isLow)) / 2);
+    }
+    return count + unicodeCount16Scalar (buf + i, len - i, lowMask, lowVal);
+}
+#endif
+
+// Counts 64 octets at a time
+__attribute__ ((target ("avx2"))) static size_t unicodeCount8Avx2 (const uint8_t* buf, size_t len)
+{
+    size_t count = 0;
+    size_t i = 0;
+    for (; (i + 64) <= len; i += 64)
+    {
+        __m256i octets1 = _mm256_loadu_si256 ((const __m256i*) (buf + i));
+        __m256i octets2 = _mm256_loadu_si256 ((const __m256i*) (buf + i + 32));
+        uint32_t mask1 = (uint32_t) _mm256_movemask_epi8 (_mm256_cmpgt_epi8 (octets1, _mm256_set1_epi8 (-65)));
+        uint32_t mask2 = (uint32_t) _mm256_movemask_epi8 (_mm256_cmpgt_epi8 (octets2, _mm256_set1_epi8 (-65)));
+        count += __builtin_popcountll (((uint64_t) mask2 << 32) | mask1);
+    }
+    return count + unicodeCount8Scalar (buf + i, len - i);
+}
+
+// Counts 16 units at a time
+__attribute__ ((target ("avx2"))) static size_t unicodeCount16Avx2 (const uint16_t* buf,
+                                                                     size_t len,
+                                                                     uint16_t lowMask,
+                                                                     uint16_t lowVal)
+{
+    size_t count = 0;
+    size_t i = 0;
+    for (; (i + 16) <= len; i += 16)
+    {
+        __m256i units = _mm256_loadu_si256 ((const __m256i*) (buf + i));
+        __m256i isLow = _mm256_cmpeq_epi16 (_mm256_and_si256 (units, _mm256_set1_epi16 ((short) lowMask)),
+                                            _mm256_set1_epi16 ((short) lowVal));
+        count += 16 - (__builtin_popcount (_mm256_movemask_epi8 (isLow)) / 2);
+    }
+    return count + unicodeCount16Scalar (buf + i, len - i, lowMask, lowVal);
+}
+#elif defined LIBNEX_CPU_ARM && !defined LIBNEX_BAREMETAL
+// Counts 16 octets at a time
+static size_t unicodeCount8Neon (const uint8_t* buf, size_t len)
+{
+    size_t count = 0;
+    size_t i = 0;
+    for (; (i + 16) <= len; i += 16)
+    {
+        // Each lane is 1 for octets that aren't continuations
+        uint8x16_t octets = vld1q_u8 (buf + i);
+        uint8x16_t isStart = vshrq_n_u8 (vcgtq_s8 (vreinterpretq_s8_u8 (octets), vdupq_n_s8 (-65)), 7);
+        count += vaddvq_u8 (isStart);
+    }
+    return count + unicodeCount8Scalar (buf + i, len - i);
+}
+
+// Counts 8 units at a time
+static size_t unicodeCount16Neon (const uint16_t* buf, size_t len, uint16_t lowMask, uint16_t lowVal)
+{
+    size_t count = 0;
+    size_t i = 0;
+    for (; (i + 8) <= len; i += 8)
+    {
+        uint16x8_t units = vld1q_u16 (buf + i);
+        uint16x8_t isLow = vceqq_u16 (vandq_u16 (units, vdupq_n_u16 (lowMask)), vdupq_n_u16 (lowVal));
+        count += 8 - vaddvq_u16 (vshrq_n_u16 (isLow, 15));
+    }
+    return count + unicodeCount16Scalar (buf + i, len - i, lowMask, lowVal);
+}
+#endif
+
+// The kernels that the buffer functions use
+static size_t (*unicodeWidenAscii) (char32_t*, const uint8_t*, size_t);
+static size_t (*unicodeWiden16) (char32_t*, const uint16_t*, size_t, int);
+static size_t (*unicodeWidenAscii16) (uint16_t*, const uint8_t*, size_t, int);
+static size_t (*unicodeNarrow16) (uint8_t*, size_t, const uint16_t*, size_t, int, size_t*);
+static size_t (*unicodeNarrow) (uint8_t*, size_t, const char32_t*, size_t, size_t*);
+static size_t (*unicodeLength8) (const char32_t*, size_t, size_t*);
+static size_t (*unicodeValidate) (const uint8_t*, size_t);
+static size_t (*unicodeCount8) (const uint8_t*, size_t);
+static size_t (*unicodeCount16) (const uint16_t*, size_t, uint16_t, uint16_t);
+static once_t unicodeInitOnce = ONCE_INIT;
+
+// Picks the fastest kernels out of the ones features allow. The baseline kernels are always there
+static void unicodePickKernels (unsigned int features)
+{
+#if defined LIBNEX_CPU_ARM && !defined LIBNEX_BAREMETAL
+    unicodeWidenAscii = unicodeWidenAsciiNeon;
+    unicodeWiden16 = unicodeWiden16Neon;
+    unicodeWidenAscii16 = unicodeWidenAscii16Neon;
+    unicodeNarrow16 = unicodeNarrow16Neon;
+    unicodeNarrow = unicodeNarrowNeon;
+    unicodeLength8 = unicodeLength8Scalar;
+    unicodeValidate = unicodeValidateNeon;
+    unicodeCount8 = unicodeCount8Neon;
+    unicodeCount16 = unicodeCount16Neon;
+#elif defined LIBNEX_CPU_X86 && defined __SSE2__
+    unicodeWidenAscii = unicodeWidenAsciiSse2;
+    unicodeWiden16 = unicodeWiden16Sse2;
+    unicodeWidenAscii16 = unicodeWidenAscii16Sse2;
+    unicodeNarrow16 = unicodeNarrow16Sse2;
+    unicodeNarrow = unicodeNarrowSse2;
+    unicodeLength8 = unicodeLength8Sse2;
+    unicodeValidate = unicodeValidateNone;
+    unicodeCount8 = unicodeCount8Sse2;
+    unicodeCount16 = unicodeCount16Sse2;
+#else
+    unicodeWidenAscii = unicodeWidenAsciiScalar;
+    unicodeWiden16 = unicodeWiden16Scalar;
+    unicodeWidenAscii16 = unicodeWidenAscii16Scalar;
+    unicodeNarrow16 = NULL;
+    unicodeNarrow = NULL;
+    unicodeLength8 = unicodeLength8Scalar;
+    unicodeValidate = unicodeValidateNone;
+    unicodeCount8 = unicodeCount8Scalar;
+    unicodeCount16 = unicodeCount16Scalar;
+#endif
+#ifdef LIBNEX_CPU_X86
+    if (features & CPU_FEAT_AVX2)
+    {
+        unicodeWidenAscii = unicodeWidenAsciiAvx2;
+        unicodeWiden16 = unicodeWiden16Avx2;
+        unicodeWidenAscii16 = unicodeWidenAscii16Avx2;
+        unicodeValidate = unicodeValidateAvx2;
+        unicodeCount8 = unicodeCount8Avx2;
+        unicodeCount16 = unicodeCount16Avx2;
+    }
+    else if (features & CPU_FEAT_SSSE3)
+        unicodeValidate = unicodeValidateSsse3;
+    if (features & CPU_FEAT_SSSE3)
+    {
+        unicodeNarrow = unicodeNarrowSsse3;
+        unicodeNarrow16 = unicodeNarrow16Ssse3;
+    }
+#else
+    (void) features;
+#endif
+}
+
+// Generates the tables and picks the fastest kernels the CPU supports
+static void unicodeInit (void)
+{
+#ifdef LIBNEX_CPU_X86
+    if (CpuHasFeature (CPU_FEAT_SSSE3))
+    {
+        // Generate the packing masks. Lane i is octets 2i and 2i + 1, and a one octet lane only keeps 2i
+        for (int mask = 0; mask < 256; ++mask)
+        {
+            int pos = 0;
+            for (int lane = 0; lane < 8; ++lane)
+            {
+                unicodePackTab[mask][pos++] = lane * 2;
+                if (mask & (1 << lane))
+                    unicodePackTab[mask][pos++] = (lane * 2) + 1;
+            }
+            while (pos < 16)
+                unicodePackTab[mask][pos++] = 0x80;
+        }
+    }
+#endif
+    unicodePickKernels (__Libnex_cpu_features());
+}
+
+#ifdef LIBNEX_KERNEL_HOOKS
+LIBNEX_PUBLIC void __Libnex_unicode_set_features (unsigned int features)
+{
+    __Libnex_once (&unicodeInitOnce, unicodeInit);
+    unicodePickKernels (features & __Libnex_cpu_features());
+}
+#endif
+
+// Decodes one multi-byte sequence the same way as feeding it to UnicodeDecodePart8
+// An invalid sequence becomes U+FFFD, and the octet that broke it is consumed with it
+// Returns the number of octets consumed, or 0 if in ends in the middle of the sequence
+static size_t unicodeDecodeSeq8 (char32_t* out, const uint8_t* in, size_t sz)
+{
+    const Utf8Trans_t* trans = &utf8dfaTab[UTF8_START][utf8classTab[in[0]]];
+    if (!(trans->flags & UTF8_DFA_CONSUME))
+    {
+        *out = 0xFFFD;
+        return 1;
+    }
+    size_t seqSz = trans->size;
+    char32_t codepoint = in[0] & trans->mask;
+    for (size_t i = 1; i < seqSz; ++i)
+    {
+        if (i >= sz)
+            return 0;
+        trans = &utf8dfaTab[UTF8_CONT][utf8classTab[in[i]]];
+        if (!(trans->flags & UTF8_DFA_CONSUME))
+        {
+            *out = 0xFFFD;
+            return i + 1;
+        }
+        codepoint = (codepoint << trans->shift) | (in[i] & trans->mask);
+    }
+    *out = codepoint;
+    return seqSz;
+}
+
+LIBNEX_PUBLIC size_t UnicodeDecode8Buf (char32_t* out,
+                                        size_t outSz,
+                                        const uint8_t* in,
+                                        size_t inSz,
+                                        size_t* consumed)
+{
+    __Libnex_once (&unicodeInitOnce, unicodeInit);
+    size_t inPos = 0;
+    size_t outPos = 0;
+    while (inPos < inSz && outPos < outSz)
+    {
+        if (in[inPos] < 0x80)
+        {
+            // Hand the whole ASCII run to the vector kernel
+            size_t len = (inSz - inPos) < (outSz - outPos) ? (inSz - inPos) : (outSz - outPos);
+            size_t widened = unicodeWidenAscii (out + outPos, in + inPos, len);
+            inPos += widened;
+            outPos += widened;
+        }
+        else
+        {
+            size_t seqSz = unicodeDecodeSeq8 (out + outPos, in + inPos, inSz - inPos);
+            // Leave a trailing incomplete sequence for the next call
+            if (!seqSz)
+                break;
+            inPos += seqSz;
+            ++outPos;
+        }
+    }
+    if (consumed)
+        *consumed = inPos;
+    return outPos;
+}
+
 LIBNEX_PUBLIC size_t UnicodeEncode8 (uint8_t* out, char32_t in, size_t sz)
 {
     // Figure out the size needed and create the leading byte
@@ -215,6 +1342,429 @@ LIBNEX_PUBLIC size_t UnicodeEncode8 (uint8_t* out, char32_t in, size_t sz)
         return 0;
 }
 
+LIBNEX_PUBLIC size_t UnicodeDecode16Buf (char32_t* out,
+                                         size_t outSz,
+                                         const uint16_t* in,
+                                         size_t inSz,
+                                         char endian,
+                                         Utf16State_t* state,
+                                         size_t* consumed)
+{
+    __Libnex_once (&unicodeInitOnce, unicodeInit);
+    if (!endian)
+        endian = EndianHost();
+    int swap = endian != EndianHost();
+    size_t inPos = 0;
+    size_t outPos = 0;
+    // Finish off a surrogate pair left over from last time
+    if (state && state->hasHigh && inSz && outSz)
+    {
+        uint16_t unit = EndianLoad16 (in, endian);
+        if (utf16stateTab[unit >> 10] == UTF16_LOW_SURROGATE)
+        {
+            out[outPos++] = ((state->high & 0x3FF) << 10) + (unit & 0x3FF) + 0x10000;
+            ++inPos;
+        }
+        else
+            out[outPos++] = 0xFFFD;
+        state->hasHigh = false;
+    }
+    while (inPos < inSz && outPos < outSz)
+    {
+        uint16_t unit = EndianLoad16 (in + inPos, endian);
+        if (!IsSurrogate (unit))
+        {
+            // Hand the whole run to the vector kernel
+            size_t len = (inSz - inPos) < (outSz - outPos) ? (inSz - inPos) : (outSz - outPos);
+            size_t widened = unicodeWiden16 (out + outPos, in + inPos, len, swap);
+            inPos += widened;
+            outPos += widened;
+        }
+        else if (utf16stateTab[unit >> 10] == UTF16_LOW_SURROGATE)
+        {
+            // Low surrogate without a high surrogate
+            out[outPos++] = 0xFFFD;
+            ++inPos;
+        }
+        else if ((inPos + 1) == inSz)
+        {
+            // The pair is split. Keep the high surrogate until next time if we can
+            if (state)
+            {
+                state->high = unit;
+                state->hasHigh = true;
+                ++inPos;
+            }
+            break;
+        }
+        else
+        {
+            uint16_t low = EndianLoad16 (in + inPos + 1, endian);
+            if (utf16stateTab[low >> 10] == UTF16_LOW_SURROGATE)
+            {
+                out[outPos++] = ((unit & 0x3FF) << 10) + (low & 0x3FF) + 0x10000;
+                inPos += 2;
+            }
+            else
+            {
+                // High surrogate without a low surrogate
+                out[outPos++] = 0xFFFD;
+                ++inPos;
+            }
+        }
+    }
+    if (consumed)
+        *consumed = inPos;
+    return outPos;
+}
+
+LIBNEX_PUBLIC size_t UnicodeEncode8Buf (uint8_t* out,
+                                        size_t outSz,
+                                        const char32_t* in,
+                                        size_t inSz,
+                                        size_t* consumed)
+{
+    __Libnex_once (&unicodeInitOnce, unicodeInit);
+    size_t inPos = 0;
+    size_t outPos = 0;
+    if (!out)
+        outPos = unicodeLength8 (in, inSz, &inPos);
+    else
+    {
+        while (inPos < inSz)
+        {
+            // Let the vector kernel take as many blocks as it can, if there is one
+            if (unicodeNarrow)
+            {
+                size_t written = 0;
+                inPos += unicodeNarrow (out + outPos, outSz - outPos, in + inPos, inSz - inPos, &written);
+                outPos += written;
+                if (inPos == inSz)
+                    break;
+            }
+            // Then encode the character it stopped at
+            size_t sz = unicodeSize8 (in[inPos]);
+            if (!sz || sz > (outSz - outPos))
+                break;
+            outPos += UnicodeEncode8 (out + outPos, in[inPos], sz);
+            ++inPos;
+        }
+    }
+    if (consumed)
+        *consumed = inPos;
+    return outPos;
+}
+
+// Writes c out as UTF-8 at *outPos, or just sums up its size if out is NULL
+// Returns false if out doesn't have room for it
+static inline bool unicodeEmit8 (uint8_t* out, size_t outSz, size_t* outPos, char32_t c)
+{
+    size_t sz = unicodeSize8 (c);
+    if (out)
+    {
+        if (sz > (outSz - *outPos))
+            return false;
+        UnicodeEncode8 (out + *outPos, c, sz);
+    }
+    *outPos += sz;
+    return true;
+}
+
+LIBNEX_PUBLIC size_t UnicodeTranscode16To8 (uint8_t* out,
+                                            size_t outSz,
+                                            const uint16_t* in,
+                                            size_t inSz,
+                                            char endian,
+                                            Utf16State_t* state,
+                                            size_t* consumed)
+{
+    __Libnex_once (&unicodeInitOnce, unicodeInit);
+    if (!endian)
+        endian = EndianHost();
+    int swap = endian != EndianHost();
+    // Computing the length shouldn't change the caller's state
+    Utf16State_t lenState;
+    if (!out && state)
+    {
+        lenState = *state;
+        state = &lenState;
+    }
+    size_t inPos = 0;
+    size_t outPos = 0;
+    // Finish off a surrogate pair left over from last time
+    if (state && state->hasHigh && inSz)
+    {
+        uint16_t unit = EndianLoad16 (in, endian);
+        bool paired = utf16stateTab[unit >> 10] == UTF16_LOW_SURROGATE;
+        char32_t c = paired ? ((state->high & 0x3FF) << 10) + (unit & 0x3FF) + 0x10000 : 0xFFFD;
+        if (!unicodeEmit8 (out, outSz, &outPos, c))
+            goto end;
+        inPos += paired;
+        state->hasHigh = false;
+    }
+    while (inPos < inSz)
+    {
+        uint16_t unit = EndianLoad16 (in + inPos, endian);
+        if (!IsSurrogate (unit))
+        {
+            // Let the vector kernels take as many blocks as they can, if there are any
+            size_t blockSz = 0;
+            if (out && unicodeNarrow16)
+                inPos += unicodeNarrow16 (out + outPos, outSz - outPos, in + inPos, inSz - inPos, swap, &blockSz);
+#if defined LIBNEX_CPU_X86 && defined __SSE2__
+            else if (!out)
+                inPos += unicodeLength16To8 (in + inPos, inSz - inPos, swap, &blockSz);
+#endif
+            outPos += blockSz;
+            if (inPos == inSz)
+                break;
+            // Then encode the unit they stopped at
+            unit = EndianLoad16 (in + inPos, endian);
+            if (IsSurrogate (unit))
+                continue;
+            if (!unicodeEmit8 (out, outSz, &outPos, unit))
+                break;
+            ++inPos;
+        }
+        else if (utf16stateTab[unit >> 10] == UTF16_LOW_SURROGATE)
+        {
+            // Low surrogate without a high surrogate
+            if (!unicodeEmit8 (out, outSz, &outPos, 0xFFFD))
+                break;
+            ++inPos;
+        }
+        else if ((inPos + 1) == inSz)
+        {
+            // The pair is split. Keep the high surrogate until next time if we can
+            if (state)
+            {
+                state->high = unit;
+                state->hasHigh = true;
+                ++inPos;
+            }
+            break;
+        }
+        else
+        {
+            uint16_t low = EndianLoad16 (in + inPos + 1, endian);
+            bool paired = utf16stateTab[low >> 10] == UTF16_LOW_SURROGATE;
+            char32_t c = paired ? ((unit & 0x3FF) << 10) + (low & 0x3FF) + 0x10000 : 0xFFFD;
+            if (!unicodeEmit8 (out, outSz, &outPos, c))
+                break;
+            inPos += 1 + paired;
+        }
+    }
+end:
+    if (consumed)
+        *consumed = inPos;
+    return outPos;
+}
+
+LIBNEX_PUBLIC size_t UnicodeTranscode8To16 (uint16_t* out,
+                                            size_t outSz,
+                                            const uint8_t* in,
+                                            size_t inSz,
+                                            char endian,
+                                            size_t* consumed)
+{
+    __Libnex_once (&unicodeInitOnce, unicodeInit);
+    if (!endian)
+        endian = EndianHost();
+    int swap = endian != EndianHost();
+    size_t inPos = 0;
+    size_t outPos = 0;
+    while (inPos < inSz)
+    {
+        if (in[inPos] < 0x80)
+        {
+            // ASCII maps straight to one unit each
+            size_t len = inSz - inPos;
+            size_t widened = 0;
+            if (out)
+            {
+                len = len < (outSz - outPos) ? len : (outSz - outPos);
+                if (!len)
+                    break;
+                widened = unicodeWidenAscii16 (out + outPos, in + inPos, len, swap);
+            }
+            else
+                widened = unicodeAsciiLen (in + inPos, len);
+            inPos += widened;
+            outPos += widened;
+            continue;
+        }
+        char32_t c = 0;
+        size_t seqSz = unicodeDecodeSeq8 (&c, in + inPos, inSz - inPos);
+        // Leave a trailing incomplete sequence for the next call
+        if (!seqSz)
+            break;
+        // Surrogates and characters past U+10FFFF can't be put in UTF-16
+        if ((c >= 0xD800 && c <= 0xDFFF) || c > 0x10FFFF)
+            c = 0xFFFD;
+        size_t units = (c >= 0x10000) ? 2 : 1;
+        if (out)
+        {
+            if (units > (outSz - outPos))
+                break;
+            UnicodeEncode16 (out + outPos, c, endian);
+        }
+        inPos += seqSz;
+        outPos += units;
+    }
+    if (consumed)
+        *consumed = inPos;
+    return outPos;
+}
+
+LIBNEX_PUBLIC size_t UnicodeCount8 (const uint8_t* buf, size_t len)
+{
+    __Libnex_once (&unicodeInitOnce, unicodeInit);
+    return unicodeCount8 (buf, len);
+}
+
+LIBNEX_PUBLIC size_t UnicodeCount16 (const uint16_t* buf, size_t len, char endian)
+{
+    __Libnex_once (&unicodeInitOnce, unicodeInit);
+    if (!endian)
+        endian = EndianHost();
+    // Match low surrogates as they are stored, rather than swapping every unit
+    if (endian == EndianHost())
+        return unicodeCount16 (buf, len, 0xFC00, 0xDC00);
+    return unicodeCount16 (buf, len, 0x00FC, 0x00DC);
+}
+
+LIBNEX_PUBLIC size_t UnicodeLength8 (const char32_t* buf, size_t len)
+{
+    return UnicodeEncode8Buf (NULL, 0, buf, len, NULL);
+}
+
+LIBNEX_PUBLIC size_t UnicodeLength16 (const char32_t* buf, size_t len)
+{
+    size_t i = 0;
+    size_t extra = 0;
+#if defined LIBNEX_CPU_X86 && defined __SSE2__
+    for (; (i + 4) <= len; i += 4)
+    {
+        // Leave a block with a character that can't be encoded to the loop below, which stops at it
+        __m128i chars = _mm_loadu_si128 ((const __m128i*) (buf + i));
+        __m128i plane = _mm_srli_epi32 (chars, 16);
+        if (_mm_movemask_epi8 (_mm_cmpgt_epi32 (plane, _mm_set1_epi32 (0x10))))
+            break;
+        // Characters with any of the upper 16 bits set take a surrogate pair
+        __m128i isBmp = _mm_cmpeq_epi32 (plane, _mm_setzero_si128());
+        extra += 4 - (__builtin_popcount (_mm_movemask_epi8 (isBmp)) / 4);
+    }
+#endif
+    for (; i < len && buf[i] <= 0x10FFFF; ++i)
+        extra += buf[i] >= 0x10000;
+    return i + extra;
+}
+
+// Validates buf, returning the offset of the first error or len
+// A sequence cut off at the end of buf is left to the caller through tail
+static size_t unicodeValidate8 (const uint8_t* buf, size_t len, size_t* tail)
+{
+    __Libnex_once (&unicodeInitOnce, unicodeInit);
+    // The vector kernel checks all it can, and the scalar validator picks up from there
+    size_t pos = unicodeSeqStart8 (buf, unicodeValidate (buf, len));
+    size_t err = unicodeValidateScalar (buf + pos, len - pos, tail);
+    *tail += pos;
+    return err + pos;
+}
+
+LIBNEX_PUBLIC bool UnicodeValidate8 (const uint8_t* buf, size_t len, size_t* errOffset)
+{
+    size_t tail = 0;
+    size_t err = unicodeValidate8 (buf, len, &tail);
+    // A cut off sequence is an error here
+    if (err == len)
+        err = tail;
+    if (errOffset)
+        *errOffset = err;
+    return err == len;
+}
+
+LIBNEX_PUBLIC bool UnicodeValidatePart8 (Utf8ValidState_t* state,
+                                          const uint8_t* buf,
+                                          size_t len,
+                                          size_t* errOffset)
+{
+    size_t pos = 0;
+    // Finish off a sequence cut off by the last chunk
+    if (state->tailLen)
+    {
+        size_t seqSz = (state->tail[0] >= 0xF0) ? 4 : (state->tail[0] >= 0xE0) ? 3 : 2;
+        pos = seqSz - state->tailLen;
+        if (pos > len)
+            pos = len;
+        uint8_t seq[4];
+        memcpy (seq, state->tail, state->tailLen);
+        memcpy (seq + state->tailLen, buf, pos);
+        size_t tail = 0;
+        if (unicodeValidateScalar (seq, state->tailLen + pos, &tail) != (state->tailLen + pos))
+        {
+            if (errOffset)
+                *errOffset = state->offset - state->tailLen;
+            return false;
+        }
+        if (tail == 0)
+        {
+            // Still not finished
+            memcpy (state->tail + state->tailLen, buf, pos);
+            state->tailLen += pos;
+            state->offset += len;
+            return true;
+        }
+        state->tailLen = 0;
+    }
+    size_t tail = 0;
+    size_t err = unicodeValidate8 (buf + pos, len - pos, &tail);
+    if (err != (len - pos))
+    {
+        if (errOffset)
+            *errOffset = state->offset + pos + err;
+        return false;
+    }
+    // Hold onto the start of a sequence cut off at the end
+    state->tailLen = (len - pos) - tail;
+    memcpy (state->tail, buf + pos + tail, state->tailLen);
+    state->offset += len;
+    return true;
+}
+
+LIBNEX_PUBLIC bool UnicodeValidateFinish8 (Utf8ValidState_t* state, size_t* errOffset)
+{
+    if (state->tailLen)
+    {
+        if (errOffset)
+            *errOffset = state->offset - state->tailLen;
+        return false;
+    }
+    return true;
+}
+
+// Windows-1252 is a built in codepage, so these go through its tables
+LIBNEX_PUBLIC size_t UnicodeDecodeWin1252 (char32_t* out, const uint8_t* in, size_t len)
+{
+    __Libnex_once (&unicodeInitOnce, unicodeInit);
+    const Codepage_t* cp = CodepageGet (CODEPAGE_WIN1252);
+    size_t i = 0;
+    while (i < len)
+    {
+        // Hand ASCII runs to the vector kernel
+        i += unicodeWidenAscii (out + i, in + i, len - i);
+        // Then translate octets up to the next ASCII one
+        for (; i < len && in[i] >= 0x80; ++i)
+            out[i] = cp->toUnicode[in[i]];
+    }
+    return len;
+}
+
+LIBNEX_PUBLIC size_t UnicodeEncodeWin1252 (uint8_t* out, const char32_t* in, size_t len)
+{
+    return CodepageEncode (CodepageGet (CODEPAGE_WIN1252), out, in, len);
+}
+
 LIBNEX_PUBLIC void UnicodeWriteBom8 (uint8_t* buf)
 {
     buf[0] = 0xEF;
@@ -226,7 +1776,7 @@ LIBNEX_PUBLIC void UnicodeWriteBom16 (uint16_t* out, char order)
 {
     if (!order)
         order = EndianHost();
-    EndianWrite16 (out, 0xFEFF, order);
+    EndianStore16 (out, 0xFEFF, order);
 }
 
 LIBNEX_PUBLIC void UnicodeWriteBom32 (uint32_t* out, char order)
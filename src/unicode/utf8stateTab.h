@@ -18,34 +18,78 @@
 
 /// @file utf8stateTab.h
 
+#include <stdint.h>
+
 // clang-format off
 
-// Based on the upper 5 bits of an octet in a UTF-8 sequence
-static unsigned char utf8stateTab[] = {
-    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 
-    1, 1, 1, 1, 1, 1, 2, 2, 2, 2,
-    2, 2, 2, 2, 3, 3, 3, 3, 4, 4,
-    5, 0
+// The byte classes of the DFA. Each class is a range of octets that the decoder treats the same way
+// 0 = ASCII, 1 = continuation, 2 = 2 octet lead, 3 = bad 2 octet lead (0xC0 and 0xC1),
+// 4 = 3 octet lead, 5 = 4 octet lead, 6 = bad 4 octet lead (0xF5 to 0xF7), 7 = bad octet (0xF8 and up)
+static const unsigned char utf8classTab[] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    3, 3, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+    2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+    4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+    5, 5, 5, 5, 5, 6, 6, 6, 7, 7, 7, 7, 7, 7, 7, 7
 };
 
-// The valid next state for a given state
-static unsigned char utf8nextTab[] = {
-    0, 6, 2, 2, 2, 2
-};
+// A transition of the DFA. The first four fields are the state a lead octet leaves behind,
+// laid out like Utf8State_t so that it can be copied over in one go
+typedef struct _utf8trans
+{
+    uint8_t cur;      // The state whose mask and shift apply to the octet
+    uint8_t next;     // The state to move to
+    uint8_t size;     // The length of the sequence a lead octet starts
+    uint8_t left;     // The number of octets left after a lead octet
+    uint8_t flags;    // What to do with the octet
+    uint8_t mask;     // The bits of the octet that are part of the character
+    uint8_t shift;    // How far to shift the character before adding the octet
+    uint8_t pad;      // Rounds the size up to 8, so that indexing is a shift
+} Utf8Trans_t;
 
-// Masks for each state
-static unsigned char utf8maskTab[] = {
-    0, 0x7F, 0x3F, 0x1F, 0x0F, 0x07
-};
+#define UTF8_DFA_LOAD    (1 << 0)    // Start a new sequence of size octets
+#define UTF8_DFA_STORE   (1 << 1)    // Move to next without consuming the octet
+#define UTF8_DFA_CONSUME (1 << 2)    // Add the octet to the character and move to next
 
-// The size of each state
-static unsigned char utf8sizeTab[] = {
-    0, 1, 0, 2, 3, 4
-};
+// Builds a transition. The mask and shift come from cur
+#define UTF8_DFA(next, cur, size, flags)                                                   \
+    {(cur), (next), (size), (uint8_t) ((size) - 1), (flags),                               \
+     (cur) == 1 ? 0x7F : (cur) == 2 ? 0x3F : (cur) == 3 ? 0x1F : (cur) == 4 ? 0x0F : 0x07, \
+     (cur) == 2 ? 6 : 0, 0}
+#define UTF8_DFA_REJECT {0}
 
-// How much to shift the WIP codepoint by each run
-static unsigned char utf8shiftTab[] = {
-    0, 0, 6, 0, 0, 0
+// The DFA's transitions, indexed by the current state and the class of the octet
+// A transition with no flags rejects the octet without changing the state
+static const Utf8Trans_t utf8dfaTab[7][8] = {
+    // Start of a sequence
+    {UTF8_DFA (6, 1, 1, UTF8_DFA_LOAD | UTF8_DFA_CONSUME), UTF8_DFA (2, 0, 0, UTF8_DFA_STORE),
+     UTF8_DFA (2, 3, 2, UTF8_DFA_LOAD | UTF8_DFA_CONSUME), UTF8_DFA (3, 0, 2, UTF8_DFA_LOAD | UTF8_DFA_STORE),
+     UTF8_DFA (2, 4, 3, UTF8_DFA_LOAD | UTF8_DFA_CONSUME), UTF8_DFA (2, 5, 4, UTF8_DFA_LOAD | UTF8_DFA_CONSUME),
+     UTF8_DFA (5, 0, 4, UTF8_DFA_LOAD | UTF8_DFA_STORE), UTF8_DFA (0, 0, 0, UTF8_DFA_LOAD | UTF8_DFA_STORE)},
+    // Expecting ASCII
+    {UTF8_DFA (6, 1, 0, UTF8_DFA_CONSUME)},
+    // Expecting a continuation
+    {UTF8_DFA_REJECT, UTF8_DFA (2, 2, 0, UTF8_DFA_CONSUME)},
+    // Expecting a 2 octet lead
+    {UTF8_DFA_REJECT, UTF8_DFA_REJECT, UTF8_DFA (2, 3, 0, UTF8_DFA_CONSUME)},
+    // Expecting a 3 octet lead
+    {UTF8_DFA_REJECT, UTF8_DFA_REJECT, UTF8_DFA_REJECT, UTF8_DFA_REJECT, UTF8_DFA (2, 4, 0, UTF8_DFA_CONSUME)},
+    // Expecting a 4 octet lead
+    {UTF8_DFA_REJECT, UTF8_DFA_REJECT, UTF8_DFA_REJECT, UTF8_DFA_REJECT, UTF8_DFA_REJECT,
+     UTF8_DFA (2, 5, 0, UTF8_DFA_CONSUME)},
+    // Accepted
+    {UTF8_DFA_REJECT}
 };
 
 // clang-format on
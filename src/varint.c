@@ -0,0 +1,311 @@
+/*
+    varint.c - contains variable length integer encoding
+    Copyright 2022 The NexNix Project
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    There should be a copy of the License distributed in a file named
+    LICENSE, if not, you may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/// @file varint.c
+
+#include "cpu.h"
+#include <assert.h>
+#include <libnex/endian.h>
+#include <libnex/varint.h>
+#include <stdbool.h>
+
+#if defined LIBNEX_CPU_X86 && defined __SSE2__
+#include <emmintrin.h>
+#define VARINT_HAVE_SSE2
+#endif
+
+// Decodes a ULEB128 value of up to 8 bytes without looping. At least 8 bytes of in must be readable.
+// Returns 0 if the value is longer than that, so the caller can fall back to varintDecodeSlow
+static inline size_t varintDecodeFast (const uint8_t* in, uint64_t* val)
+{
+    uint64_t word = EndianLoad64 (in, ENDIAN_LITTLE);
+    // The first byte with a clear top bit ends the value
+    uint64_t stops = ~word & 0x8080808080808080ULL;
+    if (!stops)
+        return 0;
+    size_t len = ((size_t) __builtin_ctzll (stops) >> 3) + 1;
+    if (len < 8)
+        word &= ((uint64_t) 1 << (len * 8)) - 1;
+    word &= 0x7F7F7F7F7F7F7F7FULL;
+    // Squeeze out the continuation bits, merging groups of 7 into 14, 28, then 56 bits
+    word = ((word & 0x7F007F007F007F00ULL) >> 1) | (word & 0x007F007F007F007FULL);
+    word = ((word & 0x3FFF00003FFF0000ULL) >> 2) | (word & 0x00003FFF00003FFFULL);
+    word = ((word & 0x0FFFFFFF00000000ULL) >> 4) | (word & 0x000000000FFFFFFFULL);
+    *val = word;
+    return len;
+}
+
+// Decodes a ULEB128 value one byte at a time. In a 10 byte value, the last byte only holds bit 63.
+// For signed values, it must be 0x00 or 0x7F, as the remaining bits are sign extension
+static size_t varintDecodeSlow (const uint8_t* in, size_t sz, uint64_t* val, bool isSigned)
+{
+    uint64_t res = 0;
+    for (size_t i = 0; i < sz && i < VARINT_MAX_BYTES; ++i)
+    {
+        uint8_t byte = in[i];
+        if (i == (VARINT_MAX_BYTES - 1))
+        {
+            uint8_t bits = byte & 0x7F;
+            if ((byte & 0x80) || (isSigned ? (bits != 0 && bits != 0x7F) : (bits > 1)))
+                return 0;
+        }
+        res |= (uint64_t) (byte & 0x7F) << (i * 7);
+        if (!(byte & 0x80))
+        {
+            *val = res;
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
+// Decodes a ULEB128 value, using the fast path when possible
+static inline size_t varintDecode (const uint8_t* in, size_t sz, uint64_t* val, bool isSigned)
+{
+    if (sz >= 8)
+    {
+        size_t len = varintDecodeFast (in, val);
+        if (len)
+            return len;
+    }
+    return varintDecodeSlow (in, sz, val, isSigned);
+}
+
+// Sign extends a decoded SLEB128 value of len bytes
+static inline int64_t varintSignExtend (uint64_t val, size_t len)
+{
+    size_t bits = len * 7;
+    if (bits < 64 && (val & ((uint64_t) 1 << (bits - 1))))
+        val |= ~(uint64_t) 0 << bits;
+    return (int64_t) val;
+}
+
+LIBNEX_PUBLIC size_t VarintSizeU (uint64_t val)
+{
+    size_t bits = 64 - __builtin_clzll (val | 1);
+    return (bits + 6) / 7;
+}
+
+LIBNEX_PUBLIC size_t VarintSizeS (int64_t val)
+{
+    // Count the bits that differ from the sign, plus the sign bit itself
+    uint64_t mag = (uint64_t) val ^ (uint64_t) (val >> 63);
+    size_t bits = (mag ? (64 - __builtin_clzll (mag)) : 0) + 1;
+    return (bits + 6) / 7;
+}
+
+LIBNEX_PUBLIC size_t VarintEncodeU (uint8_t* out, uint64_t val)
+{
+    assert (out);
+    size_t i = 0;
+    while (val >= 0x80)
+    {
+        out[i++] = (uint8_t) val | 0x80;
+        val >>= 7;
+    }
+    out[i++] = (uint8_t) val;
+    return i;
+}
+
+LIBNEX_PUBLIC size_t VarintEncodeS (uint8_t* out, int64_t val)
+{
+    assert (out);
+    size_t i = 0;
+    for (;;)
+    {
+        uint8_t byte = (uint8_t) val & 0x7F;
+        val >>= 7;
+        // Stop once the rest of the value is sign extension of this byte
+        if ((val == 0 && !(byte & 0x40)) || (val == -1 && (byte & 0x40)))
+        {
+            out[i++] = byte;
+            return i;
+        }
+        out[i++] = byte | 0x80;
+    }
+}
+
+LIBNEX_PUBLIC size_t VarintDecodeU (const uint8_t* in, size_t sz, uint64_t* val)
+{
+    assert (in && val);
+    return varintDecode (in, sz, val, false);
+}
+
+LIBNEX_PUBLIC size_t VarintDecodeS (const uint8_t* in, size_t sz, int64_t* val)
+{
+    assert (in && val);
+    uint64_t res = 0;
+    size_t len = varintDecode (in, sz, &res, true);
+    if (len)
+        *val = varintSignExtend (res, len);
+    return len;
+}
+
+LIBNEX_PUBLIC size_t VarintEncodeBufU (uint8_t* out,
+                                       size_t outSz,
+                                       const uint64_t* in,
+                                       size_t count,
+                                       size_t* written)
+{
+    assert (out && in && written);
+    size_t pos = 0;
+    size_t i = 0;
+    for (; i < count; ++i)
+    {
+        uint64_t val = in[i];
+        if (val < 0x80 && pos < outSz)
+            out[pos++] = (uint8_t) val;
+        else if ((outSz - pos) >= VARINT_MAX_BYTES || (outSz - pos) >= VarintSizeU (val))
+            pos += VarintEncodeU (out + pos, val);
+        else
+            break;
+    }
+    *written = pos;
+    return i;
+}
+
+LIBNEX_PUBLIC size_t VarintEncodeBufS (uint8_t* out,
+                                       size_t outSz,
+                                       const int64_t* in,
+                                       size_t count,
+                                       size_t* written)
+{
+    assert (out && in && written);
+    size_t pos = 0;
+    size_t i = 0;
+    for (; i < count; ++i)
+    {
+        if ((outSz - pos) < VARINT_MAX_BYTES && (outSz - pos) < VarintSizeS (in[i]))
+            break;
+        pos += VarintEncodeS (out + pos, in[i]);
+    }
+    *written = pos;
+    return i;
+}
+
+LIBNEX_PUBLIC size_t VarintEncodeBufZ (uint8_t* out,
+                                       size_t outSz,
+                                       const int64_t* in,
+                                       size_t count,
+                                       size_t* written)
+{
+    assert (out && in && written);
+    size_t pos = 0;
+    size_t i = 0;
+    for (; i < count; ++i)
+    {
+        uint64_t val = VarintZigzagEncode (in[i]);
+        if (val < 0x80 && pos < outSz)
+            out[pos++] = (uint8_t) val;
+        else if ((outSz - pos) >= VARINT_MAX_BYTES || (outSz - pos) >= VarintSizeU (val))
+            pos += VarintEncodeU (out + pos, val);
+        else
+            break;
+    }
+    *written = pos;
+    return i;
+}
+
+#ifdef VARINT_HAVE_SSE2
+// Widens 16 single byte values to 64 bits each
+static inline void varintWiden16 (uint64_t* out, __m128i bytes)
+{
+    __m128i zero = _mm_setzero_si128();
+    __m128i words[2] = {_mm_unpacklo_epi8 (bytes, zero), _mm_unpackhi_epi8 (bytes, zero)};
+    for (int i = 0; i < 2; ++i)
+    {
+        __m128i dwords[2] = {_mm_unpacklo_epi16 (words[i], zero), _mm_unpackhi_epi16 (words[i], zero)};
+        for (int j = 0; j < 2; ++j)
+        {
+            _mm_storeu_si128 ((__m128i*) out, _mm_unpacklo_epi32 (dwords[j], zero));
+            _mm_storeu_si128 ((__m128i*) (out + 2), _mm_unpackhi_epi32 (dwords[j], zero));
+            out += 4;
+        }
+    }
+}
+#endif
+
+LIBNEX_PUBLIC size_t VarintDecodeBufU (uint64_t* out,
+                                       size_t count,
+                                       const uint8_t* in,
+                                       size_t inSz,
+                                       size_t* consumed)
+{
+    assert (out && in && consumed);
+    size_t pos = 0;
+    size_t i = 0;
+    while (i < count)
+    {
+#ifdef VARINT_HAVE_SSE2
+        // Small values are common, so decode runs of 16 single byte values at once
+        if ((count - i) >= 16 && (inSz - pos) >= 16)
+        {
+            __m128i bytes = _mm_loadu_si128 ((const __m128i*) (in + pos));
+            if (!_mm_movemask_epi8 (bytes))
+            {
+                varintWiden16 (out + i, bytes);
+                i += 16;
+                pos += 16;
+                continue;
+            }
+        }
+#endif
+        size_t len = varintDecode (in + pos, inSz - pos, &out[i], false);
+        if (!len)
+            break;
+        pos += len;
+        ++i;
+    }
+    *consumed = pos;
+    return i;
+}
+
+LIBNEX_PUBLIC size_t VarintDecodeBufS (int64_t* out,
+                                       size_t count,
+                                       const uint8_t* in,
+                                       size_t inSz,
+                                       size_t* consumed)
+{
+    assert (out && in && consumed);
+    size_t pos = 0;
+    size_t i = 0;
+    for (; i < count; ++i)
+    {
+        uint64_t val = 0;
+        size_t len = varintDecode (in + pos, inSz - pos, &val, true);
+        if (!len)
+            break;
+        out[i] = varintSignExtend (val, len);
+        pos += len;
+    }
+    *consumed = pos;
+    return i;
+}
+
+LIBNEX_PUBLIC size_t VarintDecodeBufZ (int64_t* out,
+                                       size_t count,
+                                       const uint8_t* in,
+                                       size_t inSz,
+                                       size_t* consumed)
+{
+    // Decode as unsigned, then undo the zigzag in place
+    size_t decoded = VarintDecodeBufU ((uint64_t*) out, count, in, inSz, consumed);
+    for (size_t i = 0; i < decoded; ++i)
+        out[i] = VarintZigzagDecode ((uint64_t) out[i]);
+    return decoded;
+}
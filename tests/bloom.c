@@ -0,0 +1,87 @@
+/*
+    bloom.c - contains test suite for Bloom filters
+    Copyright 2022 The NexNix Project
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    There should be a copy of the License distributed in a file named
+    LICENSE, if not, you may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/// @file bloom.c
+
+#include <libnex.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NEXTEST_NAME "bloom"
+#include <nextest.h>
+
+// Checks that every added item is found, and that the false positive rate is sane
+static int testFilter (BloomFilter_t* filter, double maxFpRate)
+{
+    for (uint32_t i = 0; i < 1000; ++i)
+        BloomAdd (filter, &i, sizeof (uint32_t));
+    for (uint32_t i = 0; i < 1000; ++i)
+        TEST_BOOL (BloomCheck (filter, &i, sizeof (uint32_t)), "BloomCheck() with added item");
+    int falsePositives = 0;
+    for (uint32_t i = 1000; i < 11000; ++i)
+    {
+        if (BloomCheck (filter, &i, sizeof (uint32_t)))
+            ++falsePositives;
+    }
+    TEST_BOOL (falsePositives < (int) (10000 * maxFpRate), "BloomCheck() false positive rate");
+    return 0;
+}
+
+int main()
+{
+    // Test a standard filter
+    BloomFilter_t* filter = BloomCreateFp (1000, 0.01, 0);
+    TEST_BOOL (filter && filter->numProbes == 7 && filter->numBits == 9728, "BloomCreateFp()");
+    if (testFilter (filter, 0.02))
+        return 1;
+    BloomDestroy (filter);
+
+    // Test a blocked filter
+    filter = BloomCreateFp (1000, 0.01, BLOOM_FLAG_BLOCKED);
+    TEST_BOOL (filter, "BloomCreateFp() blocked");
+    if (testFilter (filter, 0.03))
+        return 1;
+
+    // Test merging
+    BloomFilter_t* filter2 = BloomCreate (filter->numBits, filter->numProbes, BLOOM_FLAG_BLOCKED);
+    uint32_t item = 0xDEADBEEF;
+    BloomAdd (filter2, &item, sizeof (uint32_t));
+    TEST_BOOL (BloomMerge (filter, filter2), "BloomMerge()");
+    TEST_BOOL (BloomCheck (filter, &item, sizeof (uint32_t)), "BloomMerge() result validity");
+    BloomDestroy (filter2);
+    filter2 = BloomCreate (filter->numBits, filter->numProbes, 0);
+    TEST_BOOL (!BloomMerge (filter, filter2), "BloomMerge() with incompatible filter");
+    BloomDestroy (filter2);
+
+    // Test serialization
+    size_t sz = BloomSerializedSize (filter);
+    uint8_t* buf = malloc_s (sz);
+    TEST (BloomSerialize (filter, buf, sz - 1), 0, "BloomSerialize() with small buffer");
+    TEST (BloomSerialize (filter, buf, sz), sz, "BloomSerialize()");
+    filter2 = BloomDeserialize (buf, sz);
+    TEST_BOOL (filter2 && filter2->numBits == filter->numBits && filter2->numProbes == filter->numProbes &&
+                   filter2->flags == filter->flags,
+               "BloomDeserialize()");
+    TEST_BOOL (!memcmp (filter->bits, filter2->bits, filter->numBits / 8), "BloomDeserialize() result validity");
+    buf[0] = 0;
+    TEST_BOOL (!BloomDeserialize (buf, sz), "BloomDeserialize() with bad magic");
+    free (buf);
+    BloomDestroy (filter2);
+    BloomDestroy (filter);
+    return 0;
+}
@@ -0,0 +1,106 @@
+/*
+    bytestream.c - contains test suite for byte streams
+    Copyright 2022 The NexNix Project
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    There should be a copy of the License distributed in a file named
+    LICENSE, if not, you may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/// @file bytestream.c
+
+#include <libnex.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NEXTEST_NAME "bytestream"
+#include <nextest.h>
+
+#define SPAN_SIZE 5000
+
+int main()
+{
+    TEST_BOOL (!strcmp (ByteError (BYTE_EOF), "Unexpected end of file"), "ByteError()");
+    ByteStream_t* stream = NULL;
+    TEST (ByteOpenEx ("testBytes.testout", &stream, BYTE_MODE_WRITE, 4),
+          BYTE_INVALID_PARAMETER,
+          "ByteOpenEx() with tiny buffer");
+
+    // Write out a file with a small buffer, so that values straddle frames
+    uint8_t* span = malloc_s (SPAN_SIZE);
+    for (int i = 0; i < SPAN_SIZE; ++i)
+        span[i] = (uint8_t) (i * 7);
+    TEST (ByteOpenEx ("testBytes.testout", &stream, BYTE_MODE_WRITE, 32), BYTE_SUCCESS, "ByteOpenEx()");
+    for (int i = 0; i < 100; ++i)
+    {
+        TEST (ByteWriteU8 (stream, (uint8_t) i), BYTE_SUCCESS, "ByteWriteU8()");
+        TEST (ByteWriteU16 (stream, 0x1234, ENDIAN_BIG), BYTE_SUCCESS, "ByteWriteU16()");
+        TEST (ByteWriteU32 (stream, 0x12345678 + i, ENDIAN_LITTLE), BYTE_SUCCESS, "ByteWriteU32()");
+        TEST (ByteWriteU64 (stream, 0x0123456789ABCDEF, ENDIAN_BIG), BYTE_SUCCESS, "ByteWriteU64()");
+        TEST (ByteWriteVarU (stream, (uint64_t) i << (i % 60)), BYTE_SUCCESS, "ByteWriteVarU()");
+        TEST (ByteWriteVarS (stream, -i * 1000), BYTE_SUCCESS, "ByteWriteVarS()");
+    }
+    TEST (ByteWrite (stream, span, 20), BYTE_SUCCESS, "ByteWrite()");
+    TEST (ByteWrite (stream, span, SPAN_SIZE), BYTE_SUCCESS, "ByteWrite() with large span");
+    // Closing a referenced stream only drops the reference
+    ByteRef (stream);
+    TEST (ByteClose (stream), BYTE_SUCCESS, "ByteClose() with a reference");
+    TEST (ByteWriteU32 (stream, 0xDEADBEEF, ENDIAN_BIG), BYTE_SUCCESS, "ByteWriteU32()");
+    uint8_t val8 = 0;
+    TEST (ByteReadU8 (stream, &val8), BYTE_INVALID_PARAMETER, "ByteReadU8() on write stream");
+    TEST (ByteClose (stream), BYTE_SUCCESS, "ByteClose()");
+
+    // Read it back in
+    TEST (ByteOpenEx ("testBytes.testout", &stream, BYTE_MODE_READ, 32), BYTE_SUCCESS, "ByteOpenEx() for reading");
+    for (int i = 0; i < 100; ++i)
+    {
+        uint16_t val16 = 0;
+        uint32_t val32 = 0;
+        uint64_t val64 = 0;
+        int64_t sval = 0;
+        TEST_BOOL (ByteReadU8 (stream, &val8) == BYTE_SUCCESS && val8 == i, "ByteReadU8()");
+        TEST_BOOL (ByteReadU16 (stream, &val16, ENDIAN_BIG) == BYTE_SUCCESS && val16 == 0x1234, "ByteReadU16()");
+        TEST_BOOL (ByteReadU32 (stream, &val32, ENDIAN_LITTLE) == BYTE_SUCCESS &&
+                       val32 == 0x12345678u + (uint32_t) i,
+                   "ByteReadU32()");
+        TEST_BOOL (ByteReadU64 (stream, &val64, ENDIAN_BIG) == BYTE_SUCCESS && val64 == 0x0123456789ABCDEF,
+                   "ByteReadU64()");
+        TEST_BOOL (ByteReadVarU (stream, &val64) == BYTE_SUCCESS && val64 == ((uint64_t) i << (i % 60)),
+                   "ByteReadVarU()");
+        TEST_BOOL (ByteReadVarS (stream, &sval) == BYTE_SUCCESS && sval == -i * 1000, "ByteReadVarS()");
+    }
+    // Test peeking
+    const uint8_t* data = NULL;
+    size_t avail = 0;
+    TEST (BytePeek (stream, 10, &data, &avail), BYTE_SUCCESS, "BytePeek()");
+    TEST_BOOL (avail >= 10 && !memcmp (data, span, 10), "BytePeek() result validity");
+    TEST (ByteConsume (stream, 10), BYTE_SUCCESS, "ByteConsume()");
+    TEST (BytePeek (stream, 64, &data, &avail), BYTE_BUF_TOO_SMALL, "BytePeek() larger than buffer");
+    // Read the rest of the small span, then the large one
+    uint8_t* readSpan = malloc_s (SPAN_SIZE);
+    size_t bytesRead = 0;
+    TEST (ByteRead (stream, readSpan, 10, &bytesRead), BYTE_SUCCESS, "ByteRead()");
+    TEST_BOOL (bytesRead == 10 && !memcmp (readSpan, span + 10, 10), "ByteRead() result validity");
+    TEST (ByteRead (stream, readSpan, SPAN_SIZE, &bytesRead), BYTE_SUCCESS, "ByteRead() with large span");
+    TEST_BOOL (bytesRead == SPAN_SIZE && !memcmp (readSpan, span, SPAN_SIZE), "ByteRead() large result validity");
+    uint32_t val32 = 0;
+    TEST_BOOL (ByteReadU32 (stream, &val32, ENDIAN_BIG) == BYTE_SUCCESS && val32 == 0xDEADBEEF, "ByteReadU32()");
+    // We should be at the end now
+    TEST (ByteReadU32 (stream, &val32, ENDIAN_BIG), BYTE_EOF, "ByteReadU32() at end of file");
+    TEST (ByteRead (stream, readSpan, 10, &bytesRead), BYTE_EOF, "ByteRead() at end of file");
+    TEST (bytesRead, 0, "ByteRead() at end of file size");
+    TEST_BOOL (ByteIsEof (stream), "ByteIsEof()");
+    TEST (ByteClose (stream), BYTE_SUCCESS, "ByteClose() for reading");
+    free (span);
+    free (readSpan);
+    return 0;
+}
@@ -0,0 +1,122 @@
+/*
+    codepage.c - contains test suite for single byte codepages
+    Copyright 2022 The NexNix Project
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    There should be a copy of the License distributed in a file named
+    LICENSE, if not, you may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/// @file codepage.c
+
+#include <libnex.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NEXTEST_NAME "codepage"
+#include <nextest.h>
+
+// Checks that every defined octet of a codepage round trips
+static int testRoundTrip (const Codepage_t* cp, const char* name)
+{
+    // Interleave ASCII and each octet, then add a long ASCII run, so both vector paths are hit
+    uint8_t in[576];
+    uint8_t out[576];
+    char32_t chars[576];
+    for (int i = 0; i < 256; ++i)
+    {
+        in[i * 2] = 'a' + (i % 26);
+        in[(i * 2) + 1] = (uint8_t) i;
+    }
+    for (int i = 512; i < 576; ++i)
+        in[i] = 'A' + (i % 26);
+    TEST (CodepageDecode (cp, chars, in, 576), 576, name);
+    size_t inPos = 0;
+    size_t outPos = 0;
+    while (inPos < 576)
+    {
+        size_t encoded = CodepageEncode (cp, out + outPos, chars + inPos, 576 - inPos);
+        inPos += encoded;
+        outPos += encoded;
+        if (inPos == 576)
+            break;
+        // Undefined octets don't round trip
+        TEST_BOOL (chars[inPos] == 0xFFFD && cp->toUnicode[in[inPos]] == 0xFFFD, name);
+        out[outPos++] = in[inPos++];
+    }
+    TEST_BOOL (!memcmp (in, out, 576), name);
+    return 0;
+}
+
+int main()
+{
+    // Test every built in codepage
+    for (int id = 0; id <= CODEPAGE_MAX + 1; ++id)
+    {
+        const Codepage_t* cp = CodepageGet (id);
+        if (id == 0 || id == 12 || id > CODEPAGE_MAX)
+        {
+            TEST_BOOL (!cp, "CodepageGet() with invalid ID");
+            continue;
+        }
+        TEST_BOOL (cp && cp->isAscii, "CodepageGet()");
+        TEST_BOOL (CodepageGet (id) == cp, "CodepageGet() caching");
+        if (testRoundTrip (cp, "built in codepage round trip"))
+            return 1;
+    }
+    TEST (CodepageGetId ("ISO-8859-2"), CODEPAGE_ISO8859_2, "CodepageGetId()");
+    TEST (CodepageGetId ("KOI8-R"), CODEPAGE_KOI8_R, "CodepageGetId()");
+    TEST (CodepageGetId ("windows-1252"), CODEPAGE_WIN1252, "CodepageGetId()");
+    TEST (CodepageGetId ("ISO-8859-12"), 0, "CodepageGetId() with invalid name");
+
+    // Spot check some characters
+    char32_t c = 0;
+    CodepageDecode (CodepageGet (CODEPAGE_ISO8859_2), &c, (const uint8_t*) "\xA1", 1);
+    TEST (c, 0x0104, "CodepageDecode() result validity");
+    CodepageDecode (CodepageGet (CODEPAGE_CP437), &c, (const uint8_t*) "\xB3", 1);
+    TEST (c, 0x2502, "CodepageDecode() result validity");
+    CodepageDecode (CodepageGet (CODEPAGE_KOI8_R), &c, (const uint8_t*) "\xC1", 1);
+    TEST (c, 0x0430, "CodepageDecode() result validity");
+    CodepageDecode (CodepageGet (CODEPAGE_ISO8859_3), &c, (const uint8_t*) "\xA5", 1);
+    TEST (c, 0xFFFD, "CodepageDecode() with undefined octet");
+    uint8_t octet = 0;
+    char32_t chars[] = {0x20AC, 0x0152, 0x0430, 0x1F600};
+    TEST (CodepageEncode (CodepageGet (CODEPAGE_ISO8859_15), &octet, chars, 1), 1, "CodepageEncode()");
+    TEST (octet, 0xA4, "CodepageEncode() result validity");
+    TEST (CodepageEncode (CodepageGet (CODEPAGE_ISO8859_1), &octet, chars, 1),
+          0,
+          "CodepageEncode() with invalid character");
+    TEST (CodepageEncode (CodepageGet (CODEPAGE_KOI8_R), &octet, chars + 3, 1),
+          0,
+          "CodepageEncode() with invalid character");
+
+    // Test a full custom table where octet 0 isn't U+0000
+    char32_t table[256];
+    for (int i = 0; i < 256; ++i)
+        table[i] = 0x2500 + i;
+    table[0] = 0x263A;
+    table[0x7F] = 0;
+    Codepage_t* cp = CodepageCreate (table, 256);
+    TEST_BOOL (cp && !cp->isAscii, "CodepageCreate()");
+    if (testRoundTrip (cp, "custom codepage round trip"))
+        return 1;
+    chars[0] = 0;
+    TEST (CodepageEncode (cp, &octet, chars, 1), 0, "CodepageEncode() with U+0000 not in codepage");
+    chars[0] = 0x263A;
+    TEST (CodepageEncode (cp, &octet, chars, 1), 1, "CodepageEncode() with octet 0");
+    TEST (octet, 0, "CodepageEncode() result validity");
+    CodepageDestroy (cp);
+    table[5] = 0x1F600;
+    TEST_BOOL (!CodepageCreate (table, 256), "CodepageCreate() with character outside of BMP");
+    TEST_BOOL (!CodepageCreate (table, 100), "CodepageCreate() with invalid size");
+    return 0;
+}
@@ -0,0 +1,165 @@
+/*
+    crc32.c - contains test suite for CRC32 functions
+    Copyright 2022 The NexNix Project
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    There should be a copy of the License distributed in a file named
+    LICENSE, if not, you may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/// @file crc32.c
+
+#include "cpu.h"
+#include <libnex.h>
+#include <stdlib.h>
+
+#define NEXTEST_NAME "crc32"
+#include <nextest.h>
+
+// Bit by bit reference implementation
+static uint32_t refCrc32 (const uint8_t* buf, size_t len)
+{
+    uint32_t crc = 0xFFFFFFFF;
+    for (size_t i = 0; i < len; ++i)
+    {
+        crc ^= buf[i];
+        for (int bit = 0; bit < 8; ++bit)
+            crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+    }
+    return ~crc;
+}
+
+// Bit by bit reference CRC32C
+static uint32_t refCrc32c (const uint8_t* buf, size_t len)
+{
+    uint32_t crc = 0xFFFFFFFF;
+    for (size_t i = 0; i < len; ++i)
+    {
+        crc ^= buf[i];
+        for (int bit = 0; bit < 8; ++bit)
+            crc = (crc >> 1) ^ (0x82F63B78 & -(crc & 1));
+    }
+    return ~crc;
+}
+
+// Bit by bit reference CRC64
+static uint64_t refCrc64 (const uint8_t* buf, size_t len)
+{
+    uint64_t crc = 0xFFFFFFFFFFFFFFFFULL;
+    for (size_t i = 0; i < len; ++i)
+    {
+        crc ^= buf[i];
+        for (int bit = 0; bit < 8; ++bit)
+            crc = (crc >> 1) ^ (0xC96C5795D7870F42ULL & -(crc & 1));
+    }
+    return ~crc;
+}
+
+int main()
+{
+    TEST (Crc32Calc ((const uint8_t*) "123456789", 9), 0xCBF43926, "Crc32Calc() check value");
+    TEST (Crc32Calc ((const uint8_t*) "", 0), 0, "Crc32Calc() with empty buffer");
+
+    // Cross check against reference on random buffers, lengths, and alignments
+    uint8_t* buf = malloc_s (4096 + 16);
+    srand (1);
+    for (int i = 0; i < (4096 + 16); ++i)
+        buf[i] = (uint8_t) rand();
+    for (int i = 0; i < 500; ++i)
+    {
+        size_t off = rand() % 16;
+        size_t len = (i < 64) ? i : rand() % 4096;
+        TEST (Crc32Calc (buf + off, len), refCrc32 (buf + off, len), "Crc32Calc() against reference");
+    }
+
+    // Test incremental computation
+    uint32_t crc = Crc32Init();
+    crc = Crc32Update (crc, buf, 100);
+    crc = Crc32Update (crc, buf + 100, 3);
+    crc = Crc32Update (crc, buf + 103, 4000);
+    TEST (Crc32Final (crc), Crc32Calc (buf, 4103), "Crc32Update()");
+
+    // Test combining
+    for (int i = 0; i < 100; ++i)
+    {
+        size_t lenA = rand() % 2048;
+        size_t lenB = rand() % 2048;
+        uint32_t crcA = Crc32Calc (buf, lenA);
+        uint32_t crcB = Crc32Calc (buf + lenA, lenB);
+        TEST (Crc32Combine (crcA, crcB, lenB), Crc32Calc (buf, lenA + lenB), "Crc32Combine()");
+    }
+
+    // Test CRC32C
+    TEST (Crc32cCalc ((const uint8_t*) "123456789", 9), 0xE3069283, "Crc32cCalc() check value");
+    for (int i = 0; i < 200; ++i)
+    {
+        size_t off = rand() % 16;
+        size_t len = (i < 64) ? i : rand() % 4096;
+        TEST (Crc32cCalc (buf + off, len), refCrc32c (buf + off, len), "Crc32cCalc() against reference");
+    }
+    uint32_t crc32c = Crc32cInit();
+    crc32c = Crc32cUpdate (crc32c, buf, 7);
+    crc32c = Crc32cUpdate (crc32c, buf + 7, 2000);
+    TEST (Crc32cFinal (crc32c), Crc32cCalc (buf, 2007), "Crc32cUpdate()");
+    TEST (Crc32cCombine (Crc32cCalc (buf, 1000), Crc32cCalc (buf + 1000, 777), 777),
+          Crc32cCalc (buf, 1777),
+          "Crc32cCombine()");
+
+    // Force each kernel in turn, and cross check it against the reference
+    unsigned int kernelFeats[] = {0, CPU_FEAT_PCLMUL | CPU_FEAT_ARM_CRC32, CPU_FEAT_SSE42, ~0U};
+    for (int k = 0; k < 4; ++k)
+    {
+        __Libnex_crc_set_features (kernelFeats[k]);
+        for (int i = 0; i < 300; ++i)
+        {
+            size_t off = rand() % 16;
+            size_t len = (i < 128) ? i : rand() % 4096;
+            TEST (Crc32Calc (buf + off, len), refCrc32 (buf + off, len), "CRC32 kernel against reference");
+            TEST (Crc32cCalc (buf + off, len), refCrc32c (buf + off, len), "CRC32C kernel against reference");
+        }
+    }
+
+    // Test CRC64
+    TEST (Crc64Calc ((const uint8_t*) "123456789", 9), 0x995DC9BBDF1939FAULL, "Crc64Calc() check value");
+    for (int i = 0; i < 200; ++i)
+    {
+        size_t off = rand() % 16;
+        size_t len = (i < 64) ? i : rand() % 4096;
+        TEST (Crc64Calc (buf + off, len), refCrc64 (buf + off, len), "Crc64Calc() against reference");
+    }
+    uint64_t crc64 = Crc64Init();
+    crc64 = Crc64Update (crc64, buf, 13);
+    crc64 = Crc64Update (crc64, buf + 13, 3000);
+    TEST (Crc64Final (crc64), Crc64Calc (buf, 3013), "Crc64Update()");
+    for (int i = 0; i < 50; ++i)
+    {
+        size_t lenA = rand() % 2048;
+        size_t lenB = rand() % 2048;
+        TEST (Crc64Combine (Crc64Calc (buf, lenA), Crc64Calc (buf + lenA, lenB), lenB),
+              Crc64Calc (buf, lenA + lenB),
+              "Crc64Combine()");
+    }
+    free (buf);
+
+    // Test parallel computation
+    size_t bigLen = (4 * 1024 * 1024) + 13;
+    buf = malloc_s (bigLen);
+    for (size_t i = 0; i < bigLen; ++i)
+        buf[i] = (uint8_t) rand();
+    uint32_t expected = Crc32Calc (buf, bigLen);
+    TEST (Crc32CalcParallel (buf, bigLen, 1), expected, "Crc32CalcParallel() with 1 thread");
+    TEST (Crc32CalcParallel (buf, bigLen, 3), expected, "Crc32CalcParallel() with 3 threads");
+    TEST (Crc32CalcParallel (buf, bigLen, 8), expected, "Crc32CalcParallel() with 8 threads");
+    TEST (Crc32CalcParallel (buf, 1000, 8), Crc32Calc (buf, 1000), "Crc32CalcParallel() with small buffer");
+    free (buf);
+    return 0;
+}
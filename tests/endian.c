@@ -18,11 +18,64 @@
 
 /// @file endian.c
 
+#include "cpu.h"
 #include <libnex.h>
+#include <stdlib.h>
+#include <string.h>
 
 #define NEXTEST_NAME "endian"
 #include <nextest.h>
 
+#define BUF_SIZE 1024
+
+// Checks a swapped buffer against swapping each element one at a time
+static int checkSwap (const uint8_t* src, const uint8_t* dst, size_t count, int size)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        for (int j = 0; j < size; ++j)
+        {
+            if (dst[(i * size) + j] != src[(i * size) + (size - j - 1)])
+                return 0;
+        }
+    }
+    return 1;
+}
+
+// Tests the buffer functions, which run on whichever kernel is picked
+static int testSwapBuf (void)
+{
+    // Try every length up to a few vectors, and odd alignments
+    uint8_t* src = malloc_s (BUF_SIZE + 8);
+    uint8_t* dst = malloc_s (BUF_SIZE + 8);
+    uint8_t* tmp = malloc_s (BUF_SIZE + 8);
+    for (int i = 0; i < (BUF_SIZE + 8); ++i)
+        src[i] = (uint8_t) rand();
+    for (size_t count = 0; count < 80; ++count)
+    {
+        size_t off = count % 8;
+        EndianSwapBuf16 (dst + off, src + off, count);
+        TEST_BOOL (checkSwap (src + off, dst + off, count, 2), "swapping buffer (16 bit)");
+        EndianSwapBuf32 (dst + off, src + off, count);
+        TEST_BOOL (checkSwap (src + off, dst + off, count, 4), "swapping buffer (32 bit)");
+        EndianSwapBuf64 (dst + off, src + off, count);
+        TEST_BOOL (checkSwap (src + off, dst + off, count, 8), "swapping buffer (64 bit)");
+    }
+    // In place
+    memcpy (tmp, src, BUF_SIZE);
+    EndianSwapBuf32 (tmp, tmp, BUF_SIZE / 4);
+    TEST_BOOL (checkSwap (src, tmp, BUF_SIZE / 4, 4), "swapping buffer in place");
+    // Converting
+    EndianConvertBuf16 (dst, src, BUF_SIZE / 2, EndianHost());
+    TEST_BOOL (!memcmp (dst, src, BUF_SIZE), "converting buffer to host order");
+    EndianConvertBuf64 (dst, src, BUF_SIZE / 8, (EndianHost() == ENDIAN_LITTLE) ? ENDIAN_BIG : ENDIAN_LITTLE);
+    TEST_BOOL (checkSwap (src, dst, BUF_SIZE / 8, 8), "converting buffer to other order");
+    free (src);
+    free (dst);
+    free (tmp);
+    return 0;
+}
+
 int main()
 {
     // Test the swapping macros
@@ -33,6 +86,10 @@ int main()
     uint64_t test64 = 0x0123456789ABCDEF;
     TEST (EndianSwap64 (test64), 0xEFCDAB8967452301, "64 bit endian swap");
 
+    // Check the host byte order against a runtime probe
+    uint16_t probe = 0x1234;
+    TEST (EndianHost(), (*((uint8_t*) &probe) == 0x34) ? ENDIAN_LITTLE : ENDIAN_BIG, "host byte order");
+
     // Test the reading and writing functions
     if (EndianHost() == ENDIAN_LITTLE)
     {
@@ -102,5 +159,29 @@ int main()
         EndianWrite64 (&val64, 0x0123456789ABCD23, ENDIAN_LITTLE);
         TEST (val64, 0x23CDAB8967452301, "writing value with differing endianess then host (64 bit)");
     }
+
+    // Test unaligned loads and stores
+    uint8_t bytes[16] = {0};
+    EndianStore16 (bytes + 1, 0x1234, ENDIAN_BIG);
+    TEST_BOOL (bytes[1] == 0x12 && bytes[2] == 0x34, "unaligned store (16 bit)");
+    TEST (EndianLoad16 (bytes + 1, ENDIAN_BIG), 0x1234, "unaligned load (16 bit)");
+    TEST (EndianLoad16 (bytes + 1, ENDIAN_LITTLE), 0x3412, "unaligned load of swapped value (16 bit)");
+    EndianStore32 (bytes + 3, 0x12345678, ENDIAN_LITTLE);
+    TEST_BOOL (bytes[3] == 0x78 && bytes[6] == 0x12, "unaligned store (32 bit)");
+    TEST (EndianLoad32 (bytes + 3, ENDIAN_LITTLE), 0x12345678, "unaligned load (32 bit)");
+    TEST (EndianLoad32 (bytes + 3, ENDIAN_BIG), 0x78563412, "unaligned load of swapped value (32 bit)");
+    EndianStore64 (bytes + 5, 0x0123456789ABCDEF, ENDIAN_BIG);
+    TEST_BOOL (bytes[5] == 0x01 && bytes[12] == 0xEF, "unaligned store (64 bit)");
+    TEST (EndianLoad64 (bytes + 5, ENDIAN_BIG), 0x0123456789ABCDEF, "unaligned load (64 bit)");
+    TEST (EndianLoad64 (bytes + 5, ENDIAN_LITTLE), 0xEFCDAB8967452301, "unaligned load of swapped value (64 bit)");
+
+    // Test the buffer functions with each kernel forced in turn
+    unsigned int kernelFeats[] = {0, CPU_FEAT_SSSE3, ~0U};
+    for (size_t k = 0; k < ARRAY_SIZE (kernelFeats); ++k)
+    {
+        __Libnex_endian_set_features (kernelFeats[k]);
+        if (testSwapBuf())
+            return 1;
+    }
     return 0;
 }
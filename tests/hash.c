@@ -23,7 +23,73 @@
 #define NEXTEST_NAME "hash"
 #include <nextest.h>
 
+static int numDestroyed = 0;
+
+static void destroyEntry (void* data)
+{
+    UNUSED (data);
+    ++numDestroyed;
+}
+
+// Fills a table with count integer keys, then checks that they can all be found
+static int testTable (HashTable_t* table, int* keys, int count)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        keys[i] = i * 7;
+        TEST_BOOL (HashAdd (table, &keys[i], sizeof (int), &keys[i]), "HashAdd()");
+    }
+    TEST_BOOL (!HashAdd (table, &keys[0], sizeof (int), NULL), "HashAdd() with duplicate key");
+    for (int i = 0; i < count; ++i)
+    {
+        int key = i * 7;
+        HashEntry_t* entry = HashFind (table, &key, sizeof (int));
+        TEST_BOOL (entry && HashEntryData (entry) == &keys[i], "HashFind()");
+    }
+    int key = -1;
+    TEST_BOOL (!HashFind (table, &key, sizeof (int)), "HashFind() with missing key");
+    return 0;
+}
+
 int main()
 {
+    // Test the hash functions
+    TEST (HashCreateHash ("", 0), 2166136261, "HashCreateHash() of empty buffer");
+    TEST (HashCreateHash ("a", 1), 0xE40C292C, "HashCreateHash()");
+    TEST (HashCreateHashStr ("a"), 0xE40C292C, "HashCreateHashStr()");
+
+    // Test a table that rehashes all at once
+    static int keys[1000];
+    HashTable_t* table = HashCreate (3, 0);
+    TEST_BOOL (table && table->numBuckets == 4, "HashCreate()");
+    HashSetDestroy (table, destroyEntry);
+    if (testTable (table, keys, 1000))
+        return 1;
+    HashStats_t stats;
+    HashGetStats (table, &stats);
+    TEST_BOOL (!stats.isResizing && stats.numEntries == 1000 && stats.numBuckets == 1024, "HashGetStats()");
+    TEST_BOOL (HashRemove (table, &keys[10], sizeof (int)), "HashRemove()");
+    TEST_BOOL (!HashFind (table, &keys[10], sizeof (int)), "HashRemove() result validity");
+    TEST_BOOL (!HashRemove (table, &keys[10], sizeof (int)), "HashRemove() with missing key");
+    TEST (numDestroyed, 1, "HashRemove() destroy callback");
+    HashDestroy (table);
+    TEST (numDestroyed, 1000, "HashDestroy()");
+
+    // Test an incremental table
+    // 520 entries is just past the point where 512 buckets were outgrown
+    table = HashCreate (0, HASH_FLAG_INCREMENTAL);
+    if (testTable (table, keys, 520))
+        return 1;
+    HashGetStats (table, &stats);
+    TEST_BOOL (stats.isResizing && stats.bucketsLeft && stats.numOldBuckets == 512, "HashGetStats() resizing");
+    // Entries must be reachable while migrating
+    TEST_BOOL (HashRemove (table, &keys[519], sizeof (int)), "HashRemove() while resizing");
+    TEST_BOOL (HashFind (table, &keys[0], sizeof (int)), "HashFind() while resizing");
+    TEST (HashMigrate (table, SIZE_MAX), 0, "HashMigrate()");
+    HashGetStats (table, &stats);
+    TEST_BOOL (!stats.isResizing && stats.numEntries == 519, "HashGetStats() after migration");
+    for (int i = 0; i < 519; ++i)
+        TEST_BOOL (HashFind (table, &keys[i], sizeof (int)), "HashFind() after migration");
+    HashDestroy (table);
     return 0;
 }
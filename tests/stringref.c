@@ -43,5 +43,27 @@ int main()
     TEST_BOOL (ref2->str, "StrRefDestroy() result validity 1");
     TEST (ref2->obj.refCount, 1, "StrRefDestroy() result validity 2");
     StrRefDestroy (ref2);
+
+    // Test interning
+    StrRefPool_t* pool = StrRefPoolCreate();
+    TEST_BOOL (pool, "StrRefPoolCreate()");
+    char buf[] = "identifier";
+    StringRef_t* iref = StrRefIntern (pool, buf);
+    TEST_BOOL (iref && !strcmp (StrRefGet (iref), "identifier"), "StrRefIntern()");
+    TEST_BOOL (StrRefGet (iref) != buf, "StrRefIntern() copies string");
+    StringRef_t* iref2 = StrRefIntern (pool, "identifier");
+    TEST_BOOL (iref2 == iref, "StrRefIntern() returns canonical reference");
+    TEST (iref->obj.refCount, 3, "StrRefIntern() reference count");
+    StringRef_t* iref3 = StrRefIntern (pool, "other");
+    TEST_BOOL (iref3 != iref, "StrRefIntern() with different string");
+    TEST (StrRefPoolPurge (pool), 0, "StrRefPoolPurge() with referenced strings");
+    StrRefDestroy (iref3);
+    TEST (StrRefPoolPurge (pool), 1, "StrRefPoolPurge()");
+    StrRefDestroy (iref2);
+    StrRefPoolDestroy (pool);
+    // iref outlives the pool
+    TEST_BOOL (!strcmp (StrRefGet (iref), "identifier"), "StrRefPoolDestroy() keeps referenced strings");
+    TEST (iref->obj.refCount, 1, "StrRefPoolDestroy() drops pool's reference");
+    StrRefDestroy (iref);
     return 0;
 }
@@ -108,6 +108,67 @@ int main()
         TextClose (stream2);
         free (buf);
     }
+    // Test codepage support, with KOI8-R
+    {
+        TextStream_t* stream1;
+        if (TextOpen ("testKoi8r.testout", &stream1, TEXT_MODE_WRITE, TEXT_ENC_CODEPAGE (CODEPAGE_KOI8_R), 0, 0) !=
+            TEXT_SUCCESS)
+            return 1;
+        char32_t buf[] = U"Тестовый документ KOI8-R: съешь же ещё этих булок\n";
+        if (TextWrite (stream1, buf, c32len (buf), NULL) != TEXT_SUCCESS)
+            return 1;
+        char32_t bad[] = U"€";
+        TEST (TextWrite (stream1, bad, 1, NULL), TEXT_INVALID_CHAR, "writing invalid character to KOI8-R");
+        TextClose (stream1);
+        // Check the octets, then read it back
+        FILE* file = fopen ("testKoi8r.testout", "rb");
+        uint8_t octets[4] = {0};
+        if (!file || fread (octets, 1, 4, file) != 4)
+            return 1;
+        fclose (file);
+        TEST_BOOL (octets[0] == 0xF4 && octets[1] == 0xC5 && octets[2] == 0xD3 && octets[3] == 0xD4,
+                   "writing KOI8-R");
+        if (TextOpen ("testKoi8r.testout", &stream1, TEXT_MODE_READ, TEXT_ENC_CODEPAGE (CODEPAGE_KOI8_R), 0, 0) !=
+            TEXT_SUCCESS)
+            return 1;
+        TEST (TextGetEncoding (stream1), TEXT_ENC_CODEPAGE (CODEPAGE_KOI8_R), "reading KOI8-R");
+        char32_t buf2[64];
+        if (TextRead (stream1, buf2, c32len (buf) + 1, NULL) != TEXT_SUCCESS)
+            return 1;
+        TEST_BOOL (!c32cmp (buf, buf2), "reading KOI8-R");
+        TextClose (stream1);
+        // Codepages that aren't built in are rejected without truncating the file
+        TEST (TextOpen ("testKoi8r.testout", &stream1, TEXT_MODE_WRITE, TEXT_ENC_CODEPAGE (12), 0, 0),
+              TEXT_INVALID_PARAMETER,
+              "opening a stream with an unknown codepage");
+        TEST (TextOpen ("testKoi8r.testout", &stream1, TEXT_MODE_WRITE, TEXT_ENC_CODEPAGE (CODEPAGE_MAX + 1), 0, 0),
+              TEXT_INVALID_PARAMETER,
+              "opening a stream with an unknown codepage");
+        file = fopen ("testKoi8r.testout", "rb");
+        if (!file)
+            return 1;
+        fseek (file, 0, SEEK_END);
+        TEST_BOOL (ftell (file) == (long) c32len (buf), "rejecting an unknown codepage");
+        fclose (file);
+    }
+    // Test mapping encoding names
+    {
+        char enc = 0, order = 0;
+        TextGetEncId ("ISO-8859-2", &enc, &order);
+        TEST_BOOL (enc == TEXT_ENC_CODEPAGE (CODEPAGE_ISO8859_2) && order == TEXT_ORDER_NONE, "TextGetEncId()");
+        TextGetEncId ("ISO-8859-3", &enc, &order);
+        TEST (enc, TEXT_ENC_CODEPAGE (CODEPAGE_ISO8859_3), "TextGetEncId()");
+        TextGetEncId ("ISO-8859-16", &enc, &order);
+        TEST (enc, TEXT_ENC_CODEPAGE (CODEPAGE_ISO8859_16), "TextGetEncId()");
+        TextGetEncId ("KOI8-R", &enc, &order);
+        TEST (enc, TEXT_ENC_CODEPAGE (CODEPAGE_KOI8_R), "TextGetEncId()");
+        TextGetEncId ("windows-1252", &enc, &order);
+        TEST (enc, TEXT_ENC_WIN1252, "TextGetEncId()");
+        TextGetEncId ("UTF-16BE", &enc, &order);
+        TEST_BOOL (enc == TEXT_ENC_UTF16 && order == TEXT_ORDER_BE, "TextGetEncId()");
+        TextGetEncId ("ISO-8859-12", &enc, &order);
+        TEST_BOOL (!enc && !order, "TextGetEncId() with unknown name");
+    }
     // Test UTF-32 support
     {
         TextStream_t* stream1;
@@ -197,5 +258,158 @@ int main()
         TextClose (stream1);
         free (buf4);
     }
+    // Test text that spans many frames, in pieces that don't line up with the frames
+    {
+        char32_t* text = (char32_t*) malloc_s (6000 * sizeof (char32_t));
+        char32_t* lines = (char32_t*) malloc_s (6000 * sizeof (char32_t));
+        char32_t* buf = (char32_t*) malloc_s (6000 * sizeof (char32_t));
+        const char32_t alphabet[] = U"abc \r\né€𠀀";
+        size_t textLen = 0, linesLen = 0;
+        while (textLen < 5000)
+        {
+            char32_t c = alphabet[rand() % 9];
+            // A lone CR followed by LF would be a CR LF
+            if (c == '\n' && textLen && text[textLen - 1] == '\r')
+                c = 'a';
+            text[textLen++] = c;
+            lines[linesLen++] = (c == '\r') ? '\n' : c;
+            // Make some CRs into CR LFs
+            if (c == '\r' && (rand() & 1))
+                text[textLen++] = '\n';
+        }
+        const char* files[] = {"testUtf8.testout", "testUtf16.testout", "testUtf32.testout"};
+        char encs[] = {TEXT_ENC_UTF8, TEXT_ENC_UTF16, TEXT_ENC_UTF32};
+        char orders[] = {TEXT_ORDER_NONE, TEXT_ORDER_LE, TEXT_ORDER_BE};
+        for (int i = 0; i < 3; ++i)
+        {
+            // Write through a frame that isn't a multiple of the unit size
+            TextStream_t* stream1 = NULL;
+            TextOptions_t opts = {TEXT_MIN_BUFSZ + 2, false};
+            if (TextOpenEx (files[i], &stream1, TEXT_MODE_WRITE, encs[i], i != 0, orders[i], &opts) !=
+                TEXT_SUCCESS)
+                return 1;
+            if (TextWrite (stream1, text, textLen, NULL) != TEXT_SUCCESS)
+                return 1;
+            TextClose (stream1);
+            // Read it in with TextRead
+            if (TextOpen (files[i], &stream1, TEXT_MODE_READ, encs[i], i != 0, 0) != TEXT_SUCCESS)
+                return 1;
+            size_t pos = 0, charsRead = 0;
+            while (!TextIsEof (stream1))
+            {
+                if (TextRead (stream1, buf + pos, (rand() % 97) + 2, &charsRead) != TEXT_SUCCESS)
+                    return 1;
+                pos += charsRead;
+            }
+            TEST_BOOL (pos == textLen && !memcmp (buf, text, textLen * sizeof (char32_t)),
+                       "reading across frames");
+            TextClose (stream1);
+            // And with TextReadLine
+            if (TextOpen (files[i], &stream1, TEXT_MODE_READ, encs[i], i != 0, 0) != TEXT_SUCCESS)
+                return 1;
+            pos = 0;
+            while (!TextIsEof (stream1))
+            {
+                if (TextReadLine (stream1, buf + pos, 6000 - pos, NULL) != TEXT_SUCCESS)
+                    return 1;
+                size_t len = c32len (buf + pos);
+                if (len && buf[pos + len - 1] != '\n' && !TextIsEof (stream1))
+                    break;
+                pos += len;
+            }
+            TEST_BOOL (pos == linesLen && !memcmp (buf, lines, linesLen * sizeof (char32_t)),
+                       "reading lines across frames");
+            TextClose (stream1);
+            // And with a buffer that starts small and grows
+            opts.bufSize = TEXT_MIN_BUFSZ;
+            opts.isAdaptive = true;
+            if (TextOpenEx (files[i], &stream1, TEXT_MODE_READ, encs[i], i != 0, 0, &opts) != TEXT_SUCCESS)
+                return 1;
+            pos = 0;
+            while (!TextIsEof (stream1))
+            {
+                if (TextRead (stream1, buf + pos, (rand() % 97) + 2, &charsRead) != TEXT_SUCCESS)
+                    return 1;
+                pos += charsRead;
+            }
+            TEST_BOOL (pos == textLen && !memcmp (buf, text, textLen * sizeof (char32_t)),
+                       "reading with adaptive buffer");
+            TEST_BOOL (stream1->bufCap > TEXT_MIN_BUFSZ, "adaptive buffer growth");
+            TextClose (stream1);
+        }
+        free (text);
+        free (lines);
+        free (buf);
+        TextStream_t* stream1 = NULL;
+        TextOptions_t opts = {TEXT_MIN_BUFSZ - 1, false};
+        TEST (TextOpenEx ("testUtf8.testout", &stream1, TEXT_MODE_READ, TEXT_ENC_UTF8, 0, 0, &opts),
+              TEXT_INVALID_PARAMETER,
+              "TextOpenEx() with too small buffer");
+    }
+    // Test encoding detection
+    {
+        char enc = 0, order = 0;
+        TEST (TextDetectEncoding ((const uint8_t*) "\xFF\xFE\0\0a\0\0\0", 8, &enc, &order), 4, "detecting BOM");
+        TEST_BOOL (enc == TEXT_ENC_UTF32 && order == TEXT_ORDER_LE, "detecting BOM");
+        TEST (TextDetectEncoding ((const uint8_t*) "\xFF\xFE" "a\0", 4, &enc, &order), 2, "detecting BOM");
+        TEST_BOOL (enc == TEXT_ENC_UTF16 && order == TEXT_ORDER_LE, "detecting BOM");
+        TEST (TextDetectEncoding ((const uint8_t*) "\0\0\0a\0\0\0b", 8, &enc, &order), 0, "detecting UTF-32");
+        TEST_BOOL (enc == TEXT_ENC_UTF32 && order == TEXT_ORDER_BE, "detecting UTF-32");
+        TextDetectEncoding ((const uint8_t*) "a\0b\0c\0\x20\x04", 8, &enc, &order);
+        TEST_BOOL (enc == TEXT_ENC_UTF16 && order == TEXT_ORDER_LE, "detecting UTF-16");
+        TextDetectEncoding ((const uint8_t*) "\0a\0b\0c\0d", 8, &enc, &order);
+        TEST_BOOL (enc == TEXT_ENC_UTF16 && order == TEXT_ORDER_BE, "detecting UTF-16");
+        // A sequence cut off at the end of the buffer is still UTF-8
+        TextDetectEncoding ((const uint8_t*) "caf\xC3\xA9 \xE2\x82", 8, &enc, &order);
+        TEST_BOOL (enc == TEXT_ENC_UTF8 && order == TEXT_ORDER_NONE, "detecting UTF-8");
+        TextDetectEncoding ((const uint8_t*) "caf\xE9 \x93hi\x94", 10, &enc, &order);
+        TEST (enc, TEXT_ENC_WIN1252, "detecting Windows-1252");
+
+        // Test opening streams with detection
+        const char* files[] = {"testAscii1.testxt",
+                               "testWin1252.testxt",
+                               "testUtf32.testxt",
+                               "testUtf16.testxt",
+                               "testUtf8.testxt"};
+        char encs[] = {TEXT_ENC_UTF8, TEXT_ENC_WIN1252, TEXT_ENC_UTF32, TEXT_ENC_UTF16, TEXT_ENC_UTF8};
+        char orders[] = {TEXT_ORDER_NONE, TEXT_ORDER_NONE, TEXT_ORDER_LE, TEXT_ORDER_BE, TEXT_ORDER_NONE};
+        for (int i = 0; i < 5; ++i)
+        {
+            TextStream_t* stream1 = NULL;
+            if (TextOpen (files[i], &stream1, TEXT_MODE_READ, TEXT_ENC_AUTO, 0, 0) != TEXT_SUCCESS)
+                return 1;
+            TEST_BOOL (TextGetEncoding (stream1) == encs[i] && TextGetOrder (stream1) == orders[i],
+                       "opening a stream with detection");
+            TextClose (stream1);
+        }
+        TextStream_t* stream1 = NULL;
+        if (TextOpen ("testUtf16.testxt", &stream1, TEXT_MODE_READ, TEXT_ENC_AUTO, 0, 0) != TEXT_SUCCESS)
+            return 1;
+        char32_t buf1[] = U"Test document € 𠀀 test2\n";
+        char32_t buf2[64];
+        if (TextRead (stream1, buf2, c32len (buf1) + 1, NULL) != TEXT_SUCCESS)
+            return 1;
+        TEST_BOOL (!c32cmp (buf1, buf2), "reading a stream with detection");
+        TextClose (stream1);
+        // A rejected open must not truncate the file
+        FILE* file = fopen ("testAuto.testout", "wb");
+        if (!file || fwrite ("Test document\n", 1, 14, file) != 14)
+            return 1;
+        fclose (file);
+        TEST (TextOpen ("testAuto.testout", &stream1, TEXT_MODE_WRITE, TEXT_ENC_AUTO, 0, 0),
+              TEXT_INVALID_PARAMETER,
+              "writing a stream with detection");
+        TEST (TextOpen ("testAuto.testout", &stream1, TEXT_MODE_APPEND, TEXT_ENC_AUTO, 0, 0),
+              TEXT_INVALID_PARAMETER,
+              "appending to a stream with detection");
+        file = fopen ("testAuto.testout", "rb");
+        if (!file)
+            return 1;
+        char text[32];
+        size_t size = fread (text, 1, sizeof (text), file);
+        fclose (file);
+        TEST_BOOL (size == 14 && !memcmp (text, "Test document\n", 14), "rejecting a stream with detection");
+        remove ("testAuto.testout");
+    }
     return 0;
 }
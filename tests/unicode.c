@@ -18,10 +18,563 @@
 
 /// @file unicode.c
 
+#include "cpu.h"
 #include <libnex.h>
+#include <stdlib.h>
 #define NEXTEST_NAME "unicode"
 #include <nextest.h>
 
+// The tables of the decoder UnicodeDecodePart8 had before it became a DFA
+static const unsigned char oldStateTab[] = {1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+                                            2, 2, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 5, 0};
+static const unsigned char oldNextTab[] = {0, 6, 2, 2, 2, 2};
+static const unsigned char oldMaskTab[] = {0, 0x7F, 0x3F, 0x1F, 0x0F, 0x07};
+static const unsigned char oldSizeTab[] = {0, 1, 0, 2, 3, 4};
+static const unsigned char oldShiftTab[] = {0, 0, 6, 0, 0, 0};
+
+// A copy of the old decoder, which the DFA has to match exactly, errors included
+static size_t oldDecodePart8 (char32_t* out, uint8_t in, Utf8State_t* state)
+{
+    if (state->state == 6)
+        return 0;
+    if (state->state == 0)
+    {
+        state->state = oldStateTab[in >> 3];
+        state->prevState = 0;
+        if (state->state == 2)
+            return 0;
+        state->bytesLeft = oldSizeTab[state->state];
+        state->bytesRequired = state->bytesLeft;
+        *out = 0;
+    }
+    else if (state->state != oldStateTab[in >> 3])
+        return 0;
+    if (in == 0xC0 || in == 0xC1 || in >= 0xF5)
+        return 0;
+    *out = (in & oldMaskTab[state->state]) | (*out << oldShiftTab[state->state]);
+    state->prevState = state->state;
+    state->state = oldNextTab[state->prevState];
+    if ((--state->bytesLeft) == 0)
+        state->state = 6;
+    return 1;
+}
+
+// UnicodeDecode8 on top of the old decoder
+static size_t oldDecode8 (char32_t* out, const uint8_t* in, size_t sz)
+{
+    Utf8State_t state;
+    const uint8_t* oin = in;
+    memset (&state, 0, sizeof (Utf8State_t));
+    do
+    {
+        if (in > (oin + sz))
+            return 0;
+        if (!oldDecodePart8 (out, *in, &state))
+            *out = 0xFFFD;
+        ++in;
+    } while (!UnicodeIsAccepted (state));
+    return in - oin;
+}
+
+// Feeds one octet to UnicodeDecodePart8 and the old decoder, and checks that they agree
+static bool checkDecodePart8 (uint8_t in, Utf8State_t* state, char32_t* out)
+{
+    Utf8State_t oldState = *state;
+    char32_t oldOut = *out;
+    size_t ret = UnicodeDecodePart8 (out, in, state);
+    size_t oldRet = oldDecodePart8 (&oldOut, in, &oldState);
+    return ret == oldRet && *out == oldOut && !memcmp (state, &oldState, sizeof (Utf8State_t));
+}
+
+// Decodes in one byte at a time with UnicodeDecodePart8, the same way TextStream_t does
+static size_t refDecode8 (char32_t* out, const uint8_t* in, size_t sz, size_t* consumed)
+{
+    size_t inPos = 0;
+    size_t outPos = 0;
+    while (inPos < sz)
+    {
+        Utf8State_t state;
+        UnicodeStateInit (state);
+        size_t start = inPos;
+        while (!UnicodeIsAccepted (state))
+        {
+            if (inPos >= sz)
+            {
+                // Incomplete sequence
+                *consumed = start;
+                return outPos;
+            }
+            if (!UnicodeDecodePart8 (&out[outPos], in[inPos], &state))
+            {
+                out[outPos] = 0xFFFD;
+                ++inPos;
+                break;
+            }
+            ++inPos;
+        }
+        ++outPos;
+    }
+    *consumed = inPos;
+    return outPos;
+}
+
+// Checks UnicodeDecode8Buf against refDecode8
+static int testDecode8Buf (const uint8_t* in, size_t sz, const char* name)
+{
+    char32_t* ref = malloc (sz * sizeof (char32_t) + 1);
+    char32_t* out = malloc (sz * sizeof (char32_t) + 1);
+    size_t refConsumed = 0, consumed = 0;
+    size_t refCount = refDecode8 (ref, in, sz, &refConsumed);
+    size_t count = UnicodeDecode8Buf (out, sz, in, sz, &consumed);
+    TEST_BOOL (count == refCount && consumed == refConsumed && !memcmp (out, ref, count * sizeof (char32_t)),
+               name);
+    // Decode again in small pieces, carrying over incomplete sequences
+    size_t inPos = 0, outPos = 0;
+    while (inPos < refConsumed)
+    {
+        size_t inSz = (sz - inPos) < 7 ? (sz - inPos) : 7;
+        outPos += UnicodeDecode8Buf (out + outPos, 3, in + inPos, inSz, &consumed);
+        inPos += consumed;
+    }
+    TEST_BOOL (outPos == refCount && !memcmp (out, ref, refCount * sizeof (char32_t)), name);
+    free (ref);
+    free (out);
+    return 0;
+}
+
+// Checks UnicodeEncode8Buf against UnicodeEncode8
+static int testEncode8Buf (const char32_t* in, size_t sz, const char* name)
+{
+    uint8_t* ref = malloc (sz * 4 + 1);
+    uint8_t* out = malloc (sz * 4 + 1);
+    size_t refLen = 0;
+    for (size_t i = 0; i < sz; ++i)
+        refLen += UnicodeEncode8 (ref + refLen, in[i], 4);
+    size_t consumed = 0;
+    TEST_BOOL (UnicodeEncode8Buf (NULL, 0, in, sz, &consumed) == refLen && consumed == sz, name);
+    TEST_BOOL (UnicodeEncode8Buf (out, sz * 4, in, sz, &consumed) == refLen && consumed == sz &&
+                   !memcmp (out, ref, refLen),
+               name);
+    // Encode again into a small buffer, moving on when it fills up
+    size_t inPos = 0, outPos = 0;
+    while (inPos < sz)
+    {
+        outPos += UnicodeEncode8Buf (out + outPos, 21, in + inPos, sz - inPos, &consumed);
+        inPos += consumed;
+    }
+    TEST_BOOL (outPos == refLen && !memcmp (out, ref, refLen), name);
+    free (ref);
+    free (out);
+    return 0;
+}
+
+// Decodes UTF-16 one unit at a time, replacing unpaired surrogates with U+FFFD
+static size_t refDecode16 (char32_t* out, const uint16_t* in, size_t sz, char endian)
+{
+    size_t outPos = 0;
+    for (size_t i = 0; i < sz; ++i)
+    {
+        uint16_t unit = EndianLoad16 (in + i, endian);
+        if (unit >= 0xD800 && unit < 0xDC00 && (i + 1) < sz)
+        {
+            uint16_t low = EndianLoad16 (in + i + 1, endian);
+            if (low >= 0xDC00 && low < 0xE000)
+            {
+                out[outPos++] = ((unit - 0xD800) << 10) + (low - 0xDC00) + 0x10000;
+                ++i;
+                continue;
+            }
+        }
+        out[outPos++] = (unit >= 0xD800 && unit < 0xE000) ? 0xFFFD : unit;
+    }
+    return outPos;
+}
+
+// Checks UnicodeDecode16Buf against refDecode16
+static int testDecode16Buf (const uint16_t* in, size_t sz, char endian, const char* name)
+{
+    char32_t* ref = malloc (sz * sizeof (char32_t) + 1);
+    char32_t* out = malloc (sz * sizeof (char32_t) + 1);
+    size_t refCount = refDecode16 (ref, in, sz, endian);
+    // Without a state, a trailing high surrogate is left alone
+    size_t consumed = 0;
+    size_t count = UnicodeDecode16Buf (out, sz, in, sz, endian, NULL, &consumed);
+    bool split = (EndianLoad16 (in + sz - 1, endian) & 0xFC00) == 0xD800;
+    TEST_BOOL (count == (refCount - split) && consumed == (sz - split) &&
+                   !memcmp (out, ref, count * sizeof (char32_t)),
+               name);
+    // Decode again in small pieces, carrying split pairs in the state
+    Utf16State_t state;
+    UnicodeStateInit16 (state);
+    size_t inPos = 0, outPos = 0;
+    while (inPos < sz)
+    {
+        size_t inSz = (sz - inPos) < 7 ? (sz - inPos) : 7;
+        outPos += UnicodeDecode16Buf (out + outPos, 5, in + inPos, inSz, endian, &state, &consumed);
+        inPos += consumed;
+    }
+    if (state.hasHigh)
+        out[outPos++] = 0xFFFD;
+    TEST_BOOL (outPos == refCount && !memcmp (out, ref, refCount * sizeof (char32_t)), name);
+    free (ref);
+    free (out);
+    return 0;
+}
+
+// Checks the transcoders against decoding to UTF-32 and encoding again
+static int testTranscode (const uint16_t* in16, size_t sz16, char endian, const char* name)
+{
+    char32_t* chars = malloc (sz16 * sizeof (char32_t) + 1);
+    uint8_t* ref8 = malloc (sz16 * 3 + 1);
+    uint8_t* out8 = malloc (sz16 * 3 + 1);
+    uint16_t* ref16 = malloc (sz16 * 2 + 1);
+    uint16_t* out16 = malloc (sz16 * 2 + 1);
+    Utf16State_t state;
+    UnicodeStateInit16 (state);
+    size_t count = UnicodeDecode16Buf (chars, sz16, in16, sz16, endian, &state, NULL);
+    if (state.hasHigh)
+        chars[count++] = 0xFFFD;
+    size_t len8 = UnicodeEncode8Buf (ref8, sz16 * 3, chars, count, NULL);
+
+    // UTF-16 to UTF-8, all at once and in pieces
+    UnicodeStateInit16 (state);
+    size_t consumed = 0;
+    TEST (UnicodeTranscode16To8 (NULL, 0, in16, sz16, endian, &state, &consumed), len8, name);
+    size_t outPos = UnicodeTranscode16To8 (out8, sz16 * 3, in16, sz16, endian, &state, &consumed);
+    if (state.hasHigh)
+        outPos += UnicodeEncode8 (out8 + outPos, 0xFFFD, 3);
+    TEST_BOOL (outPos == len8 && !memcmp (out8, ref8, len8), name);
+    UnicodeStateInit16 (state);
+    size_t inPos = 0;
+    outPos = 0;
+    while (inPos < sz16)
+    {
+        size_t inSz = (sz16 - inPos) < 13 ? (sz16 - inPos) : 13;
+        size_t outSz = (sz16 * 3 - outPos) < 19 ? (sz16 * 3 - outPos) : 19;
+        outPos += UnicodeTranscode16To8 (out8 + outPos, outSz, in16 + inPos, inSz, endian, &state, &consumed);
+        inPos += consumed;
+    }
+    if (state.hasHigh)
+        outPos += UnicodeEncode8 (out8 + outPos, 0xFFFD, 3);
+    TEST_BOOL (outPos == len8 && !memcmp (out8, ref8, len8), name);
+
+    // And back to UTF-16
+    size_t len16 = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        char32_t c = (chars[i] >= 0xD800 && chars[i] <= 0xDFFF) ? 0xFFFD : chars[i];
+        len16 += UnicodeEncode16 (ref16 + len16, c, endian);
+    }
+    TEST (UnicodeTranscode8To16 (NULL, 0, ref8, len8, endian, &consumed), len16, name);
+    outPos = UnicodeTranscode8To16 (out16, sz16, ref8, len8, endian, &consumed);
+    TEST_BOOL (outPos == len16 && consumed == len8 && !memcmp (out16, ref16, len16 * 2), name);
+    inPos = 0;
+    outPos = 0;
+    while (inPos < len8)
+    {
+        size_t inSz = (len8 - inPos) < 11 ? (len8 - inPos) : 11;
+        outPos += UnicodeTranscode8To16 (out16 + outPos, 5, ref8 + inPos, inSz, endian, &consumed);
+        inPos += consumed;
+    }
+    TEST_BOOL (outPos == len16 && !memcmp (out16, ref16, len16 * 2), name);
+    free (chars);
+    free (ref8);
+    free (out8);
+    free (ref16);
+    free (out16);
+    return 0;
+}
+
+// Finds the first invalid UTF-8 sequence by decoding and checking each character
+static size_t refValidate8 (const uint8_t* buf, size_t len)
+{
+    size_t i = 0;
+    while (i < len)
+    {
+        uint8_t lead = buf[i];
+        size_t seqSz = 0;
+        if (lead < 0x80)
+            seqSz = 1;
+        else if (lead >= 0xC0 && lead < 0xF8)
+            seqSz = (lead < 0xE0) ? 2 : (lead < 0xF0) ? 3 : 4;
+        if (!seqSz || (i + seqSz) > len)
+            return i;
+        char32_t c = (seqSz == 1) ? lead : (lead & (0x7F >> seqSz));
+        for (size_t j = 1; j < seqSz; ++j)
+        {
+            if ((buf[i + j] & 0xC0) != 0x80)
+                return i;
+            c = (c << 6) | (buf[i + j] & 0x3F);
+        }
+        char32_t minChar[] = {0, 0, 0x80, 0x800, 0x10000};
+        if (c < minChar[seqSz] || (c >= 0xD800 && c <= 0xDFFF) || c > 0x10FFFF)
+            return i;
+        i += seqSz;
+    }
+    return len;
+}
+
+// Checks UnicodeValidate8 and its streaming variant against refValidate8
+static int testValidate8 (const uint8_t* buf, size_t len, const char* name)
+{
+    size_t ref = refValidate8 (buf, len);
+    size_t err = 0;
+    TEST_BOOL (UnicodeValidate8 (buf, len, &err) == (ref == len) && err == ref, name);
+    Utf8ValidState_t state;
+    UnicodeValidateInit8 (state);
+    size_t pos = 0;
+    bool valid = true;
+    while (valid && pos < len)
+    {
+        size_t chunk = 1 + (rand() % 70);
+        chunk = (len - pos) < chunk ? (len - pos) : chunk;
+        valid = UnicodeValidatePart8 (&state, buf + pos, chunk, &err);
+        pos += chunk;
+    }
+    if (valid)
+        valid = UnicodeValidateFinish8 (&state, &err);
+    TEST_BOOL (valid == (ref == len) && (valid || err == ref), name);
+    return 0;
+}
+
+// Tests the buffer functions, which run on whichever kernels are picked
+static int testKernels (void)
+{
+    // Test decoding buffers of UTF-8
+    const uint8_t text[] = "Hello, world! This line is plain ASCII and long enough for the vector path. "
+                           "Þ╤𠀀 mixed in, then more ASCII to finish it off";
+    if (testDecode8Buf (text, sizeof (text) - 1, "UnicodeDecode8Buf"))
+        return 1;
+    char32_t outBuf[8];
+    size_t consumed = 0;
+    TEST (UnicodeDecode8Buf (outBuf, 8, (const uint8_t*) "ab\xF0\xA0\x80", 5, &consumed),
+          2,
+          "UnicodeDecode8Buf with incomplete sequence");
+    TEST (consumed, 2, "UnicodeDecode8Buf with incomplete sequence");
+    TEST (UnicodeDecode8Buf (outBuf, 8, (const uint8_t*) "\x80\xC3" "A\xC0", 4, &consumed),
+          3,
+          "UnicodeDecode8Buf with invalid sequences");
+    TEST_BOOL (consumed == 4 && outBuf[0] == 0xFFFD && outBuf[1] == 0xFFFD && outBuf[2] == 0xFFFD,
+               "UnicodeDecode8Buf with invalid sequences");
+    // Random mixes of ASCII runs, valid sequences, and garbage
+    srand (1);
+    uint8_t* rnd = malloc (4096);
+    for (int round = 0; round < 64; ++round)
+    {
+        size_t len = 0;
+        while (len < 4000)
+        {
+            int kind = rand() % 4;
+            if (kind == 0)
+            {
+                int run = rand() % 48;
+                for (int i = 0; i < run; ++i)
+                    rnd[len++] = 0x20 + (rand() % 0x5F);
+            }
+            else if (kind == 1)
+                len += UnicodeEncode8 (rnd + len, 0x80 + (rand() % 0x10FF7F), 4);
+            else if (kind == 2)
+                rnd[len++] = (uint8_t) rand();
+            else
+                rnd[len++] = 'x';
+        }
+        if (testDecode8Buf (rnd, len, "UnicodeDecode8Buf with random data"))
+            return 1;
+    }
+    free (rnd);
+
+    // Test encoding buffers of UTF-8
+    char32_t chars[4096];
+    for (int round = 0; round < 64; ++round)
+    {
+        // Each round leans towards a different mix of sizes
+        char32_t limits[] = {0x7F, 0x7FF, 0xFFFF, 0x10FFFF};
+        for (int i = 0; i < 4096; ++i)
+        {
+            int kind = (rand() % 8) ? (round % 4) : (rand() % 4);
+            chars[i] = rand() % (limits[kind] + 1);
+        }
+        if (testEncode8Buf (chars, 4096, "UnicodeEncode8Buf"))
+            return 1;
+    }
+    chars[0] = 'a';
+    chars[1] = 0x110000;
+    TEST (UnicodeEncode8Buf (NULL, 0, chars, 2, &consumed), 1, "UnicodeEncode8Buf with invalid character");
+    TEST (consumed, 1, "UnicodeEncode8Buf with invalid character");
+    // Test decoding buffers of UTF-16
+    uint16_t units[2048];
+    for (int round = 0; round < 64; ++round)
+    {
+        char endian = (round & 1) ? ENDIAN_BIG : ENDIAN_LITTLE;
+        size_t len = 0;
+        while (len < 2000)
+        {
+            int kind = rand() % 8;
+            if (kind < 5)
+            {
+                // A run of characters outside of the surrogate range
+                int run = rand() % 40;
+                for (int i = 0; i < run; ++i)
+                {
+                    uint16_t limits[] = {0x7F, 0x7FF, 0xD7FF};
+                    uint16_t unit = (round & 2) ? (0x20 + (rand() % 0x5F)) : (rand() % (limits[round % 3] + 1));
+                    EndianStore16 (units + len++, unit, endian);
+                }
+            }
+            else if (kind < 7)
+                len += UnicodeEncode16 (units + len, 0x10000 + (rand() % 0x100000), endian);
+            else
+                EndianStore16 (units + len++, 0xD800 + (rand() % 0x800), endian);
+        }
+        if (testDecode16Buf (units, len, endian, "UnicodeDecode16Buf"))
+            return 1;
+        if (testTranscode (units, len, endian, "UnicodeTranscode16To8 and UnicodeTranscode8To16"))
+            return 1;
+    }
+    Utf16State_t state16;
+    UnicodeStateInit16 (state16);
+    EndianStore16 (units, 0xD840, ENDIAN_LITTLE);
+    EndianStore16 (units + 1, 0xDC00, ENDIAN_LITTLE);
+    TEST (UnicodeDecode16Buf (outBuf, 8, units, 1, ENDIAN_LITTLE, &state16, &consumed),
+          0,
+          "UnicodeDecode16Buf with split pair");
+    TEST (UnicodeDecode16Buf (outBuf, 8, units + 1, 1, ENDIAN_LITTLE, &state16, &consumed),
+          1,
+          "UnicodeDecode16Buf with split pair");
+    TEST (outBuf[0], U'𠀀', "UnicodeDecode16Buf with split pair");
+    uint8_t invalid8[] = {0xED, 0xA0, 0x80, 0xF4, 0x90, 0x80, 0x80, 'a'};
+    TEST (UnicodeTranscode8To16 (units, 8, invalid8, 8, ENDIAN_LITTLE, &consumed),
+          3,
+          "UnicodeTranscode8To16 with characters outside of UTF-16");
+    TEST_BOOL (units[0] == 0xFFFD && units[1] == 0xFFFD && units[2] == 'a',
+               "UnicodeTranscode8To16 with characters outside of UTF-16");
+
+    // Test validating UTF-8
+    uint8_t* text8 = malloc (8192);
+    for (int round = 0; round < 512; ++round)
+    {
+        size_t len = 0;
+        size_t target = rand() % 4000;
+        while (len < target)
+        {
+            int kind = rand() % 4;
+            if (kind < 2)
+            {
+                int run = rand() % 64;
+                for (int i = 0; i < run; ++i)
+                    text8[len++] = 0x20 + (rand() % 0x5F);
+            }
+            else
+            {
+                char32_t limits[] = {0x7FF, 0xFFFF, 0x10FFFF};
+                char32_t c = rand() % (limits[rand() % 3] + 1);
+                if (c >= 0xD800 && c <= 0xDFFF)
+                    c = 0xFFFD;
+                len += UnicodeEncode8 (text8 + len, c, 4);
+            }
+        }
+        // Break most of them somewhere
+        if (len && (round % 4))
+        {
+            size_t pos = rand() % len;
+            uint8_t bad[] = {0x80, 0xBF, 0xC0, 0xC1, 0xE0, 0xED, 0xF0, 0xF4, 0xF5, 0xFF, 'a', 0xA0, 0x90};
+            text8[pos] = bad[rand() % sizeof (bad)];
+            if (round % 8 == 1)
+                len = pos + 1;
+        }
+        if (testValidate8 (text8, len, "UnicodeValidate8"))
+            return 1;
+    }
+    // Put each edge case at every position of a block
+    const char* edgeCases[] = {"\xC2\x80",         "\xDF\xBF",         "\xE0\xA0\x80",     "\xED\x9F\xBF",
+                               "\xEE\x80\x80",     "\xEF\xBF\xBF",     "\xF0\x90\x80\x80", "\xF4\x8F\xBF\xBF",
+                               "\xC0\x80",         "\xC1\xBF",         "\xE0\x9F\xBF",     "\xED\xA0\x80",
+                               "\xED\xBF\xBF",     "\xF0\x8F\xBF\xBF", "\xF4\x90\x80\x80", "\xF5\x80\x80\x80",
+                               "\xF8\x88\x80\x80", "\xFF",             "\x80",             "\xE2\x82\xAC\xAC",
+                               "\xE2\x82",         "\xF0\x90\x80",     "\xC2",             "\xE2\x82\xE2\x82\xAC"};
+    for (size_t i = 0; i < ARRAY_SIZE (edgeCases); ++i)
+    {
+        for (size_t pos = 0; pos < 72; ++pos)
+        {
+            memset (text8, 'a', 128);
+            memcpy (text8 + pos, edgeCases[i], strlen (edgeCases[i]));
+            if (testValidate8 (text8, 128, "UnicodeValidate8 with edge cases"))
+                return 1;
+        }
+    }
+    free (text8);
+    size_t errOffset = 0;
+    TEST_BOOL (UnicodeValidate8 ((const uint8_t*) "abc\xE2\x82\xAC", 6, &errOffset) && errOffset == 6,
+               "UnicodeValidate8 with valid text");
+    TEST_BOOL (!UnicodeValidate8 ((const uint8_t*) "abc\xED\xA0\x80", 6, &errOffset) && errOffset == 3,
+               "UnicodeValidate8 with surrogate");
+    TEST_BOOL (!UnicodeValidate8 ((const uint8_t*) "abc\xE2\x82", 5, &errOffset) && errOffset == 3,
+               "UnicodeValidate8 with cut off sequence");
+
+    // Test counting and measuring
+    for (int round = 0; round < 64; ++round)
+    {
+        char32_t limits[] = {0x7F, 0x7FF, 0xFFFF, 0x10FFFF};
+        size_t count = rand() % 3000;
+        for (size_t i = 0; i < count; ++i)
+        {
+            int kind = (rand() % 8) ? (round % 4) : (rand() % 4);
+            chars[i] = rand() % (limits[kind] + 1);
+            if (chars[i] >= 0xD800 && chars[i] <= 0xDFFF)
+                chars[i] = 0xFFFD;
+        }
+        uint8_t* encoded8 = malloc (count * 4 + 1);
+        uint16_t* encoded16 = malloc (count * 4 + 1);
+        size_t len8 = UnicodeEncode8Buf (encoded8, count * 4, chars, count, NULL);
+        char endian = (round & 1) ? ENDIAN_BIG : ENDIAN_LITTLE;
+        size_t len16 = 0;
+        for (size_t i = 0; i < count; ++i)
+            len16 += UnicodeEncode16 (encoded16 + len16, chars[i], endian);
+        TEST (UnicodeCount8 (encoded8, len8), count, "UnicodeCount8");
+        TEST (UnicodeCount16 (encoded16, len16, endian), count, "UnicodeCount16");
+        TEST (UnicodeLength8 (chars, count), len8, "UnicodeLength8");
+        TEST (UnicodeLength16 (chars, count), len16, "UnicodeLength16");
+        free (encoded8);
+        free (encoded16);
+    }
+    // Measuring stops at a character that can't be encoded, in the vector loop and after it
+    for (int i = 0; i < 16; ++i)
+        chars[i] = (i & 1) ? U'𠀀' : 'a';
+    chars[9] = 0x110000;
+    chars[14] = 0xFFFFFFFF;
+    TEST (UnicodeLength8 (chars, 16), 5 * 1 + 4 * 4, "UnicodeLength8 with invalid character");
+    TEST (UnicodeLength16 (chars, 16), 5 * 1 + 4 * 2, "UnicodeLength16 with invalid character");
+    TEST (UnicodeLength16 (chars + 10, 6), 2 * 1 + 2 * 2, "UnicodeLength16 with invalid character");
+
+    // Test Windows-1252. Every octet round trips, preceded by enough ASCII to hit the vector kernels
+    uint8_t cp1252[512];
+    uint8_t cp1252Out[512];
+    for (int i = 0; i < 256; ++i)
+    {
+        cp1252[i * 2] = 'a' + (i % 26);
+        cp1252[(i * 2) + 1] = (uint8_t) i;
+    }
+    TEST (UnicodeDecodeWin1252 (chars, cp1252, 512), 512, "UnicodeDecodeWin1252");
+    TEST_BOOL (chars[1 + (0x80 * 2)] == 0x20AC && chars[1 + (0x88 * 2)] == 0x02C6 &&
+                   chars[1 + (0x81 * 2)] == 0x81 && chars[1 + (0x9F * 2)] == 0x0178 &&
+                   chars[1 + (0xE9 * 2)] == 0xE9,
+               "UnicodeDecodeWin1252 result validity");
+    TEST (UnicodeEncodeWin1252 (cp1252Out, chars, 512), 512, "UnicodeEncodeWin1252");
+    TEST_BOOL (!memcmp (cp1252, cp1252Out, 512), "UnicodeEncodeWin1252 result validity");
+    chars[0] = U'’';
+    chars[1] = U'€';
+    chars[2] = 0x80;
+    TEST (UnicodeEncodeWin1252 (cp1252Out, chars, 3), 2, "UnicodeEncodeWin1252 with invalid character");
+    chars[2] = U'Ā';
+    TEST (UnicodeEncodeWin1252 (cp1252Out, chars, 3), 2, "UnicodeEncodeWin1252 with invalid character");
+    TEST_BOOL (cp1252Out[0] == 0x92 && cp1252Out[1] == 0x80, "UnicodeEncodeWin1252 result validity");
+
+    uint8_t octets[4];
+    chars[0] = U'𠀀';
+    TEST (UnicodeEncode8Buf (octets, 3, chars, 1, &consumed), 0, "UnicodeEncode8Buf with small buffer");
+    return 0;
+}
+
 int main()
 {
     // Test decoding UTF-16
@@ -79,5 +632,62 @@ int main()
     UnicodeEncode8 (val9, val8, 4);
     UnicodeDecode8 (&out, val9, 4);
     TEST (out, U'a', "UnicodeEncode8");
+
+    // Check the DFA against the old decoder, for every state and octet
+    bool dfaOk = true;
+    for (int st = 0; st < 256; ++st)
+    {
+        for (int left = 0; left < 256; ++left)
+        {
+            for (int oct = 0; oct < 256; ++oct)
+            {
+                Utf8State_t state = {0xA5, (uint8_t) st, 0x5A, (uint8_t) left};
+                char32_t part = 0x12345 + (char32_t) oct;
+                dfaOk &= checkDecodePart8 ((uint8_t) oct, &state, &part);
+            }
+        }
+    }
+    TEST_BOOL (dfaOk, "UnicodeDecodePart8 against the old decoder");
+    // And over random streams, mostly starting over after each character, but sometimes carrying on
+    // from where an error left the state
+    srand (1);
+    Utf8State_t state;
+    memset (&state, 0, sizeof (Utf8State_t));
+    char32_t part = 0;
+    uint8_t stream[72] = {0};
+    for (int i = 0; i < 2000000; ++i)
+    {
+        // Bias towards ASCII and continuations, so that real sequences come up
+        int kind = rand() % 3;
+        uint8_t oct = (uint8_t) rand();
+        if (kind == 0)
+            oct &= 0x7F;
+        else if (kind == 1)
+            oct = 0x80 | (oct & 0x3F);
+        dfaOk &= checkDecodePart8 (oct, &state, &part);
+        if (UnicodeIsAccepted (state) || !(rand() % 8))
+            UnicodeStateInit (state);
+        // Every so often, check UnicodeDecode8 over the last 64 octets
+        stream[i % 64] = oct;
+        if ((i % 64) == 63)
+        {
+            for (size_t j = 0; j < 64; ++j)
+            {
+                char32_t dec = 0, oldDec = 0;
+                dfaOk &= UnicodeDecode8 (&dec, stream + j, 64 - j) == oldDecode8 (&oldDec, stream + j, 64 - j);
+                dfaOk &= dec == oldDec;
+            }
+        }
+    }
+    TEST_BOOL (dfaOk, "UnicodeDecodePart8 against the old decoder with random streams");
+
+    // Run the buffer tests with each set of kernels forced in turn
+    unsigned int kernelFeats[] = {0, CPU_FEAT_SSSE3, ~0U};
+    for (size_t k = 0; k < ARRAY_SIZE (kernelFeats); ++k)
+    {
+        __Libnex_unicode_set_features (kernelFeats[k]);
+        if (testKernels())
+            return 1;
+    }
     return 0;
 }
@@ -0,0 +1,134 @@
+/*
+    varint.c - contains test suite for variable length integers
+    Copyright 2022 The NexNix Project
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    There should be a copy of the License distributed in a file named
+    LICENSE, if not, you may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/// @file varint.c
+
+#include <libnex.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NEXTEST_NAME "varint"
+#include <nextest.h>
+
+#define NUM_VALS 1000
+
+// Gets a random value, biased so that every encoded length shows up
+static uint64_t randVal()
+{
+    uint64_t val = ((uint64_t) rand() << 42) ^ ((uint64_t) rand() << 21) ^ (uint64_t) rand();
+    return val >> (rand() % 64);
+}
+
+int main()
+{
+    uint8_t buf[16] = {0};
+    uint64_t uval = 0;
+    int64_t sval = 0;
+
+    // Test known encodings
+    TEST (VarintEncodeU (buf, 624485), 3, "VarintEncodeU()");
+    TEST_BOOL (buf[0] == 0xE5 && buf[1] == 0x8E && buf[2] == 0x26, "VarintEncodeU() result validity");
+    TEST (VarintDecodeU (buf, 3, &uval), 3, "VarintDecodeU()");
+    TEST (uval, 624485, "VarintDecodeU() result validity");
+    TEST (VarintEncodeS (buf, -123456), 3, "VarintEncodeS()");
+    TEST_BOOL (buf[0] == 0xC0 && buf[1] == 0xBB && buf[2] == 0x78, "VarintEncodeS() result validity");
+    TEST (VarintDecodeS (buf, 3, &sval), 3, "VarintDecodeS()");
+    TEST (sval, -123456, "VarintDecodeS() result validity");
+    TEST (VarintEncodeU (buf, UINT64_MAX), VARINT_MAX_BYTES, "VarintEncodeU() with largest value");
+    TEST (VarintDecodeU (buf, sizeof (buf), &uval), VARINT_MAX_BYTES, "VarintDecodeU() with largest value");
+    TEST (uval, UINT64_MAX, "VarintDecodeU() with largest value result validity");
+    TEST (VarintEncodeS (buf, INT64_MIN), VARINT_MAX_BYTES, "VarintEncodeS() with smallest value");
+    TEST (VarintDecodeS (buf, sizeof (buf), &sval), VARINT_MAX_BYTES, "VarintDecodeS() with smallest value");
+    TEST (sval, INT64_MIN, "VarintDecodeS() with smallest value result validity");
+
+    // Test zigzag
+    TEST (VarintZigzagEncode (-1), 1, "VarintZigzagEncode()");
+    TEST (VarintZigzagEncode (1), 2, "VarintZigzagEncode()");
+    TEST (VarintZigzagDecode (VarintZigzagEncode (INT64_MIN)), INT64_MIN, "VarintZigzagDecode()");
+
+    // Test invalid input
+    memset (buf, 0xFF, sizeof (buf));
+    TEST (VarintDecodeU (buf, sizeof (buf), &uval), 0, "VarintDecodeU() with overlong value");
+    TEST (VarintDecodeU (buf, 3, &uval), 0, "VarintDecodeU() with truncated value");
+    buf[9] = 0x02;
+    TEST (VarintDecodeU (buf, sizeof (buf), &uval), 0, "VarintDecodeU() with value too large");
+
+    // Round trip random values through single and bulk functions, checking sizes
+    uint64_t* uvals = malloc_s (NUM_VALS * sizeof (uint64_t));
+    int64_t* svals = malloc_s (NUM_VALS * sizeof (int64_t));
+    uint64_t* uout = malloc_s (NUM_VALS * sizeof (uint64_t));
+    int64_t* sout = malloc_s (NUM_VALS * sizeof (int64_t));
+    uint8_t* enc = malloc_s (NUM_VALS * VARINT_MAX_BYTES);
+    srand (1);
+    for (int i = 0; i < NUM_VALS; ++i)
+    {
+        // Put runs of small values in the middle, to hit the single byte fast path
+        uvals[i] = (i >= 100 && i < 300) ? (uint64_t) (rand() % 128) : randVal();
+        svals[i] = (rand() & 1) ? -(int64_t) (uvals[i] >> 1) : (int64_t) (uvals[i] >> 1);
+        uint8_t tmp[VARINT_MAX_BYTES];
+        TEST (VarintEncodeU (tmp, uvals[i]), VarintSizeU (uvals[i]), "VarintSizeU()");
+        TEST (VarintEncodeS (tmp, svals[i]), VarintSizeS (svals[i]), "VarintSizeS()");
+        TEST_BOOL (VarintDecodeS (tmp, VARINT_MAX_BYTES, &sval) && sval == svals[i], "VarintDecodeS() round trip");
+    }
+
+    size_t written = 0, consumed = 0;
+    TEST (VarintEncodeBufU (enc, NUM_VALS * VARINT_MAX_BYTES, uvals, NUM_VALS, &written),
+          NUM_VALS,
+          "VarintEncodeBufU()");
+    TEST (VarintDecodeBufU (uout, NUM_VALS, enc, written, &consumed), NUM_VALS, "VarintDecodeBufU()");
+    TEST (consumed, written, "VarintDecodeBufU() consumed size");
+    TEST_BOOL (!memcmp (uout, uvals, NUM_VALS * sizeof (uint64_t)), "VarintDecodeBufU() result validity");
+    // Check that single decodes agree with bulk encoding
+    size_t pos = 0;
+    for (int i = 0; i < NUM_VALS; ++i)
+    {
+        size_t len = VarintDecodeU (enc + pos, written - pos, &uval);
+        TEST_BOOL (len && uval == uvals[i], "VarintDecodeU() round trip");
+        pos += len;
+    }
+    // Check truncation stops decoding on a value boundary
+    TEST (VarintDecodeBufU (uout, NUM_VALS, enc, written - 1, &consumed),
+          NUM_VALS - 1,
+          "VarintDecodeBufU() truncated");
+
+    TEST (VarintEncodeBufS (enc, NUM_VALS * VARINT_MAX_BYTES, svals, NUM_VALS, &written),
+          NUM_VALS,
+          "VarintEncodeBufS()");
+    TEST (VarintDecodeBufS (sout, NUM_VALS, enc, written, &consumed), NUM_VALS, "VarintDecodeBufS()");
+    TEST_BOOL (!memcmp (sout, svals, NUM_VALS * sizeof (int64_t)), "VarintDecodeBufS() result validity");
+
+    TEST (VarintEncodeBufZ (enc, NUM_VALS * VARINT_MAX_BYTES, svals, NUM_VALS, &written),
+          NUM_VALS,
+          "VarintEncodeBufZ()");
+    TEST (VarintDecodeBufZ (sout, NUM_VALS, enc, written, &consumed), NUM_VALS, "VarintDecodeBufZ()");
+    TEST_BOOL (!memcmp (sout, svals, NUM_VALS * sizeof (int64_t)), "VarintDecodeBufZ() result validity");
+
+    // Check encoding into a small buffer stops on a value boundary
+    size_t encoded = VarintEncodeBufU (enc, 50, uvals, NUM_VALS, &written);
+    TEST_BOOL (encoded < NUM_VALS && written <= 50, "VarintEncodeBufU() with small buffer");
+    TEST (VarintDecodeBufU (uout, NUM_VALS, enc, written, &consumed),
+          encoded,
+          "VarintEncodeBufU() partial result");
+
+    free (uvals);
+    free (svals);
+    free (uout);
+    free (sout);
+    free (enc);
+    return 0;
+}